@@ -197,6 +197,21 @@ namespace eflib
 				return ret;
 			}
 
+			// Allocates 'count' contiguous objects.
+			T* alloc(size_t count)
+			{
+#if defined(EFLIB_DEBUG)
+				if(sz + count > cap)
+				{
+					assert(false);
+					return NULL;
+				}
+#endif
+				T* ret = advance_bytes(data_mem, stride * sz);
+				sz += count;
+				return ret;
+			}
+
 			void dealloc(T*) {}
 
 			void clear()
@@ -204,6 +219,13 @@ namespace eflib
 				sz = 0;
 			}
 
+			bool contains(T const* p) const
+			{
+				char const* beg = reinterpret_cast<char const*>(data_mem);
+				char const* cur = reinterpret_cast<char const*>(p);
+				return beg <= cur && cur < beg + stride * sz;
+			}
+
 			vls_vector_iterator<T> begin() const
 			{
 				return vls_vector_iterator<T>(data_mem, stride);
@@ -64,6 +64,15 @@ umd_resource::umd_resource(umd_device* dev, const D3D11DDIARG_CREATERESOURCE* cr
 		case DXGI_FORMAT_R32_SINT:
 			fmt = pixel_format_color_r32i;
 			break;
+		case DXGI_FORMAT_D32_FLOAT:
+			fmt = pixel_format_color_d32f;
+			break;
+		case DXGI_FORMAT_D24_UNORM_S8_UINT:
+			fmt = pixel_format_color_d24s8;
+			break;
+		case DXGI_FORMAT_D16_UNORM:
+			fmt = pixel_format_color_d16;
+			break;
 
 		default:
 			assert(false);
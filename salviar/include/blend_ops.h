@@ -0,0 +1,185 @@
+#pragma once
+
+#include <salviar/include/salviar_forward.h>
+
+#include <salviar/include/framebuffer.h>
+#include <salviar/include/colors.h>
+#include <salviar/include/colors_convertors.h>
+
+BEGIN_NS_SALVIAR();
+
+enum color_write_mode
+{
+	color_write_opaque,
+	color_write_masked,
+	color_write_blend
+};
+
+inline uint32_t get_color_write_mode(render_target_blend_desc const& desc)
+{
+	if(desc.blend_enable)
+	{
+		return color_write_blend;
+	}
+	return desc.write_mask == color_write_enable_all ? color_write_opaque : color_write_masked;
+}
+
+#if !defined(EFLIB_NO_SIMD)
+
+// Load and store texels of target in native format without converting by surface.
+template <int Format>
+class native_color_accessor
+{
+};
+
+template <> class native_color_accessor<pixel_format_color_rgba32f>
+{
+public:
+	static __m128 load(void const* texel)
+	{
+		return _mm_loadu_ps( static_cast<float const*>(texel) );
+	}
+
+	static void store(void* texel, __m128 color)
+	{
+		_mm_storeu_ps(static_cast<float*>(texel), color);
+	}
+};
+
+template <> class native_color_accessor<pixel_format_color_rgba8>
+{
+public:
+	static __m128 load(void const* texel)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i color = _mm_cvtsi32_si128( *static_cast<int const*>(texel) );
+		color = _mm_unpacklo_epi16( _mm_unpacklo_epi8(color, zero), zero );
+		return _mm_mul_ps( _mm_cvtepi32_ps(color), _mm_set1_ps(1.0f / 255.0f) );
+	}
+
+	static void store(void* texel, __m128 color)
+	{
+		__m128 const f255 = _mm_set1_ps(255.0f);
+		color = _mm_min_ps( _mm_max_ps( _mm_mul_ps(color, f255), _mm_setzero_ps() ), f255 );
+		__m128i icolor = _mm_cvtps_epi32(color);
+		icolor = _mm_packs_epi32(icolor, icolor);
+		icolor = _mm_packus_epi16(icolor, icolor);
+		*static_cast<int*>(texel) = _mm_cvtsi128_si32(icolor);
+	}
+};
+
+template <> class native_color_accessor<pixel_format_color_bgra8>
+{
+public:
+	static __m128 load(void const* texel)
+	{
+		__m128 color = native_color_accessor<pixel_format_color_rgba8>::load(texel);
+		return _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 0, 1, 2));
+	}
+
+	static void store(void* texel, __m128 color)
+	{
+		native_color_accessor<pixel_format_color_rgba8>::store( texel, _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 0, 1, 2)) );
+	}
+};
+
+inline __m128 select_ps(__m128 mask, __m128 lhs, __m128 rhs)
+{
+	return _mm_or_ps( _mm_and_ps(mask, lhs), _mm_andnot_ps(mask, rhs) );
+}
+
+inline __m128 write_mask_ps(uint8_t write_mask)
+{
+	return _mm_castsi128_ps( _mm_set_epi32(
+		(write_mask & color_write_enable_alpha) ? -1 : 0,
+		(write_mask & color_write_enable_blue)  ? -1 : 0,
+		(write_mask & color_write_enable_green) ? -1 : 0,
+		(write_mask & color_write_enable_red)   ? -1 : 0
+		) );
+}
+
+inline __m128 blend_factor_ps(blend_factor factor, __m128 src, __m128 dst)
+{
+	__m128 const one = _mm_set1_ps(1.0f);
+	switch(factor)
+	{
+	case blend_factor_zero:				return _mm_setzero_ps();
+	case blend_factor_one:				return one;
+	case blend_factor_src_color:		return src;
+	case blend_factor_inv_src_color:	return _mm_sub_ps(one, src);
+	case blend_factor_src_alpha:		return _mm_shuffle_ps(src, src, _MM_SHUFFLE(3, 3, 3, 3));
+	case blend_factor_inv_src_alpha:	return _mm_sub_ps( one, _mm_shuffle_ps(src, src, _MM_SHUFFLE(3, 3, 3, 3)) );
+	case blend_factor_dest_alpha:		return _mm_shuffle_ps(dst, dst, _MM_SHUFFLE(3, 3, 3, 3));
+	case blend_factor_inv_dest_alpha:	return _mm_sub_ps( one, _mm_shuffle_ps(dst, dst, _MM_SHUFFLE(3, 3, 3, 3)) );
+	case blend_factor_dest_color:		return dst;
+	case blend_factor_inv_dest_color:	return _mm_sub_ps(one, dst);
+	case blend_factor_src_alpha_sat:
+		{
+			__m128 sat = _mm_min_ps(
+				_mm_shuffle_ps(src, src, _MM_SHUFFLE(3, 3, 3, 3)),
+				_mm_sub_ps( one, _mm_shuffle_ps(dst, dst, _MM_SHUFFLE(3, 3, 3, 3)) )
+				);
+			return select_ps(_mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)), one, sat);
+		}
+	}
+	return _mm_setzero_ps();
+}
+
+inline __m128 blend_ps(blend_op op, __m128 src, __m128 src_factor, __m128 dst, __m128 dst_factor)
+{
+	switch(op)
+	{
+	case blend_op_add:			return _mm_add_ps( _mm_mul_ps(src, src_factor), _mm_mul_ps(dst, dst_factor) );
+	case blend_op_subtract:		return _mm_sub_ps( _mm_mul_ps(src, src_factor), _mm_mul_ps(dst, dst_factor) );
+	case blend_op_rev_subtract:	return _mm_sub_ps( _mm_mul_ps(dst, dst_factor), _mm_mul_ps(src, src_factor) );
+	case blend_op_min:			return _mm_min_ps(src, dst);
+	case blend_op_max:			return _mm_max_ps(src, dst);
+	}
+	return src;
+}
+
+// Writes color to texel in native format with fixed-function blending.
+template <int Format, uint32_t Mode>
+inline void write_native_color(void* texel, __m128 src, render_target_blend_desc const& desc)
+{
+	if(Mode == color_write_opaque)
+	{
+		native_color_accessor<Format>::store(texel, src);
+		return;
+	}
+
+	__m128 dst = native_color_accessor<Format>::load(texel);
+
+	if(Mode == color_write_masked)
+	{
+		native_color_accessor<Format>::store( texel, select_ps(write_mask_ps(desc.write_mask), src, dst) );
+		return;
+	}
+
+	__m128 blended = blend_ps(
+		desc.color_op,
+		src, blend_factor_ps(desc.src_blend, src, dst),
+		dst, blend_factor_ps(desc.dest_blend, src, dst)
+		);
+
+	if( desc.alpha_op != desc.color_op || desc.src_blend_alpha != desc.src_blend || desc.dest_blend_alpha != desc.dest_blend )
+	{
+		__m128 blended_alpha = blend_ps(
+			desc.alpha_op,
+			src, blend_factor_ps(desc.src_blend_alpha, src, dst),
+			dst, blend_factor_ps(desc.dest_blend_alpha, src, dst)
+			);
+		blended = select_ps(_mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)), blended_alpha, blended);
+	}
+
+	if(desc.write_mask != color_write_enable_all)
+	{
+		blended = select_ps(write_mask_ps(desc.write_mask), blended, dst);
+	}
+
+	native_color_accessor<Format>::store(texel, blended);
+}
+
+#endif
+
+END_NS_SALVIAR();
@@ -21,6 +21,9 @@ struct vs_output_op;
 
 const size_t plane_num = 2;
 
+// Triangles in a packet are tested together by SIMD.
+uint32_t const CLIP_PACKET_SIZE = 4;
+
 struct clip_context
 {
 	clip_context();
@@ -57,7 +60,7 @@ private:
 	void clip_triangle_to_poly_general (vs_output** tri_verts, clip_results*) const;
 	void clip_triangle_to_poly_simple  (vs_output** tri_verts, clip_results*) const;
 
-	void clip_wireframe_triangle(vs_output** tri_verts, clip_results* rslt);
+	void clip_line				(vs_output** line_verts, clip_results* rslt);
 	void clip_solid_triangle	(vs_output** tri_verts, clip_results* rslt);
 
 public:
@@ -65,10 +68,19 @@ public:
 
 	void set_context(clip_context const* ctxt);
 
-	inline void clip(vs_output** tri_verts, clip_results* rslt)
+	// Clips a primitive. Lines are clipped for both line lists and edges of wireframe triangles,
+	// and result of a line is 2 verts or nothing.
+	inline void clip(vs_output** prim_verts, clip_results* rslt)
 	{
-		(this->*clip_impl_)(tri_verts, rslt);
+		(this->*clip_impl_)(prim_verts, rslt);
 	}
+
+	// Clips at most CLIP_PACKET_SIZE triangles, 3 verts per triangle in 'tri_verts'.
+	// Trivially accepted and rejected triangles are classified by SIMD, and only triangles
+	// straddling near or far plane are clipped by scalar clipper.
+	// Verts of all result triangles are written to rslt->clipped_verts continuously,
+	// and count of verts clipped from each triangle is written to 'clipped_verts_count'.
+	void clip_packet(vs_output** tri_verts, uint32_t tri_count, clip_results* rslt, uint32_t* clipped_verts_count);
 };
 
 END_NS_SALVIAR();
\ No newline at end of file
@@ -337,6 +337,177 @@ private:
 	}
 };
 
+/** Depth-stencil formats.
+ *  Depth-stencil value is exchanged with rgba32f as (depth, stencil bits as float, 0, 0),
+ *  same as rg32f which is used as depth-stencil target.
+ */
+inline float ds_stencil_to_float(uint32_t stencil)
+{
+	union
+	{
+		float		stencil_f;
+		uint32_t	stencil_u;
+	};
+	stencil_u = stencil;
+	return stencil_f;
+}
+
+inline uint32_t ds_float_to_stencil(float stencil)
+{
+	union
+	{
+		float		stencil_f;
+		uint32_t	stencil_u;
+	};
+	stencil_f = stencil;
+	return stencil_u;
+}
+
+struct color_d32f
+{
+	typedef float comp_t;
+	comp_t depth;
+
+	color_d32f(){}
+	explicit color_d32f(comp_t depth):depth(depth){}
+
+	template<class T>
+	color_d32f(const T& rhs){
+		*this = rhs;
+	}
+
+	color_d32f& operator = (const color_d32f& rhs){
+		depth = rhs.depth;
+		return *this;
+	}
+
+	color_d32f& operator = (const color_rgba32f& rhs){
+		return assign(rhs);
+	}
+
+	template<class T>
+	color_d32f& operator = (const T& rhs){
+		return assign(rhs.to_rgba32f());
+	}
+
+	color_rgba32f to_rgba32f() const{
+		return color_rgba32f(depth, 0.0f, 0.0f, 0.0f);
+	}
+
+private:
+	color_d32f& assign(const color_rgba32f& rhs){
+		depth = rhs.r;
+		return *this;
+	}
+};
+
+/** 24-bit unorm depth in low bits and 8-bit stencil in high bits.
+ */
+struct color_d24s8
+{
+	typedef uint32_t comp_t;
+	static const uint32_t DEPTH_MAX = 0xFFFFFF;
+	comp_t ds;
+
+	color_d24s8(){}
+	color_d24s8(float depth, uint32_t stencil){
+		ds = pack(depth, stencil);
+	}
+
+	template<class T>
+	color_d24s8(const T& rhs){
+		*this = rhs;
+	}
+
+	color_d24s8& operator = (const color_d24s8& rhs){
+		ds = rhs.ds;
+		return *this;
+	}
+
+	color_d24s8& operator = (const color_rgba32f& rhs){
+		return assign(rhs);
+	}
+
+	template<class T>
+	color_d24s8& operator = (const T& rhs){
+		return assign(rhs.to_rgba32f());
+	}
+
+	float depth() const{
+		return (ds & DEPTH_MAX) * (1.0f / DEPTH_MAX);
+	}
+
+	uint32_t stencil() const{
+		return ds >> 24;
+	}
+
+	color_rgba32f to_rgba32f() const{
+		return color_rgba32f(depth(), ds_stencil_to_float(stencil()), 0.0f, 0.0f);
+	}
+
+	static uint32_t pack(float depth, uint32_t stencil){
+		uint32_t d = static_cast<uint32_t>( eflib::clamp(depth, 0.0f, 1.0f) * DEPTH_MAX + 0.5f );
+		return d | (stencil << 24);
+	}
+
+private:
+	color_d24s8& assign(const color_rgba32f& rhs){
+		ds = pack( rhs.r, ds_float_to_stencil(rhs.g) );
+		return *this;
+	}
+};
+
+/** 16-bit unorm depth.
+ */
+struct color_d16
+{
+	typedef uint16_t comp_t;
+	static const uint32_t DEPTH_MAX = 0xFFFF;
+	comp_t d;
+
+	color_d16(){}
+	explicit color_d16(float depth){
+		d = pack(depth);
+	}
+
+	template<class T>
+	color_d16(const T& rhs){
+		*this = rhs;
+	}
+
+	color_d16& operator = (const color_d16& rhs){
+		d = rhs.d;
+		return *this;
+	}
+
+	color_d16& operator = (const color_rgba32f& rhs){
+		return assign(rhs);
+	}
+
+	template<class T>
+	color_d16& operator = (const T& rhs){
+		return assign(rhs.to_rgba32f());
+	}
+
+	float depth() const{
+		return d * (1.0f / DEPTH_MAX);
+	}
+
+	color_rgba32f to_rgba32f() const{
+		return color_rgba32f(depth(), 0.0f, 0.0f, 0.0f);
+	}
+
+	static comp_t pack(float depth){
+		return static_cast<comp_t>( eflib::clamp(depth, 0.0f, 1.0f) * DEPTH_MAX + 0.5f );
+	}
+
+private:
+	color_d16& assign(const color_rgba32f& rhs){
+		d = pack(rhs.r);
+		return *this;
+	}
+};
+
 inline color_rgba32f lerp(const color_rgba32f& c0, const color_rgba32f& c1, float t)
 {
 #ifndef EFLIB_NO_SIMD
@@ -378,6 +549,18 @@ inline color_rgba32f lerp(const color_r32i& c0, const color_r32i& c1, float t)
 {
 	return color_r32i(static_cast<color_r32i::comp_t>(c0.r + (c1.r - c0.r) * t)).to_rgba32f();
 }
+inline color_rgba32f lerp(const color_d32f& c0, const color_d32f& c1, float t)
+{
+	return color_d32f(c0.depth + (c1.depth - c0.depth) * t).to_rgba32f();
+}
+inline color_rgba32f lerp(const color_d24s8& c0, const color_d24s8& c1, float t)
+{
+	return color_rgba32f(c0.depth() + (c1.depth() - c0.depth()) * t, 0.0f, 0.0f, 0.0f);
+}
+inline color_rgba32f lerp(const color_d16& c0, const color_d16& c1, float t)
+{
+	return color_rgba32f(c0.depth() + (c1.depth() - c0.depth()) * t, 0.0f, 0.0f, 0.0f);
+}
 
 inline color_rgba32f lerp(const color_rgba32f& c0, const color_rgba32f& c1, const color_rgba32f& c2, const color_rgba32f& c3, float tx, float ty)
 {
@@ -488,6 +671,24 @@ inline color_rgba32f lerp(const color_r32i& c0, const color_r32i& c1, const colo
 	color_r32f c23(c2.r + (c3.r - c2.r) * tx);
 	return color_r32f(c01.r + (c23.r - c01.r) * ty).to_rgba32f();
 }
+inline color_rgba32f lerp(const color_d32f& c0, const color_d32f& c1, const color_d32f& c2, const color_d32f& c3, float tx, float ty)
+{
+	float d01 = c0.depth + (c1.depth - c0.depth) * tx;
+	float d23 = c2.depth + (c3.depth - c2.depth) * tx;
+	return color_rgba32f(d01 + (d23 - d01) * ty, 0.0f, 0.0f, 0.0f);
+}
+inline color_rgba32f lerp(const color_d24s8& c0, const color_d24s8& c1, const color_d24s8& c2, const color_d24s8& c3, float tx, float ty)
+{
+	float d01 = c0.depth() + (c1.depth() - c0.depth()) * tx;
+	float d23 = c2.depth() + (c3.depth() - c2.depth()) * tx;
+	return color_rgba32f(d01 + (d23 - d01) * ty, 0.0f, 0.0f, 0.0f);
+}
+inline color_rgba32f lerp(const color_d16& c0, const color_d16& c1, const color_d16& c2, const color_d16& c3, float tx, float ty)
+{
+	float d01 = c0.depth() + (c1.depth() - c0.depth()) * tx;
+	float d23 = c2.depth() + (c3.depth() - c2.depth()) * tx;
+	return color_rgba32f(d01 + (d23 - d01) * ty, 0.0f, 0.0f, 0.0f);
+}
 
 END_NS_SALVIAR()
 
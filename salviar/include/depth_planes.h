@@ -0,0 +1,109 @@
+#pragma once
+
+#include <salviar/include/salviar_forward.h>
+#include <salviar/include/enums.h>
+
+#include <eflib/include/platform/intrin.h>
+#include <eflib/include/diagnostics/assert.h>
+
+#include <vector>
+
+BEGIN_NS_SALVIAR();
+
+class surface;
+
+#if !defined(EFLIB_NO_SIMD)
+// 4-wide depth test. Lane is all ones if 'lhs' passed.
+inline __m128 depth_compare_ps(compare_function func, __m128 lhs, __m128 rhs)
+{
+	switch(func)
+	{
+	case compare_function_never:
+		return _mm_setzero_ps();
+	case compare_function_less:
+		return _mm_cmplt_ps(lhs, rhs);
+	case compare_function_equal:
+		return _mm_cmpeq_ps(lhs, rhs);
+	case compare_function_less_equal:
+		return _mm_cmple_ps(lhs, rhs);
+	case compare_function_greater:
+		return _mm_cmpgt_ps(lhs, rhs);
+	case compare_function_not_equal:
+		return _mm_cmpneq_ps(lhs, rhs);
+	case compare_function_greater_equal:
+		return _mm_cmpge_ps(lhs, rhs);
+	case compare_function_always:
+		return _mm_castsi128_ps( _mm_set1_epi32(-1) );
+	default:
+		EFLIB_ASSERT(false, "Invalid compare function.");
+		return _mm_setzero_ps();
+	}
+}
+#endif
+
+// Depth plane of triangle.
+// Depth of pixel is evaluated per quad in the same order as rasterizer does:
+//   d00 = c + (a * (qx + 0.5f) + b * (qy + 0.5f)), d01 = d00 + a, d10 = d00 + b, d11 = d01 + b,
+// so compressed depth is bit-exact with depth of raw storage.
+struct depth_plane
+{
+	static int const MAX_SAMPLES = 4;
+
+	float a, b, c;
+	float aa_offset[MAX_SAMPLES];
+
+	bool operator == (depth_plane const& rhs) const;
+};
+
+// Compressed storage of depth-stencil surface with format rg32f.
+// Surface is split into 8x8 tiles. A tile is encoded as one or two depth planes with per-sample
+// plane selection mask, and a constant stencil. Tile falls back to raw storage of surface
+// if its depth can not be encoded as planes any more. Fast clear resets all tiles to planes.
+class depth_plane_buffer
+{
+public:
+	static int const TILE_SIZE = 8;
+
+	depth_plane_buffer(surface* target);
+
+	void clear(float depth, uint32_t stencil);
+
+	// Tests quad with depth of plane. 'passed' is same as result of framebuffer::early_z_test_quad.
+	// Returns false if the tile is stored in raw, and caller needs to test depth on surface.
+	bool test_quad(
+		uint64_t& passed, size_t x, size_t y, uint64_t quad_mask,
+		float const* depth, depth_plane const& plane,
+		compare_function func, bool write_depth);
+
+	// Writes planes of tile to raw storage.
+	void decompress(size_t x, size_t y)
+	{
+		size_t tile_index = (y / TILE_SIZE) * tile_count_x_ + (x / TILE_SIZE);
+		if(tiles_[tile_index].plane_count != 0)
+		{
+			decompress_tile(tile_index);
+		}
+	}
+	void decompress_all();
+
+private:
+	struct tile
+	{
+		uint32_t	plane_count;
+		uint32_t	stencil;
+		depth_plane	planes[2];
+		// Bit of pixel is 1 if sample uses planes[1].
+		uint64_t	selections[depth_plane::MAX_SAMPLES];
+	};
+
+	surface*			target_;
+	size_t				sample_count_;
+	size_t				tile_count_x_;
+	size_t				tile_count_y_;
+	std::vector<tile>	tiles_;
+
+	uint64_t valid_pixels(size_t tile_index) const;
+	void decompress_tile(size_t tile_index);
+};
+
+END_NS_SALVIAR();
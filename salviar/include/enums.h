@@ -93,6 +93,14 @@ enum fill_mode
 	fill_mode_count = 2
 };
 
+// Width and height in pixels of coarse pixel which is shaded once.
+enum shading_rate
+{
+	shading_rate_1x1 = 1,
+	shading_rate_2x2 = 2,
+	shading_rate_4x4 = 4
+};
+
 enum prim_type
 {
 	pt_none,
@@ -196,6 +204,39 @@ enum stencil_op
     stencil_op_decr_wrap = 8,
 };
 
+enum blend_factor
+{
+	blend_factor_zero = 1,
+	blend_factor_one = 2,
+	blend_factor_src_color = 3,
+	blend_factor_inv_src_color = 4,
+	blend_factor_src_alpha = 5,
+	blend_factor_inv_src_alpha = 6,
+	blend_factor_dest_alpha = 7,
+	blend_factor_inv_dest_alpha = 8,
+	blend_factor_dest_color = 9,
+	blend_factor_inv_dest_color = 10,
+	blend_factor_src_alpha_sat = 11
+};
+
+enum blend_op
+{
+	blend_op_add = 1,
+	blend_op_subtract = 2,
+	blend_op_rev_subtract = 3,
+	blend_op_min = 4,
+	blend_op_max = 5
+};
+
+enum color_write_enable
+{
+	color_write_enable_red = 0x1,
+	color_write_enable_green = 0x2,
+	color_write_enable_blue = 0x4,
+	color_write_enable_alpha = 0x8,
+	color_write_enable_all = 0xF
+};
+
 enum clear_flag
 {
 	clear_depth = 0x1,
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <salviar/include/salviar_forward.h>
+
+#include <eflib/include/math/vector.h>
+#include <eflib/include/platform/typedefs.h>
+
+#include <vector>
+
+BEGIN_NS_SALVIAR();
+
+class surface;
+
+// Fragments of order-independent transparency of a color surface.
+// Fragments are appended to per-sample linked lists which are allocated per 64x64 tile.
+// A tile is only written by the thread which rasterizes it, so lists need no synchronization.
+// 'resolve' sorts fragments of each sample by depth and composites them over surface.
+class fragment_list_buffer
+{
+public:
+	static int const TILE_SIZE = 64;
+
+	fragment_list_buffer(surface* target);
+
+	void append(size_t x, size_t y, size_t sample, eflib::vec4 const& color, float depth);
+
+	// Fragments are blended from far to near with source alpha, and lists are emptied.
+	void resolve();
+
+private:
+	struct fragment
+	{
+		eflib::vec4	color;
+		float		depth;
+		uint32_t	next;
+	};
+
+	struct tile
+	{
+		std::vector<uint32_t>	heads;		// Head of list per sample. It is allocated by first fragment.
+		std::vector<fragment>	fragments;
+	};
+
+	surface*			target_;
+	size_t				sample_count_;
+	size_t				tile_count_x_;
+	size_t				tile_count_y_;
+	std::vector<tile>	tiles_;
+
+	void resolve_tile(size_t tile_index, std::vector<fragment const*>& sorted);
+};
+
+END_NS_SALVIAR();
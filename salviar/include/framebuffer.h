@@ -79,12 +79,101 @@ public:
     uint32_t    mask_stencil(uint32_t stencil, uint32_t stencil_mask) const;
 };
 
+struct render_target_blend_desc
+{
+	bool			blend_enable;
+	blend_factor	src_blend;
+	blend_factor	dest_blend;
+	blend_op		color_op;
+	blend_factor	src_blend_alpha;
+	blend_factor	dest_blend_alpha;
+	blend_op		alpha_op;
+	uint8_t			write_mask;
+
+	render_target_blend_desc()
+		: blend_enable(false)
+		, src_blend(blend_factor_one), dest_blend(blend_factor_zero), color_op(blend_op_add)
+		, src_blend_alpha(blend_factor_one), dest_blend_alpha(blend_factor_zero), alpha_op(blend_op_add)
+		, write_mask(color_write_enable_all)
+	{
+	}
+};
+
+struct blend_desc
+{
+	// Only render_target[0] is used for all targets if independent blend is disabled.
+	bool						independent_blend_enable;
+	render_target_blend_desc	render_target[MAX_RENDER_TARGETS];
+	// Fragments of target 0 are appended to per-pixel lists instead of being blended,
+	// and lists are sorted and composited by renderer::resolve_transparency.
+	bool						oit_enable;
+
+	blend_desc(): independent_blend_enable(false), oit_enable(false)
+	{
+	}
+};
+
+class blend_state
+{
+	blend_desc desc_;
+
+public:
+	blend_state(const blend_desc& desc);
+	const blend_desc& get_desc() const;
+
+	const render_target_blend_desc& get_target_desc(size_t target_index) const
+	{
+		return desc_.render_target[desc_.independent_blend_enable ? target_index : 0];
+	}
+};
+
+// Output merger function writes a shaded quad to targets with depth test, depth write,
+// blending and format packing fused. It is one of template instantiations precompiled in om_shim,
+// and only single color target without stencil, with depth in color_rg32f, is supported.
+struct om_quad_key
+{
+	uint32_t	depth_func;		// compare_function_always without depth write if depth is tested before shading.
+	bool		depth_write;
+	int			color_format;
+	uint32_t	color_write_mode;
+
+	bool operator == (om_quad_key const& rhs) const
+	{
+		return depth_func == rhs.depth_func && depth_write == rhs.depth_write
+			&& color_format == rhs.color_format && color_write_mode == rhs.color_write_mode;
+	}
+};
+
+struct om_quad_data
+{
+	uint8_t*					color_data;
+	size_t						color_pitch;
+	uint8_t*					ds_data;
+	size_t						ds_pitch;
+	uint32_t					sample_count;
+	render_target_blend_desc	blend;
+};
+
+typedef void (*om_quad_func_ptr)(
+	om_quad_data const* data, size_t x, size_t y, uint64_t quad_mask,
+	ps_output const* quad, float const* depth, float const* aa_offset);
+
+struct depth_plane;
+class  depth_plane_buffer;
+class  fragment_list_buffer;
+
 class framebuffer
 {
 private:
+	typedef void (*color_write_fn)(surface* target, size_t x, size_t y, size_t sample, eflib::vec4 const& color, render_target_blend_desc const& desc);
+	typedef void (*color_quad_write_fn)(
+		surface* target, size_t x, size_t y, uint64_t quad_mask,
+		ps_output const* quad, size_t target_index, render_target_blend_desc const& desc);
+
     surface*                color_targets_[MAX_RENDER_TARGETS];
     surface*                ds_target_;
 	depth_stencil_state*	ds_state_;
+	blend_state*			blend_state_;
 	uint32_t				stencil_ref_;
     uint32_t                stencil_read_mask_;
     uint32_t                stencil_write_mask_;
@@ -94,8 +183,52 @@ private:
 
 	void (*read_depth_stencil_)(float& depth, uint32_t& stencil, uint32_t stencil_mask, void const* ds_data);
 	void (*write_depth_stencil_)(void* ds_data, float depth, uint32_t stencil, uint32_t stencil_mask);
+	// Rounds incoming depth to precision of depth stencil format before depth test.
+	float (*quantize_depth_)(float depth);
+
+	// Quad early-z of packed depth formats. It is null for rg32f.
+	uint64_t (*early_z_quad_)(
+		surface* target, size_t x, size_t y, uint64_t quad_mask,
+		float const* depth, float const* aa_z_offset, uint32_t sample_count,
+		compare_function func, bool write_depth);
+
+	// Color writers are specialized by blend mode and format of targets. It is null if target is not written.
+	size_t					color_target_count_;
+	color_write_fn			color_writers_[MAX_RENDER_TARGETS];
+	color_quad_write_fn		color_quad_writers_[MAX_RENDER_TARGETS];
+	render_target_blend_desc
+							color_blend_descs_[MAX_RENDER_TARGETS];
+	// Indexes of targets which have color writer, so masked targets are skipped by quad writing.
+	size_t					written_target_count_;
+	size_t					written_targets_[MAX_RENDER_TARGETS];
+
+	render_stages const*	stages_;
+	om_quad_func_ptr		om_quad_func_;
+	om_quad_data			om_quad_data_;
+
+	// Compressed depth is used by early-z only, otherwise depth target is decompressed in 'update'.
+	depth_plane_buffer*		ds_planes_;
+
+	// Fragment lists of target 0 if order-independent transparency is enabled.
+	fragment_list_buffer*	oit_lists_;
+
+	// Tile framebuffer renders to tile-sized copies of targets of parent.
+	// Quad functions take coordinates in targets of parent and translate them to the tile,
+	// per pixel/sample functions take tile coordinates. 'tile_rect_' is left, top, width and height of tile.
+	framebuffer const*		parent_;
+	surface_ptr				tile_targets_[MAX_RENDER_TARGETS + 1];	// Last one is depth-stencil target.
+	size_t					tile_rect_[4];
     
     void update_ds_rw_functions(bool ds_format_changed, bool ds_state_changed, bool output_depth_enabled);
+	template <uint32_t Format>
+	void select_ds_rw_functions(bool read_depth, bool read_stencil, bool write_depth, bool write_stencil);
+	void update_color_write_functions();
+	void update_om_function(render_state const* state);
+	void write_color(size_t x, size_t y, size_t sample, const ps_output& ps);
+	void write_color_quad(size_t x, size_t y, uint64_t quad_mask, ps_output const* quad);
+	uint64_t early_z_test_quad_local(size_t x, size_t y, uint64_t quad_mask, float const* depth, float const* aa_z_offset, depth_plane const* z_plane);
+	void append_fragments(size_t x, size_t y, uint64_t quad_mask, ps_output const* quad, float const* depth, float const* aa_offset);
+	uint64_t late_z_test_quad(size_t x, size_t y, uint64_t quad_mask, float const* depth, bool front_face, float const* aa_offset);
 
 public:
 	void initialize	(render_stages const* stages);
@@ -106,12 +239,22 @@ public:
 
 	bool		early_z_enabled() const { return early_z_enabled_; } 
 
+	// Materializes fast-cleared tiles of all targets which will be written in region.
+	void		prepare_tile(size_t left, size_t top, size_t width, size_t height);
+
+	// Tile-local rendering. This framebuffer becomes a per-thread copy of 'parent' whose targets are
+	// tile-sized surfaces. 'begin_tile' reads region of targets of parent and 'end_tile' writes it back once.
+	// Region must be in one tile, and only pixels in it could be rendered.
+	void		bind_tile_targets(framebuffer const& parent);
+	void		begin_tile(size_t left, size_t top, size_t width, size_t height);
+	void		end_tile();
+
 	void		render_sample(cpp_blend_shader* cpp_bs, size_t x, size_t y, size_t i_sample, const ps_output& ps, float depth, bool front_face);
 	void		render_sample_quad(cpp_blend_shader* cpp_bs, size_t x, size_t y, uint64_t quad_mask, ps_output const* quad, float const* depth, bool front_face, float const* aa_offset);
     uint64_t	early_z_test(size_t x, size_t y, float depth, float const* aa_z_offset);
 	uint64_t	early_z_test(size_t x, size_t y, uint32_t px_mask, float depth, float const* aa_z_offset);
-	uint64_t	early_z_test_quad(size_t x, size_t y, float const* depth, float const* aa_z_offset);
-	uint64_t	early_z_test_quad(size_t x, size_t y, uint64_t quad_mask, float const* depth, float const* aa_z_offset);
+	uint64_t	early_z_test_quad(size_t x, size_t y, float const* depth, float const* aa_z_offset, depth_plane const* z_plane);
+	uint64_t	early_z_test_quad(size_t x, size_t y, uint64_t quad_mask, float const* depth, float const* aa_z_offset, depth_plane const* z_plane);
 
 	static void clear_depth_stencil(surface* tar, uint32_t flag, float depth, uint32_t stencil);
 };
@@ -9,8 +9,12 @@
 
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/shared_array.hpp>
+#include <boost/function.hpp>
 #include <eflib/include/platform/boost_end.h>
 
+#include <vector>
+#include <utility>
+
 BEGIN_NS_SALVIAR();
 
 struct vs_output_op;
@@ -19,22 +23,54 @@ class  vertex_cache;
 struct viewport;
 struct thread_context;
 
+// Clipping a triangle by near and far plane generates 3 triangles at most.
+// A wireframe triangle generates 3 edges at most as well.
+uint32_t const MAX_CLIPPED_TRIANGLES = 3;
+
+// Edge of wireframe triangle is drawn by the triangle itself, see geom_setup_context::edge_owners.
+uint32_t const SELF_OWNED_EDGE = 0xFFFFFFFFU;
+
+// Primitives which are clipped and projected from a package of input primitives.
+// Sequence number of primitive is 'input primitive id * MAX_CLIPPED_TRIANGLES + index in clipped primitives',
+// so primitives could be drawn in input order without compaction.
+struct geom_setup_package
+{
+	uint32_t			thread_id;
+	uint32_t			prim_count;
+	vs_output const**	verts;
+	uint32_t const*		seqs;
+};
+
 struct geom_setup_context
 {
 	vs_output_op const*	vso_ops;
 	vertex_cache*		dvc;
+	viewport const*		vp;
 	prim_type			prim;
 	size_t				prim_size;
-	size_t				prim_count;
+	size_t				prim_count;			// Primitives of all instances.
+	size_t				prims_per_instance;	// Id of primitive is 'instance * prims_per_instance + primitive in instance'.
 	bool				(*cull)(float area);
+	bool				culling;
+
+	// Only for wireframe triangles. Owner triangle of each edge ('triangle id in instance * 3 + edge index').
+	// An edge shared by triangles is drawn by its owner, or by the other triangles if the owner was culled.
+	uint32_t const*		edge_owners;
+
+	// Called by thread which set up primitives of the package.
+	boost::function<void (geom_setup_package const*)>
+						dispatch;
 
     async_object*       pipeline_stat;
     accumulate_fn<uint64_t>::type
                         acc_cinvocations;
+    accumulate_fn<uint64_t>::type
+                        acc_cprimitives;
 };
 
 /*
-	Primitive Verts -> Primitive Packages -> Clipped Packages (Sparse) -> Compacted Clipped Primitive Verts
+	Primitive Verts -> Primitive Packages -> Clipped and Projected Packages -> Dispatcher
+	All steps of a package are executed by one thread, there is no synchronization between steps.
 */
 class geom_setup_engine
 {	
@@ -42,50 +78,25 @@ class geom_setup_engine
 public:
 	geom_setup_engine();
 
-	void execute(geom_setup_context const*, uint64_t (*fetch_time_stamp)());
-
-	size_t verts_count() const
-	{
-		return static_cast<size_t>( clipped_package_compacted_addresses_[clipping_package_count_] );
-	}
-
-	vs_output** verts() const
-	{
-		return compacted_verts_.get();
-	}
-	
-	uint64_t compact_start_time() const
-	{
-		return compact_start_time_;
-	}
+	void execute(geom_setup_context const*);
 
 private:
-	typedef eflib::pool::reserved_pool<vs_output> vs_output_pool;
-
-	void clip_geometries();
-	void compact_geometries();
-	
-	void threaded_clip_geometries(thread_context const* thread_ctx);
-	void threaded_compact_geometries(thread_context const* thread_ctx);
-	
-	boost::shared_array<vs_output_pool>	vso_pools_;
-	
-	boost::shared_array<vs_output*>		clipped_verts_;
-	size_t								clipped_verts_cap_;
+	typedef eflib::pool::reserved_pool<vs_output>	vs_output_pool;
+	typedef std::pair<vs_output const*, vs_output*>	projected_vert;
 
-	boost::shared_array<uint32_t>		clipped_package_verts_count_;
-	size_t								clipped_package_verts_count_cap_;
-	
-	boost::shared_array<vs_output*>		compacted_verts_;
-	size_t								compacted_verts_cap_;
+	void threaded_setup_geometries(thread_context const* thread_ctx);
+	vs_output* project(vs_output* vert, uint32_t thread_id, projected_vert* prim_verts, uint32_t& prim_verts_count);
+	bool is_culled(vs_output* const* tri_verts) const;
+	bool is_edge_drawn(uint32_t tri_id, uint32_t edge, uint32_t thread_id) const;
 
-	boost::shared_array<uint32_t>		clipped_package_compacted_addresses_;
-	size_t								clipped_package_compacted_addresses_cap_;
+	boost::shared_array<vs_output_pool>	vso_pools_;
+	boost::shared_array<vs_output_pool>	projected_pools_;
 
-	int32_t								clipping_package_count_;
+	// Direct-mapped table of projected verts per thread.
+	std::vector< std::vector<projected_vert> >
+										projected_verts_;
 
 	size_t								thread_count_;
-	uint64_t							compact_start_time_;
 
 	geom_setup_context const*			ctxt_;
 };
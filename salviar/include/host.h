@@ -3,6 +3,8 @@
 
 #include <salviar/include/salviar_forward.h>
 
+#include <salviar/include/framebuffer.h>
+
 #include <eflib/include/utility/shared_declaration.h>
 #include <eflib/include/string/ustring.h>
 
@@ -32,10 +34,16 @@ public:
 
 	// virtual void update_target_params	(renderer_parameters const& rp, buffer_ptr const& target) = 0;
 
+	// Updates a variable of vertex shader without updating other states. It is used by per-draw constants.
+	virtual bool				vx_update_constant(eflib::fixed_string const& name, void const* value, size_t sz) = 0;
+
 	virtual vx_shader_unit_ptr	get_vx_shader_unit() const = 0;
 	virtual px_shader_unit_ptr	get_px_shader_unit() const = 0;
 	virtual size_t				vs_output_attr_count() const = 0;
 
+	// Returns output merger function for the key, or nullptr if it is not supported.
+	virtual om_quad_func_ptr	get_om_function(om_quad_key const& key) = 0;
+
 	virtual ~host() {}
 };
 
@@ -16,10 +16,8 @@ EFLIB_DECLARE_CLASS_SHARED_PTR(shader_object);
 EFLIB_DECLARE_CLASS_SHARED_PTR(cpp_vertex_shader);
 
 enum input_classifications{
-	input_per_vertex
-
-	// TODO:
-	// input_per_instance
+	input_per_vertex,
+	input_per_instance
 };
 
 struct input_element_desc
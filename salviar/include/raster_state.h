@@ -27,13 +27,20 @@ struct raster_desc
 	bool				scissor_enable;
 	bool				multisample_enable;
 	bool				anti_aliased_line_enable;
+	shading_rate		sr;
+	// Pixel shader is executed per sample at sample positions if multi-sampling is used.
+	bool				sample_shading_enable;
+	// Each tile of targets is rendered in a per-thread tile buffer and written back once after all primitives of the tile.
+	bool				tile_buffer_enable;
 
 	raster_desc():
 		fm(fill_solid), cm(cull_back),
 		front_ccw(false),
 		depth_bias(0), depth_bias_clamp(0), slope_scaled_depth_bias(0),
 		depth_clip_enable(true), scissor_enable(false),
-		multisample_enable(true), anti_aliased_line_enable(false)
+		multisample_enable(true), anti_aliased_line_enable(false),
+		sr(shading_rate_1x1), sample_shading_enable(false),
+		tile_buffer_enable(false)
 	{
 	}
 };
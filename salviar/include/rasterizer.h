@@ -7,7 +7,9 @@
 #include <salviar/include/shader.h>
 #include <salviar/include/framebuffer.h>
 #include <salviar/include/raster_state.h>
+#include <salviar/include/shader_regs.h>
 #include <salviar/include/geom_setup_engine.h>
+#include <salviar/include/index_fetcher.h>
 #include <salviar/include/async_object.h>
 
 #include <eflib/include/memory/atomic.h>
@@ -17,8 +19,11 @@
 #include <boost/array.hpp>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
 #include <eflib/include/platform/boost_end.h>
 
+#include <vector>
+
 BEGIN_NS_SALVIAR();
 
 typedef eflib::pool::reserved_pool<vs_output> vs_output_pool;
@@ -34,16 +39,74 @@ class  shader_reflection;
 struct pixel_statistic;
 struct drawing_triangle_context;
 
+// Primitive which was clipped, projected and set up.
+// Lines are set up into 'tri_info' as well: edge_factors[0] is line equation 'a * x + b * y + c',
+// and planes are constant across the line, so pixels near the line are interpolated as their projection on it.
+struct setup_prim
+{
+	vs_output const*	verts[3];
+	triangle_info		tri_info;
+	bool				small;		// Small triangle is rasterized by testing its bounding box directly instead of hierarchical tiles.
+};
+
+// Primitive in bin of tile. Primitives of a tile are sorted by sequence number to keep drawing order.
+struct binned_prim
+{
+	binned_prim(uint32_t seq, uint32_t full, setup_prim const* prim): seq(seq), full(full), prim(prim)
+	{
+	}
+
+	bool operator < (binned_prim const& rhs) const
+	{
+		return seq < rhs.seq;
+	}
+
+	uint32_t			seq;
+	uint32_t			full;
+	setup_prim const*	prim;
+};
+
+// Primitives of a thread are allocated from chunks which are reused by following draws.
+class setup_prim_pool
+{
+public:
+	setup_prim_pool(): used_(0)
+	{
+	}
+
+	setup_prim* alloc()
+	{
+		size_t chunk_index = used_ / CHUNK_SIZE;
+		if( chunk_index == chunks_.size() )
+		{
+			chunks_.push_back( boost::shared_array<setup_prim>(new setup_prim[CHUNK_SIZE]) );
+		}
+		return &chunks_[chunk_index][used_++ % CHUNK_SIZE];
+	}
+
+	void clear()
+	{
+		used_ = 0;
+	}
+
+private:
+	static size_t const CHUNK_SIZE = 256;
+
+	std::vector< boost::shared_array<setup_prim> >	chunks_;
+	size_t											used_;
+};
+
 struct drawing_shader_context
 {
     cpp_pixel_shader*	cpp_ps;
 	pixel_shader_unit*	ps_unit;
 	cpp_blend_shader*	cpp_bs;
+	framebuffer*		frame_buffer;
 };
 
 struct rasterize_multi_prim_context
 {
-	std::vector<uint32_t> const*	sorted_prims;
+	std::vector<binned_prim> const*	sorted_prims;
 	viewport const*					tile_vp;
     pixel_statistic*                pixel_stat;
     drawing_shader_context          shaders;
@@ -51,7 +114,8 @@ struct rasterize_multi_prim_context
 
 struct rasterize_prim_context
 {
-	uint32_t						prim_id;
+	setup_prim const*				prim;
+	uint32_t						full;
 	viewport const*					tile_vp;
     pixel_statistic*                pixel_stat;
     drawing_shader_context          shaders;
@@ -76,12 +140,20 @@ private:
 	cpp_blend_shader*				cpp_bs_;
 	viewport const*					vp_;
     viewport const*                 target_vp_;
+	bool							scissor_enable_;
+	int32_t							scissor_bounds_[4];	// Left, top, right and bottom of scissor in pixels. Right and bottom are excluded.
+	int								scissor_tiles_[4];	// Tiles in [left, right) x [top, bottom) intersect scissor.
     size_t                          target_sample_count_;
 	uint64_t						full_mask_;
 	uint64_t						quad_full_mask_;
+	uint32_t						shading_rate_;
+	bool							sample_shading_;
+	bool							tile_buffer_enable_;
+	eflib::vec2 const*				custom_samples_pattern_;
 	vs_output_op const*				vso_ops_;
     bool                            has_centroid_;
     uint32_t                        prim_count_;
+	uint32_t						instance_count_;
 
     async_object*                   pipeline_stat_;
     async_object*                   internal_stat_;
@@ -94,24 +166,23 @@ private:
     accumulate_fn<uint64_t>::type   acc_backend_input_pixels_;
 
 	time_stamp_fn::type				fetch_time_stamp_;
-	accumulate_fn<uint64_t>::type	acc_vp_trans_;
-	accumulate_fn<uint64_t>::type	acc_tri_dispatch_;
 	accumulate_fn<uint64_t>::type	acc_ras_;
 	accumulate_fn<uint64_t>::type	acc_clipping_;
-	accumulate_fn<uint64_t>::type	acc_compact_clip_;
 
 	// Intermediate data
 	prim_type						prim_;
 	uint32_t						prim_size_;
 	eflib::vec2						samples_pattern_[MAX_NUM_MULTI_SAMPLES];
 
-	std::vector<std::vector<std::vector<uint32_t>>>
+	std::vector<std::vector<std::vector<binned_prim>>>
 									threaded_tiled_prims_;		// vector<prim> prims = thread_tiled_prims[ThreadID][TileID]
-	std::vector<triangle_info>		tri_infos_;
+	std::vector<setup_prim_pool>	threaded_setup_prims_;
 
-	vs_output**						clipped_verts_;
-	size_t							clipped_verts_count_;
-	size_t							clipped_prims_count_;
+	// Edges of wireframe triangles.
+	index_fetcher					index_fetcher_;
+	std::vector< std::pair<uint64_t, uint32_t> >
+									wireframe_edges_;
+	std::vector<uint32_t>			wireframe_edge_owners_;
 
 	size_t							tile_x_count_;
 	size_t							tile_y_count_;
@@ -121,12 +192,13 @@ private:
 
 	std::vector<cpp_pixel_shader*>	threaded_cpp_ps_;
 	std::vector<pixel_shader_unit*>	threaded_psu_;
+	std::vector<framebuffer_ptr>	threaded_tile_fbs_;		// Tile framebuffers per thread if tile buffer is enabled.
 
 	boost::function< void (rasterizer*, rasterize_multi_prim_context*)>
 									rasterize_prims_;
 	geom_setup_engine				gse_;
 
-	void threaded_dispatch_primitive(thread_context const*);
+	void dispatch_primitives(geom_setup_package const*);
 	void threaded_rasterize_multi_prim(thread_context const*);
 
 	void draw_full_tile(
@@ -134,8 +206,7 @@ private:
 		drawing_shader_context const* shaders,
 		drawing_triangle_context const* triangle_ctx);
 	void draw_partial_tile(
-		int left0, int top0, int left, int top,
-		const eflib::vec4* edge_factors,
+		int left, int top,
 		drawing_shader_context const* shaders,
         drawing_triangle_context const* triangle_ctx);
 	void subdivide_tile(
@@ -149,15 +220,26 @@ private:
 	void draw_quad(
 		uint32_t left, uint32_t top, uint64_t quad_mask,
 		drawing_shader_context const* shaders, drawing_triangle_context const* triangle_ctx);
+	// Shades quad once per sample. Samples of quad are shaded together as a quad package.
+	void draw_quad_samples(
+		uint32_t left, uint32_t top, uint64_t quad_mask, float const* depth,
+		drawing_shader_context const* shaders, drawing_triangle_context const* triangle_ctx);
+	// Draws 4x4 block with coarse shading. 'quad_masks' are coverage of the 4 quads in block.
+	void draw_coarse_block(
+		uint32_t left, uint32_t top, uint64_t const* quad_masks,
+		drawing_shader_context const* shaders, drawing_triangle_context const* triangle_ctx);
 
-	void viewport_and_project_transform(vs_output** vertexes, size_t num_verts);
-	void compute_triangle_info(uint32_t prim_id);
+	void compute_triangle_info(setup_prim* prim);
+	void compute_line_info(setup_prim* prim);
+	void generate_wireframe_edges();
 
 	void prepare_draw();
 public:
 	//inherited
 	void initialize	(render_stages const* stages);
 	void update		(render_state const* state);
+	// Only index range of draw is changed, such as draws of multi_draw_index.
+	void update_draw_args(render_state const* state);
 
 	//constructor
 	rasterizer();
@@ -35,9 +35,14 @@ private:
     render_state_ptr	state_;
 
 	result	draw();
+	result	multi_draw();
+	void	update_stages();
 	result	clear_color();
 	result	clear_depth_stencil();
+	result	resolve_transparency();
     void    apply_shader_cbuffer();
+	void	resolve_texture_clears();
+	void	update_specialized_shader();
     result  async_start();
     result  async_stop();
 };
@@ -6,11 +6,13 @@
 #include <salviar/include/colors.h>
 #include <salviar/include/format.h>
 #include <salviar/include/viewport.h>
+#include <salviar/include/renderer_capacity.h>
 #include <salviar/include/stream_state.h>
 #include <salviar/include/shader_cbuffer.h>
 
 #include <eflib/include/utility/shared_declaration.h>
 #include <eflib/include/math/vector.h>
+#include <eflib/include/math/collision_detection.h>
 
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/shared_ptr.hpp>
@@ -23,6 +25,7 @@ EFLIB_DECLARE_CLASS_SHARED_PTR(surface);
 EFLIB_DECLARE_CLASS_SHARED_PTR(input_layout);
 EFLIB_DECLARE_CLASS_SHARED_PTR(counter);
 EFLIB_DECLARE_CLASS_SHARED_PTR(depth_stencil_state);
+EFLIB_DECLARE_CLASS_SHARED_PTR(blend_state);
 EFLIB_DECLARE_CLASS_SHARED_PTR(raster_state);
 EFLIB_DECLARE_CLASS_SHARED_PTR(shader_object);
 EFLIB_DECLARE_CLASS_SHARED_PTR(cpp_blend_shader);
@@ -39,12 +42,23 @@ enum class command_id
 {
     draw,
     draw_index,
+    multi_draw_index,
     clear_depth_stencil,
     clear_color,
+    resolve_transparency,
     async_begin,
     async_end
 };
 
+// Record of multi_draw_index. Per-draw constants of the draw are at 'constants_offset' of constant block.
+struct draw_index_args
+{
+	uint32_t					start_index;
+	uint32_t					prim_count;
+	int32_t						base_vertex;
+	uint32_t					constants_offset;
+};
+
 struct render_state
 {
     command_id                  cmd;
@@ -55,16 +69,34 @@ struct render_state
 	int32_t						base_vertex;
 	uint32_t					start_index;
 	uint32_t					prim_count;
+	uint32_t					instance_count;
+	uint32_t					start_instance;
+
+	// Draws of multi_draw_index share all states except index range and per-draw constants.
+	// Constants of draw i are stored at 'per_draw_data[i * per_draw_size]'.
+	std::vector<draw_index_args>
+								multi_draws;
+	eflib::fixed_string			per_draw_var;
+	std::vector<char>			per_draw_data;
+	size_t						per_draw_size;
 
 	stream_state			    str_state;
 	input_layout_ptr			layout;
 
 	viewport					vp;
+	eflib::rect<int32_t>		scissor;
 	raster_state_ptr			ras_state;
 
+	// Custom sample positions in pixel. They are used if count equals to sample count of multi-sampled targets.
+	uint32_t					sample_position_count;
+	eflib::vec2					sample_positions[MAX_SAMPLE_COUNT];
+
 	int32_t						stencil_ref;
 	depth_stencil_state_ptr		ds_state;
 
+	// Fixed-function blending is used if no blend shader is set.
+	blend_state_ptr				blend_state;
+
 	cpp_vertex_shader_ptr		cpp_vs;
 	cpp_pixel_shader_ptr		cpp_ps;
 	cpp_blend_shader_ptr		cpp_bs;
@@ -94,6 +126,8 @@ struct render_state
 	float						clear_z;
 	uint32_t					clear_stencil;
     color_rgba32f				clear_color;
+
+	surface_ptr					oit_resolve_target;
 };
 
 void copy_using_state(render_state* dest, render_state const* src);
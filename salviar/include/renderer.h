@@ -24,6 +24,7 @@ BEGIN_NS_SALVIAR();
 struct shader_profile;
 struct input_element_desc;
 struct mapped_resource;
+struct draw_index_args;
 
 EFLIB_DECLARE_CLASS_SHARED_PTR(renderer);
 EFLIB_DECLARE_CLASS_SHARED_PTR(shader_object);
@@ -80,11 +81,18 @@ public:
     virtual result set_ps_variable( std::string const& name, void const* data, size_t sz ) = 0;
     virtual result set_ps_sampler( std::string const& name, sampler_ptr const& samp ) = 0;
     virtual result set_blend_shader(cpp_blend_shader_ptr const& hbs) = 0;
+    // Blend state is used to write pixels if blend shader is not set.
+    virtual result set_blend_state(blend_state_ptr const& bs) = 0;
     virtual result set_pixel_shader(cpp_pixel_shader_ptr const& hps) = 0;
     virtual result set_pixel_shader_code( shader_object_ptr const& ) = 0;
     virtual result set_depth_stencil_state(depth_stencil_state_ptr const& dss, int32_t stencil_ref) = 0;
     virtual result set_render_targets(size_t color_target_count, surface_ptr const* color_targets, surface_ptr const& ds_target) = 0;
     virtual result set_viewport(viewport const& vp) = 0;
+    // Scissor rect is in pixels of render target. It is used if scissor is enabled by rasterizer state.
+    virtual result set_scissor_rect(eflib::rect<int32_t> const& rc) = 0;
+    // Sample positions are in [0, 1) of pixel and are snapped to 1/16 pixel by rasterizer.
+    // Default pattern is restored if count is 0.
+    virtual result set_sample_positions(size_t count, eflib::vec2 const* positions) = 0;
 
     template <typename T>
     result set_vs_variable( std::string const& name, T const* data )
@@ -107,7 +115,9 @@ public:
     virtual cpp_pixel_shader_ptr    get_pixel_shader() const = 0;
     virtual shader_object_ptr       get_pixel_shader_code() const = 0;
     virtual cpp_blend_shader_ptr    get_blend_shader() const = 0;
+    virtual blend_state_ptr         get_blend_state() const = 0;
     virtual viewport	            get_viewport() const = 0;
+    virtual eflib::rect<int32_t>    get_scissor_rect() const = 0;
 
     //render operations
     virtual result begin(async_object_ptr const& async_obj) = 0;
@@ -116,9 +126,23 @@ public:
 
     virtual result draw(size_t startpos, size_t primcnt) = 0;
     virtual result draw_index(size_t startpos, size_t primcnt, int basevert) = 0;
+    virtual result draw_instanced(size_t startpos, size_t primcnt, size_t instcnt, size_t startinst) = 0;
+    virtual result draw_index_instanced(size_t startpos, size_t primcnt, int basevert, size_t instcnt, size_t startinst) = 0;
+
+    // Draws share states and are submitted together. Per-draw constants are optional and set to vertex shader variable 'per_draw_var'.
+    // Indirect version reads both records and per-draw constants from 'draws'.
+    // Returns invalid_parameter if per-draw constants are used with cpp vertex shader, or records are out of buffer.
+    virtual result multi_draw_indexed(
+        draw_index_args const* draws, size_t draw_count,
+        std::string const& per_draw_var = std::string(), void const* constants = nullptr, size_t constants_size = 0) = 0;
+    virtual result multi_draw_indexed_indirect(
+        buffer_ptr const& draws, size_t offset, size_t draw_count,
+        std::string const& per_draw_var = std::string(), size_t constants_size = 0) = 0;
 
     virtual result clear_color(surface_ptr const& color_target, color_rgba32f const& c) = 0;
     virtual result clear_depth_stencil(surface_ptr const& depth_stencil_target, uint32_t f, float d, uint32_t s) = 0;
+    // Composites fragments which were appended to target by draws with order-independent transparency.
+    virtual result resolve_transparency(surface_ptr const& color_target) = 0;
 
     virtual result flush() = 0;
 };
@@ -69,16 +69,32 @@ public:
 
 	virtual result                  set_blend_shader(cpp_blend_shader_ptr const& hbs);
 	virtual cpp_blend_shader_ptr    get_blend_shader() const;
+	virtual result                  set_blend_state(blend_state_ptr const& bs);
+	virtual blend_state_ptr         get_blend_state() const;
 
 	virtual result                  set_viewport(viewport const& vp);
 	virtual viewport                get_viewport() const;
 
+	virtual result                  set_scissor_rect(eflib::rect<int32_t> const& rc);
+	virtual eflib::rect<int32_t>    get_scissor_rect() const;
+
+	virtual result                  set_sample_positions(size_t count, eflib::vec2 const* positions);
+
 	virtual result                  set_render_targets(size_t color_target_count, surface_ptr const* color_targets, surface_ptr const& ds_target);
 
     virtual result                  draw(size_t startpos, size_t primcnt);
 	virtual result                  draw_index(size_t startpos, size_t primcnt, int basevert);
+    virtual result                  draw_instanced(size_t startpos, size_t primcnt, size_t instcnt, size_t startinst);
+	virtual result                  draw_index_instanced(size_t startpos, size_t primcnt, int basevert, size_t instcnt, size_t startinst);
+    virtual result                  multi_draw_indexed(
+                                        draw_index_args const* draws, size_t draw_count,
+                                        std::string const& per_draw_var, void const* constants, size_t constants_size);
+    virtual result                  multi_draw_indexed_indirect(
+                                        buffer_ptr const& draws, size_t offset, size_t draw_count,
+                                        std::string const& per_draw_var, size_t constants_size);
     virtual result                  clear_color(surface_ptr const& color_target, color_rgba32f const& c);
 	virtual result                  clear_depth_stencil(surface_ptr const& depth_stencil_target, uint32_t f, float d, uint32_t s);
+	virtual result                  resolve_transparency(surface_ptr const& color_target);
     virtual result                  begin(async_object_ptr const& async_obj);
     virtual result                  end(async_object_ptr const& async_obj);
     virtual async_status            get_data(async_object_ptr const& async_obj, void* data, bool do_not_wait);
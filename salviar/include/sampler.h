@@ -78,6 +78,9 @@ private:
 public:
 	explicit sampler(const sampler_desc& desc, texture_ptr const& tex);
 
+	// Sampling doesn't fill cleared tiles. It is called once per draw before texture is sampled.
+	void resolve_clear() const;
+
 	float calc_lod_2d(eflib::vec2 const& ddx, eflib::vec2 const& ddy) const;
 
 	color_rgba32f sample(float coordx, float coordy, float miplevel) const;
@@ -62,6 +62,8 @@ enum system_values
 	sv_target,
 	sv_depth,
 
+	sv_instance_id,
+
 	sv_customized
 };
 
@@ -104,6 +106,8 @@ public:
 			sv = sv_blend_weights;
 		} else if ( lower_name == "psize" ){
 			sv = sv_psize;
+		} else if ( lower_name == "sv_instanceid" ){
+			sv = sv_instance_id;
 		} else {
 			sv = sv_customized;
 			this->name = lower_name;
@@ -265,6 +269,17 @@ public:
 		return result::ok;
 	}
 
+	void resolve_sampler_clears() const
+	{
+		for(auto const& samp: sampmap_)
+		{
+			if(*samp.second)
+			{
+				(*samp.second)->resolve_clear();
+			}
+		}
+	}
+
 	template<class T>
 	result declare_container_constant(const std::_tstring& varname, T& var)
 	{
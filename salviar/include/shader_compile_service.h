@@ -0,0 +1,62 @@
+#ifndef SALVIAR_SHADER_COMPILE_SERVICE_H
+#define SALVIAR_SHADER_COMPILE_SERVICE_H
+
+#include <salviar/include/salviar_forward.h>
+
+#include <salviar/include/shader.h>
+
+#include <eflib/include/utility/shared_declaration.h>
+
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/future.hpp>
+#include <eflib/include/platform/boost_end.h>
+
+#include <string>
+#include <vector>
+
+BEGIN_NS_SALVIAR();
+
+EFLIB_DECLARE_CLASS_SHARED_PTR(shader_object);
+EFLIB_DECLARE_CLASS_SHARED_PTR(shader_compile_service);
+
+// Result is NULL if shader was compiled failed.
+typedef boost::shared_future<shader_object_ptr> shader_object_future;
+
+struct shader_compile_desc
+{
+	shader_compile_desc();
+	shader_compile_desc(std::string const& code_or_file_name, languages lang, bool from_file);
+
+	std::string		code_or_file_name;
+	shader_profile	profile;
+	bool			from_file;
+};
+
+class shader_compile_service
+{
+public:
+	// Shaders are compiled by 'worker_count' background threads.
+	// Zero worker count means half of available hardware threads.
+	static shader_compile_service_ptr create(size_t worker_count = 0);
+
+	// Requests which are same as a pending or finished one share its future instead of being compiled again.
+	// Failed requests are not kept, and a file is compiled again once its content is changed.
+	virtual shader_object_future				compile(shader_compile_desc const& desc) = 0;
+	virtual shader_object_future				compile(std::string const& code, shader_profile const& profile) = 0;
+	virtual shader_object_future				compile_from_file(std::string const& file_name, shader_profile const& profile) = 0;
+
+	// Manifest lists all shader permutations which will be used, and they are compiled before rendering.
+	virtual std::vector<shader_object_future>	precompile(std::vector<shader_compile_desc> const& manifest) = 0;
+	virtual void								wait_all() = 0;
+
+	virtual ~shader_compile_service(){}
+};
+
+// Returned shader behaves as 'fallback' until 'compiled' is ready and succeeded.
+// It could be set to renderer as well as other shaders, and renderer switches to compiled shader at draw.
+shader_object_ptr create_deferred_shader(shader_object_future const& compiled, shader_object_ptr const& fallback);
+
+END_NS_SALVIAR();
+
+#endif
@@ -4,6 +4,7 @@
 #include <salviar/include/salviar_forward.h>
 
 #include <string>
+#include <vector>
 
 BEGIN_NS_SALVIAR();
 
@@ -28,6 +29,18 @@ struct external_function_desc
 	bool		is_raw_name;
 };
 
+// Value of a buffer variable which is folded into shader code as a constant.
+struct specialization_constant_desc
+{
+	specialization_constant_desc(std::string const& name, void const* data, size_t length)
+		: name(name)
+		, value( static_cast<char const*>(data), static_cast<char const*>(data) + length )
+	{
+	}
+	std::string			name;
+	std::vector<char>	value;
+};
+
 END_NS_SALVIAR();
 
 #endif
\ No newline at end of file
@@ -15,6 +15,7 @@
 BEGIN_NS_SALVIAR();
 
 class shader_reflection;
+class shader_cbuffer;
 
 EFLIB_DECLARE_CLASS_SHARED_PTR(shader_log);
 class shader_log
@@ -34,6 +35,13 @@ public:
 	{
 		return reinterpret_cast<FuncPtrT>( native_function() );
 	}
+
+	// Specialization constants are variables which are folded into code instead of being loaded from buffer.
+	// Shader is recompiled when values of them are changed, and compiled shaders are cached by values.
+	virtual void			specialize_variable(std::string const& name) = 0;
+	virtual bool			is_specialized_variable(std::string const& name) const = 0;
+	// Returns shader compiled with current values in cbuffer, or this if no variable is specialized.
+	virtual shader_object*	specialized(shader_cbuffer const& cbuffer) = 0;
 };
 
 END_NS_SALVIAR();
@@ -115,6 +115,13 @@ public:
 		return attribute_data()[index];
 	}
 
+	// Size of vs_output which only stores position and 'num_attributes' attributes.
+	// Verts in pools and caches are stored by this stride, and registers after them are not accessible.
+	static size_t compact_size(size_t num_attributes)
+	{
+		return sizeof(eflib::vec4) * (num_attributes + 1);
+	}
+
 	vs_output()
 	{}
 
@@ -133,14 +140,32 @@ private:
 #pragma warning(disable: 4324)	// warning C4324: Structure was padded due to __declspec(align())
 #endif
 
+// Screen space plane equations of projected registers, r(x, y) = a * x + b * y + c.
+// a, b and c are kept in separate arrays so each can be streamed into SSE registers.
+// Register 0 is position (w holds 1/w); only the first num_attributes + 1 registers are valid.
+struct interpolation_planes
+{
+	EFLIB_ALIGN(16) eflib::vec4	a[MAX_VS_OUTPUT_ATTRS+1];
+	EFLIB_ALIGN(16) eflib::vec4	b[MAX_VS_OUTPUT_ATTRS+1];
+	EFLIB_ALIGN(16) eflib::vec4	c[MAX_VS_OUTPUT_ATTRS+1];
+};
+
 struct triangle_info
 {
 	vs_output const*			v0;
 	bool						front_face;
 	EFLIB_ALIGN(16)	eflib::vec4	bounding_box;
 	EFLIB_ALIGN(16)	eflib::vec4	edge_factors[3];
-	vs_output					ddx;
-	vs_output					ddy;
+
+	// Edge functions in fixed point for coverage test. Vertexes are snapped to 16.8 and
+	// sample is inside edge 'e' if 'fixed_edge_x[e] * x + fixed_edge_y[e] * y >= fixed_edge_threshold[e]',
+	// where x and y are sample positions in 1/16 pixel. Top-left fill rule is folded into threshold.
+	// They are not used if any vertex is out of fixed point range, and 'edge_factors' are tested instead.
+	bool						fixed_edges;
+	EFLIB_ALIGN(16)	int32_t		fixed_edge_x[4];
+	EFLIB_ALIGN(16)	int32_t		fixed_edge_y[4];
+	int64_t						fixed_edge_threshold[3];
+	interpolation_planes		planes;
 
 	triangle_info() {}
 	triangle_info(triangle_info const& /*rhs*/)
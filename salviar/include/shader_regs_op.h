@@ -7,6 +7,7 @@ BEGIN_NS_SALVIAR();
 
 struct viewport;
 class  vs_output;
+struct interpolation_planes;
 
 struct vs_input_op
 {
@@ -33,17 +34,15 @@ namespace vs_output_functions
 	typedef vs_output& (*mul)			(vs_output& out, const vs_output& vso0, float f);
 	typedef vs_output& (*div)			(vs_output& out, const vs_output& vso0, float f);
 
-	typedef void (*compute_derivative)	(vs_output& ddx, vs_output& ddy, vs_output const& e01, vs_output const& e02, float inv_area);
+	typedef void (*compute_planes)		(interpolation_planes& planes, vs_output const& v0, vs_output const& e01, vs_output const& e02, float inv_area);
 
 	typedef vs_output& (*lerp)			(vs_output& out, const vs_output& start, const vs_output& end, float step);
-	typedef vs_output& (*step_2d_unproj)(
-		vs_output& out, vs_output const& start,
-		float step0, vs_output const& derivation0,
-		float step1, vs_output const& derivation1);
-	typedef vs_output& (*step_2d_unproj_quad)(
-		vs_output* out, vs_output const& start,
-		float step0, vs_output const& derivation0,
-		float step1, vs_output const& derivation1);
+
+	// Evaluates planes at (x, y) for one pixel, or at (x, y) and its 2x2 neighbours for a quad.
+	// Quad pixels are written in order (x, y), (x+1, y), (x, y+1), (x+1, y+1).
+	// Attribute evaluation divides by the interpolated w, so position has no input dependency.
+	typedef vs_output& (*interpolate)	(vs_output& out, interpolation_planes const& planes, float x, float y);
+	typedef vs_output* (*interpolate_quad)(vs_output* out, interpolation_planes const& planes, float x, float y);
 }
 
 struct vs_output_op
@@ -60,18 +59,19 @@ struct vs_output_op
 	vs_output_functions::div			div;
 
 	vs_output_functions::lerp			lerp;
-    vs_output_functions::step_2d_unproj	step_2d_unproj_pos;
-    vs_output_functions::step_2d_unproj	step_2d_unproj_attr;
-	vs_output_functions::step_2d_unproj_quad
-										step_2d_unproj_pos_quad;
-	vs_output_functions::step_2d_unproj_quad
-										step_2d_unproj_attr_quad;
+	vs_output_functions::interpolate_quad
+										interpolate_pos_quad;
+	vs_output_functions::interpolate_quad
+										interpolate_attr_quad;
+	vs_output_functions::interpolate	interpolate_attr;
 
-	vs_output_functions::compute_derivative
-										compute_derivative;
+	vs_output_functions::compute_planes	compute_planes;
 
 	typedef boost::array<uint32_t, MAX_VS_OUTPUT_ATTRS> interpolation_modifier_array;
 	interpolation_modifier_array		attribute_modifiers;
+
+	uint32_t							num_attributes;
+	size_t								compact_size;
 };
 
 vs_input_op& get_vs_input_op(uint32_t n);
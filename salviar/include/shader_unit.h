@@ -62,6 +62,11 @@ public:
 
 	aligned_vector stream_odata;
 	aligned_vector buffer_odata;
+
+	// Outputs of pixel data are located by 'initialize', so 'execute' needn't query reflection.
+	// A target output is packed as (index of target << 16) | offset.
+	std::vector<uint32_t> target_outputs;
+	int32_t				  depth_output_offset;	// -1 if shader doesn't output depth.
 };
 
 EFLIB_DECLARE_CLASS_SHARED_PTR(vx_shader_unit);
@@ -71,8 +76,8 @@ public:
 	virtual uint32_t output_attributes_count() const = 0;
 	virtual uint32_t output_attribute_modifiers(size_t index) const = 0;
 
-	virtual void execute(size_t ivert, void* out_data) = 0;
-	virtual void execute(size_t ivert, vs_output& out) = 0;
+	virtual void execute(size_t ivert, size_t iinst, void* out_data) = 0;
+	virtual void execute(size_t ivert, size_t iinst, vs_output& out) = 0;
 
 	virtual ~vx_shader_unit(){}
 };
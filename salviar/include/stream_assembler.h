@@ -39,11 +39,11 @@ public:
 
 	// Used by Cpp Vertex Shader
 	void update_register_map( boost::unordered_map<semantic_value, size_t> const& reg_map );
-	void fetch_vertex(vs_input& vertex, size_t vert_index) const;
+	void fetch_vertex(vs_input& vertex, size_t vert_index, size_t inst_index) const;
 
 	// Used by Old Shader Unit
-	void const* element_address( input_element_desc const&, size_t vert_index ) const;
-	void const* element_address( semantic_value const&, size_t vert_index ) const;
+	void const* element_address( input_element_desc const&, size_t vert_index, size_t inst_index = 0 ) const;
+	void const* element_address( semantic_value const&, size_t vert_index, size_t inst_index = 0 ) const;
 
 	// Used by New Shader Unit
 	virtual std::vector<stream_desc> const& get_stream_descs(std::vector<size_t> const& slots);
@@ -53,11 +53,13 @@ private:
 	std::vector<
 		std::pair<size_t, input_element_desc const*>
 	>							register_to_input_element_desc;
+	size_t						instance_id_register_;
 
 	// Used by new shader unit
 	std::vector<stream_desc>	stream_descs_;
 	input_layout*				layout_;
 	stream_buffer_desc const*	stream_buffer_descs_;	
+	size_t						start_instance_;
 };
 
 END_NS_SALVIAR();
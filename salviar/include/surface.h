@@ -9,6 +9,8 @@
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
 #include <eflib/include/platform/boost_end.h>
 
 #include <vector>
@@ -20,11 +22,21 @@ BEGIN_NS_SALVIAR();
 struct internal_mapped_resource;
 
 class surface;
+class depth_plane_buffer;
+class fragment_list_buffer;
 typedef boost::shared_ptr<surface> surface_ptr;
 
 class surface
 {
 public:
+	// Clear by 'clear' is deferred: clear value is stored and tiles are flagged only.
+	// Flagged tiles are filled when rasterizer writes them first time (see 'fill_cleared_tiles'),
+	// or when whole surface is read or written by map, resolve and fill_texels.
+	// Textures bound to a draw are filled once before the draw (see 'render_core::update_stages'),
+	// sampler doesn't check cleared tiles.
+	// Texel accessors such as get_texel and texel_address don't fill cleared tiles.
+	static int const CLEAR_TILE_SIZE = 64;
+
 	surface();
 	surface(size_t width, size_t height, size_t num_samples, pixel_format pxfmt);
 	~surface();
@@ -81,6 +93,32 @@ public:
 	void		  fill_texels(size_t sx, size_t sy, size_t width, size_t height, const color_rgba32f& color);
     void		  fill_texels(color_rgba32f const& color);
 
+	void		  clear(color_rgba32f const& color);
+	// Fills cleared tiles overlapped with region. Regions of different tiles could be filled concurrently.
+	void		  fill_cleared_tiles(size_t sx, size_t sy, size_t width, size_t height);
+	// Fills all cleared tiles. Content of surface is not changed, so it is a const function.
+	void		  resolve_clear() const;
+
+	// Copies region to 'tile' at (0, 0) for tile-local rendering, and writes it back later.
+	// 'tile' must have same format and sample count. Region must be in one clear tile. If the tile is cleared,
+	// 'tile' is filled by clear value instead. Cleared tile is not cleared any more after written back,
+	// and texels out of region are filled before.
+	void		  read_tile(surface& tile, size_t sx, size_t sy, size_t width, size_t height);
+	void		  write_tile(surface const& tile, size_t sx, size_t sy, size_t width, size_t height);
+
+	// Depth of rg32f depth-stencil surface could be stored as per-tile planes.
+	// Compressed tiles are decompressed by 'resolve_clear' as well as cleared tiles.
+	void		  set_depth_compression(bool enabled);
+	depth_plane_buffer*
+				  depth_planes() const
+	{
+		return depth_planes_.get();
+	}
+
+	// Unresolved fragments of order-independent transparency. Lists are created by first call.
+	fragment_list_buffer*
+				  fragment_lists();
+
 private:
 	int				elem_size_;
 	int				sample_count_;
@@ -89,6 +127,21 @@ private:
 	std::vector<byte, eflib::aligned_allocator<byte, 16>>
 					datas_;
 
+	// Fast clear states.
+	eflib::int4		clear_tile_count_;
+	std::vector<uint8_t>
+					cleared_tiles_;
+	EFLIB_ALIGN(16) uint8_t
+					clear_texel_[4 * 4 * sizeof(float)];
+	mutable boost::atomic<bool>
+					clear_pending_;
+	mutable boost::mutex
+					clear_mutex_;
+	boost::shared_ptr<depth_plane_buffer>
+					depth_planes_;
+	boost::shared_ptr<fragment_list_buffer>
+					fragment_lists_;
+
 #if SALVIA_TILED_SURFACE
 	size_t			tile_width_;
 	size_t			tile_height_;
@@ -96,6 +149,10 @@ private:
 #endif
 
 	size_t texel_offset(size_t x, size_t y, size_t sample) const;
+	void   fill_texels_impl(size_t sx, size_t sy, size_t width, size_t height, void const* texel);
+	// Returns index of cleared tile if region is in the tile, otherwise returns -1.
+	int    cleared_tile_index(size_t sx, size_t sy, size_t width, size_t height) const;
+	void   fill_cleared_tile(size_t tile_x, size_t tile_y);
 
 #if SALVIA_TILED_SURFACE
 	void tile	(internal_mapped_resource const& mapped);
@@ -98,6 +98,15 @@ public:
 	}
 
 	virtual void gen_mipmap(filter_type filter, bool auto_gen) = 0;
+
+	// Fills pending clears of all subresources, so sampling could read texels directly.
+	void resolve_clear() const
+	{
+		for(size_t i = 0; i < surfs_.size(); ++i)
+		{
+			surfs_[i]->resolve_clear();
+		}
+	}
 };
 
 class texture_2d : public texture
@@ -2,6 +2,10 @@
 
 #include <eflib/include/platform/dl_loader.h>
 
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/thread/once.hpp>
+#include <eflib/include/platform/boost_end.h>
+
 using eflib::dynamic_lib;
 
 using boost::shared_ptr;
@@ -26,6 +30,8 @@ namespace modules
 	static void (*create_host_func)(host_ptr& out) = NULL;
 
 	static shared_ptr<dynamic_lib> host_lib;
+	// Shaders could be compiled by several threads, such as workers of shader compile service.
+	static boost::once_flag host_lib_once = BOOST_ONCE_INIT;
 
 	static void load_function()
 	{
@@ -61,10 +67,7 @@ namespace modules
 		string const& code, shader_profile const& prof,
 		vector<external_function_desc> const& funcs )
 	{
-		if(!compile_func)
-		{
-			load_function();
-		}
+		boost::call_once(host_lib_once, load_function);
 		assert(compile_func);
 
 		if(!compile_func) return;
@@ -76,10 +79,7 @@ namespace modules
 		string const& file_name, shader_profile const& prof,
 		vector<external_function_desc> const& funcs )
 	{
-		if(!compile_from_file_func)
-		{
-			load_function();
-		}
+		boost::call_once(host_lib_once, load_function);
 		assert(compile_from_file_func);
 
 		if(!compile_from_file_func) return;
@@ -90,10 +90,7 @@ namespace modules
 	{
 		host_ptr ret;
 
-		if(!create_host_func)
-		{
-			load_function();
-		}
+		boost::call_once(host_lib_once, load_function);
 		assert(create_host_func);
 
 		if (create_host_func)
@@ -5,6 +5,7 @@
 #include <salviar/include/shader.h>
 
 #include <eflib/include/memory/pool.h>
+#include <eflib/include/platform/intrin.h>
 
 #include <algorithm>
 
@@ -37,13 +38,77 @@ void clipper::set_context(clip_context const* ctxt)
 	case pt_solid_tri:
 		clip_impl_ = &clipper::clip_solid_triangle;
 		break;
+	case pt_line:
+	case pt_wireframe_tri:
+		clip_impl_ = &clipper::clip_line;
+		break;
 	default:
 		EFLIB_ASSERT_UNIMPLEMENTED();
 	}
 }
 
-void clipper::clip_wireframe_triangle(vs_output** /*tri_verts*/, clip_results* /*results*/)
+void clipper::clip_line(vs_output** line_verts, clip_results* results)
 {
+	results->num_clipped_verts = 0;
+	results->is_front = true;
+	results->is_clipped = false;
+
+	vec4 const& pos0 = line_verts[0]->position();
+	vec4 const& pos1 = line_verts[1]->position();
+
+	// Reject line if both verts are out of same side plane.
+	if(	( pos0.x() < -pos0.w() && pos1.x() < -pos1.w() ) || ( pos0.x() > pos0.w() && pos1.x() > pos1.w() )
+	||	( pos0.y() < -pos0.w() && pos1.y() < -pos1.w() ) || ( pos0.y() > pos0.w() && pos1.y() > pos1.w() ) )
+	{
+		return;
+	}
+
+	// Clip parametric range of line by near and far plane.
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+	for(size_t i_plane = 0; i_plane < planes_.size(); ++i_plane)
+	{
+		float const d0 = dot_prod4(planes_[i_plane], pos0);
+		float const d1 = dot_prod4(planes_[i_plane], pos1);
+
+		if(d0 < 0.0f && d1 < 0.0f)
+		{
+			return;
+		}
+
+		if(d0 < 0.0f)
+		{
+			t0 = std::max(t0, d0 / (d0 - d1));
+		}
+		else if(d1 < 0.0f)
+		{
+			t1 = std::min(t1, d0 / (d0 - d1));
+		}
+	}
+
+	if(t0 >= t1)
+	{
+		return;
+	}
+
+	results->clipped_verts[0] = line_verts[0];
+	results->clipped_verts[1] = line_verts[1];
+
+	if(t0 > 0.0f)
+	{
+		results->clipped_verts[0] = ctxt_.vert_pool->alloc();
+		ctxt_.vso_ops->lerp(*results->clipped_verts[0], *line_verts[0], *line_verts[1], t0);
+		results->is_clipped = true;
+	}
+
+	if(t1 < 1.0f)
+	{
+		results->clipped_verts[1] = ctxt_.vert_pool->alloc();
+		ctxt_.vso_ops->lerp(*results->clipped_verts[1], *line_verts[0], *line_verts[1], t1);
+		results->is_clipped = true;
+	}
+
+	results->num_clipped_verts = 2;
 }
 
 void clipper::clip_solid_triangle(vs_output** tri_verts, clip_results* results)
@@ -85,7 +150,7 @@ void clipper::clip_solid_triangle(vs_output** tri_verts, clip_results* results)
 	results->is_front = tri_clip_results.is_front;
 
 	vs_output** clipped_cursor = results->clipped_verts;
-	for(size_t i_tri = 1; i_tri < results->num_clipped_verts-1; ++i_tri)
+	for(size_t i_tri = 1; i_tri < tri_clip_results.num_clipped_verts-1; ++i_tri)
 	{
 		*(clipped_cursor+0) = tri_clipped_verts[0];
 		if (results->is_front)
@@ -102,6 +167,134 @@ void clipper::clip_solid_triangle(vs_output** tri_verts, clip_results* results)
 	}
 }
 
+void clipper::clip_packet(vs_output** tri_verts, uint32_t tri_count, clip_results* results, uint32_t* clipped_verts_count)
+{
+	assert(0 < tri_count && tri_count <= CLIP_PACKET_SIZE);
+
+	if(ctxt_.prim != pt_solid_tri)
+	{
+		results->num_clipped_verts = 0;
+		for(uint32_t i_tri = 0; i_tri < tri_count; ++i_tri)
+		{
+			clip_results tri_results;
+			tri_results.clipped_verts = results->clipped_verts + results->num_clipped_verts;
+			clip(tri_verts + i_tri * 3, &tri_results);
+			clipped_verts_count[i_tri] = tri_results.num_clipped_verts;
+			results->is_front = tri_results.is_front;
+			results->num_clipped_verts += tri_results.num_clipped_verts;
+		}
+		return;
+	}
+
+	// Load positions as SoA. Lanes of unused triangles are filled by last triangle.
+	__m128 xs[3], ys[3], zs[3], ws[3];
+	for(int i_vert = 0; i_vert < 3; ++i_vert)
+	{
+		__m128 pos[CLIP_PACKET_SIZE];
+		for(uint32_t i_tri = 0; i_tri < CLIP_PACKET_SIZE; ++i_tri)
+		{
+			uint32_t src_tri = std::min(i_tri, tri_count - 1);
+			pos[i_tri] = _mm_loadu_ps( &tri_verts[src_tri*3+i_vert]->position().x() );
+		}
+		_MM_TRANSPOSE4_PS(pos[0], pos[1], pos[2], pos[3]);
+		xs[i_vert] = pos[0];
+		ys[i_vert] = pos[1];
+		zs[i_vert] = pos[2];
+		ws[i_vert] = pos[3];
+	}
+
+	// Outcodes. Triangle is rejected if all verts are outside of same plane,
+	// and it must be clipped if it is not rejected and any vert is out of near or far plane.
+	__m128 const zero = _mm_setzero_ps();
+	__m128 out_all[6];
+	__m128 out_near_far = zero;
+	for(int i_vert = 0; i_vert < 3; ++i_vert)
+	{
+		__m128 neg_w = _mm_sub_ps(zero, ws[i_vert]);
+		__m128 out_vert[6] =
+		{
+			_mm_cmplt_ps(zs[i_vert], zero),
+			_mm_cmpgt_ps(zs[i_vert], ws[i_vert]),
+			_mm_cmplt_ps(xs[i_vert], neg_w),
+			_mm_cmpgt_ps(xs[i_vert], ws[i_vert]),
+			_mm_cmplt_ps(ys[i_vert], neg_w),
+			_mm_cmpgt_ps(ys[i_vert], ws[i_vert])
+		};
+		for(int i_plane = 0; i_plane < 6; ++i_plane)
+		{
+			out_all[i_plane] = (i_vert == 0) ? out_vert[i_plane] : _mm_and_ps(out_all[i_plane], out_vert[i_plane]);
+		}
+		out_near_far = _mm_or_ps( out_near_far, _mm_or_ps(out_vert[0], out_vert[1]) );
+	}
+
+	__m128 rejected = out_all[0];
+	for(int i_plane = 1; i_plane < 6; ++i_plane)
+	{
+		rejected = _mm_or_ps(rejected, out_all[i_plane]);
+	}
+
+	// Signed area in screen space. It is only valid for verts which are in front of near plane.
+	__m128 sx[3], sy[3];
+	for(int i_vert = 0; i_vert < 3; ++i_vert)
+	{
+		__m128 inv_w = _mm_div_ps( _mm_set1_ps(1.0f), ws[i_vert] );
+		sx[i_vert] = _mm_mul_ps(xs[i_vert], inv_w);
+		sy[i_vert] = _mm_mul_ps(ys[i_vert], inv_w);
+	}
+	__m128 area = _mm_sub_ps(
+		_mm_mul_ps( _mm_sub_ps(sx[2], sx[0]), _mm_sub_ps(sy[1], sy[0]) ),
+		_mm_mul_ps( _mm_sub_ps(sy[2], sy[0]), _mm_sub_ps(sx[1], sx[0]) )
+		);
+
+	// Zero area triangles which are not clipped cover no pixel.
+	rejected = _mm_or_ps( rejected, _mm_andnot_ps(out_near_far, _mm_cmpeq_ps(area, zero)) );
+
+	int const rejected_mask	= _mm_movemask_ps(rejected);
+	int const clipping_mask	= _mm_movemask_ps(out_near_far) & ~rejected_mask;
+
+	EFLIB_ALIGN(16) float areas[CLIP_PACKET_SIZE];
+	_mm_store_ps(areas, area);
+
+	results->num_clipped_verts = 0;
+	for(uint32_t i_tri = 0; i_tri < tri_count; ++i_tri)
+	{
+		int const tri_bit = 1 << i_tri;
+		clipped_verts_count[i_tri] = 0;
+		results->is_front = areas[i_tri] > 0.0f;
+		if(rejected_mask & tri_bit)
+		{
+			continue;
+		}
+
+		vs_output** tri = tri_verts + i_tri * 3;
+		vs_output** out_verts = results->clipped_verts + results->num_clipped_verts;
+
+		if(clipping_mask & tri_bit)
+		{
+			clip_results tri_results;
+			tri_results.clipped_verts = out_verts;
+			clip_solid_triangle(tri, &tri_results);
+			clipped_verts_count[i_tri] = tri_results.num_clipped_verts;
+			results->is_front = tri_results.is_front;
+			results->num_clipped_verts += tri_results.num_clipped_verts;
+			continue;
+		}
+
+		// Trivially accepted.
+		if( ctxt_.cull(areas[i_tri]) )
+		{
+			continue;
+		}
+
+		int offset = results->is_front ? 0 : 1;
+		out_verts[0] = tri[0];
+		out_verts[1] = tri[1+offset];
+		out_verts[2] = tri[2-offset];
+		clipped_verts_count[i_tri] = 3;
+		results->num_clipped_verts += 3;
+	}
+}
+
 inline bool compute_front(vec4 const& pos0, vec4 const& pos1, vec4 const& pos2)
 {
 	vec2 pv_2d[3] =
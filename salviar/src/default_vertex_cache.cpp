@@ -8,6 +8,7 @@
 #include <salviar/include/shader_regs_op.h>
 #include <salviar/include/sync_renderer.h>
 #include <salviar/include/render_state.h>
+#include <salviar/include/raster_state.h>
 #include <salviar/include/stream_assembler.h>
 #include <salviar/include/thread_context.h>
 #include <salviar/include/async_object.h>
@@ -50,7 +51,7 @@ class vertex_cache_impl: public vertex_cache
 public:
 	vertex_cache_impl()
 		: assembler_(nullptr), host_(nullptr)
-		, prim_count_(0), prim_size_(0)
+		, prim_count_(0), instance_count_(0), prim_size_(0), max_fetched_verts_per_prim_(0)
 		, cpp_vs_(nullptr)
 		, pipeline_stat_(nullptr), pipeline_prof_(nullptr)
 		, fetch_time_stamp_(nullptr)
@@ -69,9 +70,8 @@ public:
 	void update(render_state const* state)
 	{
 		// transformed_verts_.reset();
-		index_fetcher_.update(state);
+		update_draw_args(state);
 		cpp_vs_		= state->cpp_vs.get();
-        prim_count_ = state->prim_count;
 
 		prim_size_ = 0;
 		switch(state->prim_topo)
@@ -87,6 +87,10 @@ public:
 			break;
 		}
 
+		// A wireframe triangle may fetch its neighbours to find out which one draws the shared edge.
+		bool const is_wireframe_tri = (3 == prim_size_) && state->ras_state && (state->ras_state->get_desc().fm == fill_wireframe);
+		max_fetched_verts_per_prim_ = is_wireframe_tri ? prim_size_ * 4 : prim_size_;
+
         pipeline_stat_ = state->asyncs[static_cast<uint32_t>(async_object_ids::pipeline_statistics)].get();
 		pipeline_prof_ = state->asyncs[static_cast<uint32_t>(async_object_ids::pipeline_profiles)].get();
 
@@ -115,12 +119,41 @@ public:
 		}
 	}
 
+	void update_draw_args(render_state const* state)
+	{
+		index_fetcher_.update(state);
+        prim_count_ = state->prim_count;
+		instance_count_ = state->instance_count;
+	}
+
 protected:
+	// Primitives of all instances are fetched by one pass. Id of primitive is 'instance * prim_count_ + primitive in instance'.
+	uint32_t split_prim_id(cache_entry_index prim, uint32_t& prim_in_inst) const
+	{
+		uint32_t const inst = static_cast<uint32_t>(prim / prim_count_);
+		prim_in_inst = static_cast<uint32_t>(prim - static_cast<cache_entry_index>(inst) * prim_count_);
+		return inst;
+	}
+
+	static uint64_t vertex_key(uint32_t inst, uint32_t index)
+	{
+		return (static_cast<uint64_t>(inst) << 32) | index;
+	}
+
+	// Verts are stored compactly by count of output attributes of vertex shader.
+	size_t compact_vs_output_size() const
+	{
+		size_t num_attrs = cpp_vs_ ? cpp_vs_->num_output_attributes() : host_->vs_output_attr_count();
+		return vs_output::compact_size(num_attrs);
+	}
+
 	stream_assembler*		assembler_;
 	host*					host_;
 
     uint32_t                prim_count_;
+	uint32_t				instance_count_;
 	uint32_t				prim_size_;
+	uint32_t				max_fetched_verts_per_prim_;
 	cpp_vertex_shader*		cpp_vs_;
 
 	index_fetcher			index_fetcher_;
@@ -146,7 +179,7 @@ class precomputed_vertex_cache : public vertex_cache_impl
 {
 public:
 	precomputed_vertex_cache()
-		: transformed_verts_capacity_ (0)
+		: transformed_verts_base_(nullptr), vso_size_(0), verts_count_(0)
 	{
 	}
 
@@ -179,25 +212,22 @@ public:
 		unique_indices_.erase(std::unique(unique_indices_.begin(), unique_indices_.end()), unique_indices_.end());
 
 		verts_count = static_cast<uint32_t>( unique_indices_.size() );
-		if( transformed_verts_capacity_ < unique_indices_.size() )
-		{
-			transformed_verts_.reset(new vs_output[unique_indices_.size()]);
-			transformed_verts_capacity_ = unique_indices_.size();
-		}
-		
 		used_verts_.resize( unique_indices_.back()+1 );
 #else
 		uint32_t verts_count = max_index - min_index_ + 1;
-		if(transformed_verts_capacity_ < verts_count)
-		{
-			transformed_verts_.reset(new vs_output[verts_count]);
-			transformed_verts_capacity_ = verts_count;
-		}
 #endif
+		// Indices are shared by all instances, and verts of each instance are stored as a contiguous block.
+		verts_count_ = verts_count;
+		uint32_t const inst_verts_count = verts_count * instance_count_;
+
+		vso_size_ = compact_vs_output_size();
+		transformed_verts_.clear();
+		transformed_verts_.reserve(inst_verts_count, 16, vso_size_);
+		transformed_verts_base_ = transformed_verts_.alloc(inst_verts_count);
 
         // Accumulate query counters.
-        acc_ia_vertices_( pipeline_stat_, static_cast<uint64_t>(prim_count_*prim_size_) );
-        acc_vs_invocations_( pipeline_stat_, static_cast<uint64_t>(verts_count) );
+        acc_ia_vertices_( pipeline_stat_, static_cast<uint64_t>(prim_count_) * prim_size_ * instance_count_ );
+        acc_vs_invocations_( pipeline_stat_, static_cast<uint64_t>(inst_verts_count) );
 		acc_gather_vtx_(pipeline_prof_, fetch_time_stamp_() - gather_vtx_start_time);
 
 		// Transform vertexes
@@ -209,7 +239,7 @@ public:
 			{
 				this->transform_vertex_cppvs(thread_ctx);
 			};
-			execute_threads(execute_vert_shader, verts_count, TRANSFORM_VERTEX_PACKAGE_SIZE);
+			execute_threads(execute_vert_shader, inst_verts_count, TRANSFORM_VERTEX_PACKAGE_SIZE);
 		}
 		else
 		{
@@ -217,34 +247,35 @@ public:
 			{
 				this->transform_vertex_vs(thread_ctx);
 			};
-			execute_threads(execute_vert_shader, verts_count, TRANSFORM_VERTEX_PACKAGE_SIZE);
+			execute_threads(execute_vert_shader, inst_verts_count, TRANSFORM_VERTEX_PACKAGE_SIZE);
 		}
 
 		acc_vtx_proc_(pipeline_prof_, fetch_time_stamp_() - vtx_proc_start_time);
 	}
 
-	void fetch3(vs_output** v, cache_entry_index prim, uint32_t /*thread_id*/)
+	void fetch(vs_output** v, cache_entry_index prim, uint32_t /*thread_id*/)
 	{
-		static vs_output null_obj;
-		uint32_t id0 = indices_[prim*3+0];
-		uint32_t id1 = indices_[prim*3+1];
-		uint32_t id2 = indices_[prim*3+2];
+		uint32_t prim_in_inst;
+		uint32_t const inst = split_prim_id(prim, prim_in_inst);
+		size_t const inst_base = static_cast<size_t>(inst) * verts_count_;
+
+		for(uint32_t i = 0; i < prim_size_; ++i)
+		{
+			uint32_t id = indices_[prim_in_inst*prim_size_+i];
 #if !USE_INDEX_RANGE
-		
+
 #if defined(EFLIB_DEBUG)
-		if((id2 > used_verts_.size()) || (-1 == used_verts_[id0]) || (-1 == used_verts_[id1]) || (-1 == used_verts_[id2]))
-		{
-			assert( !"The vertex could not be transformed. Maybe errors occurred on index statistics or vertex tranformation." );
-			// return null_obj;
-		}
+			if( (id >= used_verts_.size()) || (-1 == used_verts_[id]) )
+			{
+				assert( !"The vertex could not be transformed. Maybe errors occurred on index statistics or vertex tranformation." );
+			}
 #endif
 
-		v[0] = &transformed_verts_[used_verts_[id0]];
-		v[1] = &transformed_verts_[used_verts_[id1]];
-		v[2] = &transformed_verts_[used_verts_[id2]];
+			v[i] = &transformed_vert(inst_base + used_verts_[id]);
 #else
-		return transformed_verts_[id - min_index_];
+			v[i] = &transformed_vert(inst_base + id - min_index_);
 #endif
+		}
 	}
 
 	void update_statistic()
@@ -252,6 +283,11 @@ public:
 		// do nothing
 	}
 private:
+	vs_output& transformed_vert(size_t i)
+	{
+		return *eflib::advance_bytes(transformed_verts_base_, vso_size_ * i);
+	}
+
 	void generate_indices(thread_context const* thread_ctx)
 	{
 		// Fetch indexes and min/max of package
@@ -298,11 +334,13 @@ private:
 			auto vert_range = current_package.item_range();
 			for(auto i = vert_range.first; i < vert_range.second; ++i)
 			{
-				uint32_t id = unique_indices_[i];
-				used_verts_[id] = i;
+				uint32_t const inst = i / verts_count_;
+				uint32_t const vert = i - inst * verts_count_;
+				uint32_t id = unique_indices_[vert];
+				if(inst == 0) { used_verts_[id] = vert; }
 				vs_input vertex;
-				assembler_->fetch_vertex(vertex, id);
-				cpp_vs_->execute(vertex, transformed_verts_[i]);
+				assembler_->fetch_vertex(vertex, id, inst);
+				cpp_vs_->execute(vertex, transformed_vert(i));
 			}
 			current_package = thread_ctx->next_package();
 		}
@@ -318,9 +356,11 @@ private:
 			auto vert_range = current_package.item_range();
 			for(auto i = vert_range.first; i < vert_range.second; ++i)
 			{
-				uint32_t vert_index = unique_indices_[i];
-				used_verts_[vert_index] = i;
-				vsu->execute(vert_index, transformed_verts_[i]);
+				uint32_t const inst = i / verts_count_;
+				uint32_t const vert = i - inst * verts_count_;
+				uint32_t vert_index = unique_indices_[vert];
+				if(inst == 0) { used_verts_[vert_index] = vert; }
+				vsu->execute(vert_index, inst, transformed_vert(i));
 			}
 			current_package = thread_ctx->next_package();
 		}
@@ -334,9 +374,10 @@ private:
 			auto vert_range = current_package.item_range();
 			for(auto i = vert_range.first; i < vert_range.second; ++i)
 			{
+				uint32_t const inst = i / verts_count_;
 				vs_input vertex;
-				assembler_->fetch_vertex(vertex, i + min_index_);
-				cpp_vs_->execute(vertex, transformed_verts_[i]);
+				assembler_->fetch_vertex(vertex, i - inst * verts_count_ + min_index_, inst);
+				cpp_vs_->execute(vertex, transformed_vert(i));
 			}
 			current_package = thread_ctx->next_package();
 		}
@@ -351,7 +392,8 @@ private:
 			auto vert_range = current_package.item_range();
 			for(auto i = vert_range.first; i < vert_range.second; ++i)
 			{
-				vsu->execute(i + min_index_, transformed_verts_[i]);
+				uint32_t const inst = i / verts_count_;
+				vsu->execute(i - inst * verts_count_ + min_index_, inst, transformed_vert(i));
 			}
 			current_package = thread_ctx->next_package();
 		}
@@ -362,8 +404,12 @@ private:
 	vector<uint32_t>		indices_;
 	vector<uint32_t>		unique_indices_;
 
-	shared_array<vs_output> transformed_verts_;
-	size_t					transformed_verts_capacity_;
+	// Verts are allocated as a contiguous block with compact stride.
+	eflib::pool::reserved_pool<vs_output>
+							transformed_verts_;
+	vs_output*				transformed_verts_base_;
+	size_t					vso_size_;
+	uint32_t				verts_count_;	// Transformed verts per instance.
 
 	vector<int32_t>			used_verts_;
 
@@ -380,14 +426,16 @@ public:
 
 	void prepare_vertices()
 	{
+		size_t const vso_size = compact_vs_output_size();
+
 		for(uint32_t i = 0; i < num_available_threads(); ++i)
 		{
 			auto& cache = caches_[i];
 			cache.vso_pool.clear();
-			cache.vso_pool.reserve(prim_count_ * prim_size_, 16);
+			cache.vso_pool.reserve(prim_count_ * instance_count_ * max_fetched_verts_per_prim_, 16, vso_size);
 			for(int j = 0; j < ENTRY_SIZE; ++j)
 			{
-				cache.items[j] = std::make_pair(std::numeric_limits<uint32_t>::max(), nullptr);
+				cache.items[j] = std::make_pair(std::numeric_limits<uint64_t>::max(), nullptr);
 			}
 			if(host_) cache.vsu = host_->get_vx_shader_unit();
 			cache.ia_vertices = 0;
@@ -396,24 +444,28 @@ public:
 		}
 	}
 	
-	void fetch3(vs_output** v, cache_entry_index prim, uint32_t thread_id)
+	void fetch(vs_output** v, cache_entry_index prim, uint32_t thread_id)
 	{
 		// uint64_t vs_start_time = fetch_time_stamp_();
 
+		uint32_t prim_in_inst;
+		uint32_t const inst = split_prim_id(prim, prim_in_inst);
+
 		uint32_t indexes[3];
 		uint32_t min_index, max_index;
-		index_fetcher_.fetch_indexes(indexes, &min_index, &max_index, prim, prim+1);
+		index_fetcher_.fetch_indexes(indexes, &min_index, &max_index, prim_in_inst, prim_in_inst+1);
 
 		auto& cache = caches_[thread_id];
 
-		cache.ia_vertices += 3;
+		cache.ia_vertices += prim_size_;
 
-		for(int i = 0; i < 3; ++i)
+		for(uint32_t i = 0; i < prim_size_; ++i)
 		{
 			uint32_t index = indexes[i];
-			uint32_t key = indexes[i] % ENTRY_SIZE;
+			uint64_t vert_key = vertex_key(inst, index);
+			uint32_t key = index % ENTRY_SIZE;
 			auto& cache_item = cache.items[key];
-			if(cache_item.first == indexes[i])
+			if(cache_item.first == vert_key)
 			{
 				v[i] = cache_item.second;
 			}
@@ -426,15 +478,15 @@ public:
 				if(cpp_vs_)
 				{
 					vs_input vertex;
-					assembler_->fetch_vertex(vertex, index);
+					assembler_->fetch_vertex(vertex, index, inst);
 					cpp_vs_->execute(vertex, *ret);
 				}
 				else
 				{
-					cache.vsu->execute(index, *ret);
+					cache.vsu->execute(index, inst, *ret);
 				}
 
-				cache_item = std::make_pair(index, ret);
+				cache_item = std::make_pair(vert_key, ret);
 				v[i] = ret;
 			}
 		}
@@ -473,7 +525,7 @@ private:
 		uint64_t								ia_vertices;
 		uint64_t								vs_during;
 
-		std::pair<uint32_t, vs_output*>			items[ENTRY_SIZE];
+		std::pair<uint64_t, vs_output*>			items[ENTRY_SIZE];
 	};
 
 	std::vector<
@@ -499,16 +551,18 @@ public:
 	}
 	void prepare_vertices()
 	{
-		memset(shared_items_, INVALID_SHARED_ENTRY, sizeof(shared_items_));
+		memset(shared_items_, 0xFF, sizeof(shared_items_));	// All entries are INVALID_SHARED_ENTRY.
+
+		size_t const vso_size = compact_vs_output_size();
 
 		for(uint32_t i = 0; i < num_available_threads(); ++i)
 		{
 			auto& cache = caches_[i];
 			cache.vso_pool.clear();
-			cache.vso_pool.reserve(prim_count_ * prim_size_, 16);
+			cache.vso_pool.reserve(prim_count_ * instance_count_ * max_fetched_verts_per_prim_, 16, vso_size);
 			for(int j = 0; j < ENTRY_SIZE; ++j)
 			{
-				cache.items[j] = std::make_pair(std::numeric_limits<uint32_t>::max(), nullptr);
+				cache.items[j] = std::make_pair(std::numeric_limits<uint64_t>::max(), nullptr);
 			}
 			if(host_) cache.vsu = host_->get_vx_shader_unit();
 			cache.ia_vertices = 0;
@@ -520,9 +574,9 @@ public:
 		}
 	}
 	
-	inline uint32_t lock_shared_item(uint32_t& conflict_count, std::pair<std::atomic<uint32_t>, vs_output*>& item)
+	inline uint64_t lock_shared_item(uint32_t& conflict_count, std::pair<std::atomic<uint64_t>, vs_output*>& item)
 	{
-		uint32_t index_in_cache;
+		uint64_t index_in_cache;
 				
 		for(;;)
 		{	
@@ -541,30 +595,34 @@ public:
 		}
 	}
 	
-	inline void release_shared_item(std::pair<std::atomic<uint32_t>, vs_output*>& item, uint32_t index)
+	inline void release_shared_item(std::pair<std::atomic<uint64_t>, vs_output*>& item, uint64_t index)
 	{
 		item.first = index;
 	}
 
 
-	void fetch3(vs_output** v, cache_entry_index prim, uint32_t thread_id)
+	void fetch(vs_output** v, cache_entry_index prim, uint32_t thread_id)
 	{
 		// uint64_t vs_start_time = fetch_time_stamp_();
 
+		uint32_t prim_in_inst;
+		uint32_t const inst = split_prim_id(prim, prim_in_inst);
+
 		uint32_t indexes[3];
 		uint32_t min_index, max_index;
-		index_fetcher_.fetch_indexes(indexes, &min_index, &max_index, prim, prim+1);
+		index_fetcher_.fetch_indexes(indexes, &min_index, &max_index, prim_in_inst, prim_in_inst+1);
 
 		auto& cache = caches_[thread_id];
 
-		cache.ia_vertices += 3;
+		cache.ia_vertices += prim_size_;
 
-		for(int i = 0; i < 3; ++i)
+		for(uint32_t i = 0; i < prim_size_; ++i)
 		{
 			uint32_t index = indexes[i];
-			uint32_t key = indexes[i] % ENTRY_SIZE;
+			uint64_t vert_key = vertex_key(inst, index);
+			uint32_t key = index % ENTRY_SIZE;
 			auto& cache_item = cache.items[key];
-			if(cache_item.first == indexes[i])
+			if(cache_item.first == vert_key)
 			{
 				v[i] = cache_item.second;
 			}
@@ -572,12 +630,12 @@ public:
 			{
 				uint32_t sc_key = index % SHARED_ENTRY_SIZE;
 				auto& shared_item = shared_items_[sc_key];
-				uint32_t index_in_cache = lock_shared_item(cache.conflict_count, shared_item);
+				uint64_t index_in_cache = lock_shared_item(cache.conflict_count, shared_item);
 
-				if(index_in_cache == index)
+				if(index_in_cache == vert_key)
 				{
-					cache_item = std::make_pair(index, shared_item.second);
-					release_shared_item(shared_item, index);
+					cache_item = std::make_pair(vert_key, shared_item.second);
+					release_shared_item(shared_item, vert_key);
 
 					v[i] = cache_item.second;
 					++cache.l2_hitting;
@@ -597,20 +655,20 @@ public:
 					if(cpp_vs_)
 					{
 						vs_input vertex;
-						assembler_->fetch_vertex(vertex, index);
+						assembler_->fetch_vertex(vertex, index, inst);
 						cpp_vs_->execute(vertex, *ret);
 					}
 					else
 					{
-						cache.vsu->execute(index, *ret);
+						cache.vsu->execute(index, inst, *ret);
 					}
 
-					cache_item = std::make_pair(index, ret);
+					cache_item = std::make_pair(vert_key, ret);
 					v[i] = ret;
 
 					lock_shared_item(cache.conflict_count, shared_item);
 					shared_items_[sc_key].second = ret;
-					release_shared_item(shared_item, index);
+					release_shared_item(shared_item, vert_key);
 				}
 			}
 		}
@@ -641,8 +699,8 @@ public:
 private:
 	static int const		SHARED_ENTRY_SIZE = 1024;
 	static int const		ENTRY_SIZE = 32;
-	static uint32_t const	SHARED_ENTRY_IS_USING = 0xFFFFFFFEU;
-	static uint32_t const	INVALID_SHARED_ENTRY  = 0xFFFFFFFFU;
+	static uint64_t const	SHARED_ENTRY_IS_USING = 0xFFFFFFFFFFFFFFFEULL;
+	static uint64_t const	INVALID_SHARED_ENTRY  = 0xFFFFFFFFFFFFFFFFULL;
 	
 	struct EFLIB_ALIGN(64) thread_cache
 	{
@@ -660,7 +718,7 @@ private:
 		uint64_t								ia_vertices;
 		uint64_t								vs_during;
 
-		std::pair<uint32_t, vs_output*>			items[ENTRY_SIZE];
+		std::pair<uint64_t, vs_output*>			items[ENTRY_SIZE];
 	};
 
 	uint32_t				conflict_count_;
@@ -671,7 +729,7 @@ private:
 		thread_cache,
 		eflib::aligned_allocator<thread_cache, 64>
 	>						caches_;
-	std::pair<std::atomic<uint32_t>, vs_output*>
+	std::pair<std::atomic<uint64_t>, vs_output*>
 							shared_items_[SHARED_ENTRY_SIZE];
 };
 
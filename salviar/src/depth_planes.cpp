@@ -0,0 +1,353 @@
+#include <salviar/include/depth_planes.h>
+#include <salviar/include/surface.h>
+#include <salviar/include/renderer_capacity.h>
+
+#include <eflib/include/diagnostics/assert.h>
+
+#include <algorithm>
+#include <memory.h>
+
+BEGIN_NS_SALVIAR();
+
+size_t const TILE_BITS = 3;
+size_t const TILE_MASK = depth_plane_buffer::TILE_SIZE - 1;
+
+bool depth_plane::operator == (depth_plane const& rhs) const
+{
+	return memcmp(this, &rhs, sizeof(depth_plane)) == 0;
+}
+
+// Pixels of quad are mapped to bit 0, 1, TILE_SIZE and TILE_SIZE+1 of tile selection mask.
+static uint32_t quad_lanes(uint64_t tile_bits, uint32_t quad_shift)
+{
+	uint32_t bits = static_cast<uint32_t>(tile_bits >> quad_shift);
+	return (bits & 0x3) | ( (bits >> (depth_plane_buffer::TILE_SIZE - 2)) & 0xC );
+}
+
+static uint64_t tile_bits(uint32_t lanes, uint32_t quad_shift)
+{
+	uint64_t bits = (lanes & 0x3) | ( static_cast<uint64_t>(lanes & 0xC) << (depth_plane_buffer::TILE_SIZE - 2) );
+	return bits << quad_shift;
+}
+
+#if !defined(EFLIB_NO_SIMD)
+// Same instructions as interpolate_pos_quad, so the result is bit-exact with rasterizer.
+static __m128 quad_depth(depth_plane const& plane, size_t qx, size_t qy)
+{
+	float const x = 0.5f + qx;
+	float const y = 0.5f + qy;
+
+	__m128 d00 = _mm_add_ss(
+		_mm_set_ss(plane.c),
+		_mm_add_ss( _mm_mul_ss(_mm_set_ss(plane.a), _mm_set_ss(x)), _mm_mul_ss(_mm_set_ss(plane.b), _mm_set_ss(y)) )
+		);
+	d00 = _mm_shuffle_ps(d00, d00, _MM_SHUFFLE(0, 0, 0, 0));
+
+	// d01 = d00 + a, d10 = d00 + b, d11 = d01 + b
+	__m128 d = _mm_add_ps( d00, _mm_set_ps(plane.a, plane.b, plane.a, 0.0f) );
+	return _mm_add_ps( d, _mm_set_ps(plane.b, 0.0f, 0.0f, 0.0f) );
+}
+
+static __m128 lanes_to_mask(uint32_t lanes)
+{
+	__m128i bits = _mm_and_si128( _mm_set1_epi32(lanes), _mm_set_epi32(8, 4, 2, 1) );
+	return _mm_castsi128_ps( _mm_cmpgt_epi32(bits, _mm_setzero_si128()) );
+}
+#else
+static void quad_depth(float* out, depth_plane const& plane, size_t qx, size_t qy)
+{
+	float const x = 0.5f + qx;
+	float const y = 0.5f + qy;
+
+	out[0] = plane.a * x + plane.b * y + plane.c;
+	out[1] = out[0] + plane.a;
+	out[2] = out[0] + plane.b;
+	out[3] = out[1] + plane.b;
+}
+
+static bool compare(compare_function func, float lhs, float rhs)
+{
+	switch(func)
+	{
+	case compare_function_less:
+		return lhs < rhs;
+	case compare_function_equal:
+		return lhs == rhs;
+	case compare_function_less_equal:
+		return lhs <= rhs;
+	case compare_function_greater:
+		return lhs > rhs;
+	case compare_function_not_equal:
+		return lhs != rhs;
+	case compare_function_greater_equal:
+		return lhs >= rhs;
+	case compare_function_always:
+		return true;
+	default:
+		return false;
+	}
+}
+#endif
+
+depth_plane_buffer::depth_plane_buffer(surface* target)
+	: target_(target), sample_count_( target->sample_count() )
+{
+	EFLIB_ASSERT(sample_count_ <= depth_plane::MAX_SAMPLES, "Too many samples for depth compression.");
+
+	tile_count_x_ = (target->width()  + TILE_SIZE - 1) >> TILE_BITS;
+	tile_count_y_ = (target->height() + TILE_SIZE - 1) >> TILE_BITS;
+
+	// All tiles are raw until the first clear.
+	tile raw_tile;
+	memset(&raw_tile, 0, sizeof(raw_tile));
+	tiles_.resize(tile_count_x_ * tile_count_y_, raw_tile);
+}
+
+void depth_plane_buffer::clear(float depth, uint32_t stencil)
+{
+	tile cleared_tile;
+	memset(&cleared_tile, 0, sizeof(cleared_tile));
+	cleared_tile.plane_count	= 1;
+	cleared_tile.stencil		= stencil;
+	cleared_tile.planes[0].c	= depth;
+
+	std::fill(tiles_.begin(), tiles_.end(), cleared_tile);
+}
+
+uint64_t depth_plane_buffer::valid_pixels(size_t tile_index) const
+{
+	size_t tile_y = tile_index / tile_count_x_;
+	size_t tile_x = tile_index - tile_y * tile_count_x_;
+
+	size_t w = std::min<size_t>( TILE_SIZE, target_->width()  - (tile_x << TILE_BITS) );
+	size_t h = std::min<size_t>( TILE_SIZE, target_->height() - (tile_y << TILE_BITS) );
+
+	uint64_t row = (1ULL << w) - 1;
+	uint64_t mask = 0;
+	for(size_t y = 0; y < h; ++y)
+	{
+		mask |= row << (y << TILE_BITS);
+	}
+	return mask;
+}
+
+bool depth_plane_buffer::test_quad(
+	uint64_t& passed, size_t x, size_t y, uint64_t quad_mask,
+	float const* depth, depth_plane const& plane,
+	compare_function func, bool write_depth)
+{
+	size_t tile_index = (y >> TILE_BITS) * tile_count_x_ + (x >> TILE_BITS);
+	tile& t = tiles_[tile_index];
+	if(t.plane_count == 0)
+	{
+		return false;
+	}
+
+	uint32_t const quad_shift = static_cast<uint32_t>( ((y & TILE_MASK) << TILE_BITS) + (x & TILE_MASK) );
+
+	uint32_t covered_lanes[depth_plane::MAX_SAMPLES];
+	for(size_t s = 0; s < sample_count_; ++s)
+	{
+		covered_lanes[s] = 0;
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			covered_lanes[s] |= static_cast<uint32_t>( (quad_mask >> (i * MAX_SAMPLE_COUNT + s)) & 1 ) << i;
+		}
+	}
+
+	// Passed pixels in tile for each sample.
+	uint64_t passed_pixels[depth_plane::MAX_SAMPLES];
+	uint64_t any_passed = 0;
+
+#if !defined(EFLIB_NO_SIMD)
+	__m128 old_depth0 = quad_depth(t.planes[0], x, y);
+	__m128 old_depth1 = (t.plane_count > 1) ? quad_depth(t.planes[1], x, y) : old_depth0;
+	__m128 new_depth  = _mm_loadu_ps(depth);
+
+	for(size_t s = 0; s < sample_count_; ++s)
+	{
+		__m128 sel = lanes_to_mask( quad_lanes(t.selections[s], quad_shift) );
+		__m128 old_samp = _mm_or_ps(
+			_mm_andnot_ps( sel, _mm_add_ps(old_depth0, _mm_set1_ps(t.planes[0].aa_offset[s])) ),
+			_mm_and_ps   ( sel, _mm_add_ps(old_depth1, _mm_set1_ps(t.planes[1].aa_offset[s])) )
+			);
+		__m128 new_samp = _mm_add_ps( new_depth, _mm_set1_ps(plane.aa_offset[s]) );
+
+		uint32_t lanes = static_cast<uint32_t>( _mm_movemask_ps( depth_compare_ps(func, new_samp, old_samp) ) );
+		lanes &= covered_lanes[s];
+
+		passed_pixels[s] = tile_bits(lanes, quad_shift);
+		any_passed |= passed_pixels[s];
+	}
+#else
+	float old_depth[2][4];
+	quad_depth(old_depth[0], t.planes[0], x, y);
+	quad_depth(old_depth[1], t.planes[t.plane_count - 1], x, y);
+
+	for(size_t s = 0; s < sample_count_; ++s)
+	{
+		uint32_t sel_lanes = quad_lanes(t.selections[s], quad_shift);
+		uint32_t lanes = 0;
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			uint32_t i_plane = (sel_lanes >> i) & 1;
+			float old_samp = old_depth[i_plane][i] + t.planes[i_plane].aa_offset[s];
+			float new_samp = depth[i] + plane.aa_offset[s];
+			lanes |= (compare(func, new_samp, old_samp) ? 1 : 0) << i;
+		}
+		lanes &= covered_lanes[s];
+
+		passed_pixels[s] = tile_bits(lanes, quad_shift);
+		any_passed |= passed_pixels[s];
+	}
+#endif
+
+	passed = 0;
+	for(size_t s = 0; s < sample_count_; ++s)
+	{
+		uint32_t lanes = quad_lanes(passed_pixels[s], quad_shift);
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			passed |= static_cast<uint64_t>( (lanes >> i) & 1 ) << (i * MAX_SAMPLE_COUNT + s);
+		}
+	}
+
+	if(!write_depth || any_passed == 0)
+	{
+		return true;
+	}
+
+	// Find a plane slot for incoming plane. Passed samples are overwritten, so a plane which is
+	// only referenced by passed samples could be replaced.
+	uint64_t const valid = valid_pixels(tile_index);
+	bool used[2] = {false, false};
+	for(size_t s = 0; s < sample_count_; ++s)
+	{
+		uint64_t remained = valid & ~passed_pixels[s];
+		used[0] |= (remained & ~t.selections[s]) != 0;
+		used[1] |= (remained &  t.selections[s]) != 0;
+	}
+
+	uint32_t slot;
+	if(plane == t.planes[0])
+	{
+		slot = 0;
+	}
+	else if(t.plane_count == 2 && plane == t.planes[1])
+	{
+		slot = 1;
+	}
+	else if(!used[0])
+	{
+		slot = 0;
+	}
+	else if(t.plane_count == 1 || !used[1])
+	{
+		slot = 1;
+	}
+	else
+	{
+		// Tile is covered by more than two planes. Test is done again on raw storage.
+		decompress_tile(tile_index);
+		return false;
+	}
+
+	t.planes[slot] = plane;
+	t.plane_count = std::max<uint32_t>(t.plane_count, slot + 1);
+
+	used[0] = used[1] = false;
+	for(size_t s = 0; s < sample_count_; ++s)
+	{
+		if(slot == 0)
+		{
+			t.selections[s] &= ~passed_pixels[s];
+		}
+		else
+		{
+			t.selections[s] |= passed_pixels[s];
+		}
+		used[0] |= (valid & ~t.selections[s]) != 0;
+		used[1] |= (valid &  t.selections[s]) != 0;
+	}
+
+	if(t.plane_count == 2 && !(used[0] && used[1]))
+	{
+		if(!used[0])
+		{
+			t.planes[0] = t.planes[1];
+		}
+		t.plane_count = 1;
+		memset(t.selections, 0, sizeof(t.selections));
+	}
+
+	return true;
+}
+
+void depth_plane_buffer::decompress_tile(size_t tile_index)
+{
+	tile& t = tiles_[tile_index];
+
+	size_t tile_y = tile_index / tile_count_x_;
+	size_t tile_x = tile_index - tile_y * tile_count_x_;
+	size_t left = tile_x << TILE_BITS;
+	size_t top  = tile_y << TILE_BITS;
+
+	union
+	{
+		float		stencil_f;
+		uint32_t	stencil_u;
+	};
+	stencil_u = t.stencil;
+
+	uint64_t const valid = valid_pixels(tile_index);
+
+	for(size_t qy = 0; qy < TILE_SIZE; qy += 2)
+	{
+		for(size_t qx = 0; qx < TILE_SIZE; qx += 2)
+		{
+			uint32_t const quad_shift = static_cast<uint32_t>( (qy << TILE_BITS) + qx );
+
+			EFLIB_ALIGN(16) float quad_depths[2][4];
+#if !defined(EFLIB_NO_SIMD)
+			_mm_store_ps( quad_depths[0], quad_depth(t.planes[0], left + qx, top + qy) );
+			_mm_store_ps( quad_depths[1], quad_depth(t.planes[t.plane_count - 1], left + qx, top + qy) );
+#else
+			quad_depth( quad_depths[0], t.planes[0], left + qx, top + qy );
+			quad_depth( quad_depths[1], t.planes[t.plane_count - 1], left + qx, top + qy );
+#endif
+			uint32_t valid_lanes = quad_lanes(valid, quad_shift);
+			for(uint32_t i = 0; i < 4; ++i)
+			{
+				if( (valid_lanes & (1 << i)) == 0 )
+				{
+					continue;
+				}
+
+				size_t px = left + qx + (i & 1);
+				size_t py = top + qy + (i >> 1);
+				for(size_t s = 0; s < sample_count_; ++s)
+				{
+					uint32_t i_plane = (quad_lanes(t.selections[s], quad_shift) >> i) & 1;
+					float* texel = static_cast<float*>( target_->texel_address(px, py, s) );
+					texel[0] = t.planes[i_plane].aa_offset[s] + quad_depths[i_plane][i];
+					texel[1] = stencil_f;
+				}
+			}
+		}
+	}
+
+	t.plane_count = 0;
+}
+
+void depth_plane_buffer::decompress_all()
+{
+	for(size_t i = 0; i < tiles_.size(); ++i)
+	{
+		if(tiles_[i].plane_count != 0)
+		{
+			decompress_tile(i);
+		}
+	}
+}
+
+END_NS_SALVIAR();
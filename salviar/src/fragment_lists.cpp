@@ -0,0 +1,121 @@
+#include <salviar/include/fragment_lists.h>
+#include <salviar/include/surface.h>
+#include <salviar/include/colors.h>
+#include <salviar/include/thread_context.h>
+
+#include <algorithm>
+
+BEGIN_NS_SALVIAR();
+
+using eflib::vec4;
+
+uint32_t const END_OF_LIST = 0xFFFFFFFF;
+
+fragment_list_buffer::fragment_list_buffer(surface* target)
+	: target_(target)
+{
+	sample_count_ = target->sample_count();
+	tile_count_x_ = (target->width()  + TILE_SIZE - 1) / TILE_SIZE;
+	tile_count_y_ = (target->height() + TILE_SIZE - 1) / TILE_SIZE;
+	tiles_.resize(tile_count_x_ * tile_count_y_);
+}
+
+void fragment_list_buffer::append(size_t x, size_t y, size_t sample, vec4 const& color, float depth)
+{
+	tile& t = tiles_[(y / TILE_SIZE) * tile_count_x_ + (x / TILE_SIZE)];
+	if( t.heads.empty() )
+	{
+		t.heads.resize(TILE_SIZE * TILE_SIZE * sample_count_, END_OF_LIST);
+	}
+
+	uint32_t& head = t.heads[( (y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE) ) * sample_count_ + sample];
+
+	fragment frag;
+	frag.color	= color;
+	frag.depth	= depth;
+	frag.next	= head;
+
+	head = static_cast<uint32_t>( t.fragments.size() );
+	t.fragments.push_back(frag);
+}
+
+void fragment_list_buffer::resolve()
+{
+	execute_threads(
+		[this](thread_context const* thread_ctx)
+		{
+			std::vector<fragment const*> sorted;
+			thread_context::package_cursor current_package = thread_ctx->next_package();
+			while ( current_package.valid() )
+			{
+				auto tile_range = current_package.item_range();
+				for (int32_t i = tile_range.first; i < tile_range.second; ++ i)
+				{
+					resolve_tile(i, sorted);
+				}
+				current_package = thread_ctx->next_package();
+			}
+		},
+		static_cast<int32_t>( tiles_.size() ), 1
+		);
+}
+
+void fragment_list_buffer::resolve_tile(size_t tile_index, std::vector<fragment const*>& sorted)
+{
+	tile& t = tiles_[tile_index];
+	if( t.fragments.empty() )
+	{
+		return;
+	}
+
+	size_t const left	= (tile_index % tile_count_x_) * TILE_SIZE;
+	size_t const top	= (tile_index / tile_count_x_) * TILE_SIZE;
+	size_t const right	= std::min<size_t>(left + TILE_SIZE, target_->width());
+	size_t const bottom	= std::min<size_t>(top  + TILE_SIZE, target_->height());
+
+	target_->fill_cleared_tiles(left, top, right - left, bottom - top);
+
+	for(size_t y = top; y < bottom; ++y)
+	{
+		for(size_t x = left; x < right; ++x)
+		{
+			for(size_t s = 0; s < sample_count_; ++s)
+			{
+				uint32_t& head = t.heads[( (y - top) * TILE_SIZE + (x - left) ) * sample_count_ + s];
+				if(head == END_OF_LIST)
+				{
+					continue;
+				}
+
+				// Lists are in reverse order of submission. Fragments of same depth keep submission order.
+				sorted.clear();
+				for(uint32_t i_frag = head; i_frag != END_OF_LIST; i_frag = t.fragments[i_frag].next)
+				{
+					sorted.push_back(&t.fragments[i_frag]);
+				}
+				std::reverse( sorted.begin(), sorted.end() );
+				std::stable_sort(
+					sorted.begin(), sorted.end(),
+					[](fragment const* lhs, fragment const* rhs) { return lhs->depth > rhs->depth; }
+					);
+
+				color_rgba32f dst = target_->get_texel(x, y, s);
+				for(fragment const* frag: sorted)
+				{
+					float const alpha = frag->color[3];
+					dst.r = frag->color[0] * alpha + dst.r * (1.0f - alpha);
+					dst.g = frag->color[1] * alpha + dst.g * (1.0f - alpha);
+					dst.b = frag->color[2] * alpha + dst.b * (1.0f - alpha);
+					dst.a = alpha + dst.a * (1.0f - alpha);
+				}
+				target_->set_texel(x, y, s, dst);
+
+				head = END_OF_LIST;
+			}
+		}
+	}
+
+	t.fragments.clear();
+}
+
+END_NS_SALVIAR();
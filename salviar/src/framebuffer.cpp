@@ -1,13 +1,22 @@
 #include <salviar/include/framebuffer.h>
+#include <salviar/include/blend_ops.h>
 #include <salviar/include/shader.h>
 #include <salviar/include/shader_regs.h>
 #include <salviar/include/shader_regs_op.h>
 #include <salviar/include/surface.h>
+#include <salviar/include/depth_planes.h>
+#include <salviar/include/fragment_lists.h>
 #include <salviar/include/render_state.h>
 #include <salviar/include/renderer.h>
+#include <salviar/include/render_stages.h>
+#include <salviar/include/host.h>
 
 #include <eflib/include/math/collision_detection.h>
 
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/make_shared.hpp>
+#include <eflib/include/platform/boost_end.h>
+
 #include <algorithm>
 
 BEGIN_NS_SALVIAR();
@@ -41,6 +50,10 @@ public:
 
 	static void 	write_depth_stencil(void* /*ds_data*/, float /*depth*/, uint32_t /*stencil*/)
     {
+    }
+
+	static float	quantize_depth(float /*depth*/)
+    {
     }
 };
 
@@ -102,8 +115,370 @@ public:
         stencil_u = stencil;
         reinterpret_cast<color_rg32f*>(ds_data)->g = stencil_f;
     }
+
+	static float	quantize_depth(float depth)
+    {
+        return depth;
+    }
+};
+
+template <> class depth_stencil_accessor<pixel_format_color_d32f>
+{
+public:
+	static float 	read_depth(void const* ds_data)
+    {
+        return reinterpret_cast<color_d32f const*>(ds_data)->depth;
+    }
+
+	static uint32_t	read_stencil(void const* /*ds_data*/)
+    {
+        return 0;
+    }
+
+	static void 	read_depth_stencil(float& depth, uint32_t& stencil, void const* ds_data)
+    {
+        depth = reinterpret_cast<color_d32f const*>(ds_data)->depth;
+        stencil = 0;
+    }
+	
+	static void 	write_depth(void* ds_data, float depth)
+    {
+        reinterpret_cast<color_d32f*>(ds_data)->depth = depth;
+    }
+
+	static void		write_stencil(void* /*ds_data*/, uint32_t /*stencil*/)
+    {
+    }
+
+	static void 	write_depth_stencil(void* ds_data, float depth, uint32_t /*stencil*/)
+    {
+        reinterpret_cast<color_d32f*>(ds_data)->depth = depth;
+    }
+
+	static float	quantize_depth(float depth)
+    {
+        return depth;
+    }
+};
+
+template <> class depth_stencil_accessor<pixel_format_color_d24s8>
+{
+public:
+	static float 	read_depth(void const* ds_data)
+    {
+        return reinterpret_cast<color_d24s8 const*>(ds_data)->depth();
+    }
+
+	static uint32_t	read_stencil(void const* ds_data)
+    {
+        return reinterpret_cast<color_d24s8 const*>(ds_data)->stencil();
+    }
+
+	static void 	read_depth_stencil(float& depth, uint32_t& stencil, void const* ds_data)
+    {
+        color_d24s8 const* ds = reinterpret_cast<color_d24s8 const*>(ds_data);
+        depth = ds->depth();
+        stencil = ds->stencil();
+    }
+	
+	static void 	write_depth(void* ds_data, float depth)
+    {
+        color_d24s8* ds = reinterpret_cast<color_d24s8*>(ds_data);
+        ds->ds = color_d24s8::pack(depth, ds->stencil());
+    }
+
+	static void		write_stencil(void* ds_data, uint32_t stencil)
+    {
+        color_d24s8* ds = reinterpret_cast<color_d24s8*>(ds_data);
+        ds->ds = (ds->ds & color_d24s8::DEPTH_MAX) | ( (stencil & 0xFF) << 24 );
+    }
+
+	static void 	write_depth_stencil(void* ds_data, float depth, uint32_t stencil)
+    {
+        reinterpret_cast<color_d24s8*>(ds_data)->ds = color_d24s8::pack(depth, stencil & 0xFF);
+    }
+
+	// Incoming depth is rounded to 24-bit unorm, so it is compared with stored depth in same precision.
+	static float	quantize_depth(float depth)
+    {
+        return color_d24s8(depth, 0).depth();
+    }
+};
+
+template <> class depth_stencil_accessor<pixel_format_color_d16>
+{
+public:
+	static float 	read_depth(void const* ds_data)
+    {
+        return reinterpret_cast<color_d16 const*>(ds_data)->depth();
+    }
+
+	static uint32_t	read_stencil(void const* /*ds_data*/)
+    {
+        return 0;
+    }
+
+	static void 	read_depth_stencil(float& depth, uint32_t& stencil, void const* ds_data)
+    {
+        depth = reinterpret_cast<color_d16 const*>(ds_data)->depth();
+        stencil = 0;
+    }
+	
+	static void 	write_depth(void* ds_data, float depth)
+    {
+        reinterpret_cast<color_d16*>(ds_data)->d = color_d16::pack(depth);
+    }
+
+	static void		write_stencil(void* /*ds_data*/, uint32_t /*stencil*/)
+    {
+    }
+
+	static void 	write_depth_stencil(void* ds_data, float depth, uint32_t /*stencil*/)
+    {
+        reinterpret_cast<color_d16*>(ds_data)->d = color_d16::pack(depth);
+    }
+
+	static float	quantize_depth(float depth)
+    {
+        return color_d16(depth).depth();
+    }
+};
+
+#if !defined(EFLIB_NO_SIMD)
+// Packed depth layouts for 4-wide early-z.
+// Depth is encoded to 'value' which has same layout as storage, and 'key' is comparable as float.
+// Unorm depth keys are integers less than 2^24, so they are exact in float.
+template <uint32_t Format> struct packed_depth;
+
+template <> struct packed_depth<pixel_format_color_d32f>
+{
+	typedef float storage;
+
+	static __m128i encode(__m128 depth)
+	{
+		return _mm_castps_si128(depth);
+	}
+
+	static __m128 key(__m128i value)
+	{
+		return _mm_castsi128_ps(value);
+	}
+
+	static __m128i merge(__m128i /*old_value*/, __m128i new_value)
+	{
+		return new_value;
+	}
+
+	static __m128i load(storage const* p0, storage const* p1, storage const* p2, storage const* p3)
+	{
+		return _mm_castps_si128( _mm_setr_ps(*p0, *p1, *p2, *p3) );
+	}
+
+	static __m128i load_rows(storage const* row0, storage const* row1)
+	{
+		return _mm_unpacklo_epi64(
+			_mm_loadl_epi64( reinterpret_cast<__m128i const*>(row0) ),
+			_mm_loadl_epi64( reinterpret_cast<__m128i const*>(row1) )
+			);
+	}
+
+	static void store_rows(storage* row0, storage* row1, __m128i value)
+	{
+		_mm_storel_epi64( reinterpret_cast<__m128i*>(row0), value );
+		_mm_storel_epi64( reinterpret_cast<__m128i*>(row1), _mm_unpackhi_epi64(value, value) );
+	}
+
+	static void store(storage* p, __m128i value, int lane)
+	{
+		EFLIB_ALIGN(16) storage values[4];
+		_mm_store_si128( reinterpret_cast<__m128i*>(values), value );
+		*p = values[lane];
+	}
+};
+
+template <> struct packed_depth<pixel_format_color_d24s8>
+{
+	typedef uint32_t storage;
+
+	static __m128i encode(__m128 depth)
+	{
+		__m128 clamped = _mm_min_ps( _mm_max_ps(depth, _mm_setzero_ps()), _mm_set1_ps(1.0f) );
+		return _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps(clamped, _mm_set1_ps(color_d24s8::DEPTH_MAX)), _mm_set1_ps(0.5f) ) );
+	}
+
+	static __m128 key(__m128i value)
+	{
+		return _mm_cvtepi32_ps( _mm_and_si128(value, _mm_set1_epi32(color_d24s8::DEPTH_MAX)) );
+	}
+
+	// Keeps stencil of old value.
+	static __m128i merge(__m128i old_value, __m128i new_value)
+	{
+		return _mm_or_si128( _mm_andnot_si128(_mm_set1_epi32(color_d24s8::DEPTH_MAX), old_value), new_value );
+	}
+
+	static __m128i load(storage const* p0, storage const* p1, storage const* p2, storage const* p3)
+	{
+		return _mm_setr_epi32(*p0, *p1, *p2, *p3);
+	}
+
+	static __m128i load_rows(storage const* row0, storage const* row1)
+	{
+		return _mm_unpacklo_epi64(
+			_mm_loadl_epi64( reinterpret_cast<__m128i const*>(row0) ),
+			_mm_loadl_epi64( reinterpret_cast<__m128i const*>(row1) )
+			);
+	}
+
+	static void store_rows(storage* row0, storage* row1, __m128i value)
+	{
+		_mm_storel_epi64( reinterpret_cast<__m128i*>(row0), value );
+		_mm_storel_epi64( reinterpret_cast<__m128i*>(row1), _mm_unpackhi_epi64(value, value) );
+	}
+
+	static void store(storage* p, __m128i value, int lane)
+	{
+		EFLIB_ALIGN(16) storage values[4];
+		_mm_store_si128( reinterpret_cast<__m128i*>(values), value );
+		*p = values[lane];
+	}
+};
+
+template <> struct packed_depth<pixel_format_color_d16>
+{
+	typedef uint16_t storage;
+
+	static __m128i encode(__m128 depth)
+	{
+		__m128 clamped = _mm_min_ps( _mm_max_ps(depth, _mm_setzero_ps()), _mm_set1_ps(1.0f) );
+		return _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps(clamped, _mm_set1_ps(color_d16::DEPTH_MAX)), _mm_set1_ps(0.5f) ) );
+	}
+
+	static __m128 key(__m128i value)
+	{
+		return _mm_cvtepi32_ps(value);
+	}
+
+	static __m128i merge(__m128i /*old_value*/, __m128i new_value)
+	{
+		return new_value;
+	}
+
+	static __m128i load(storage const* p0, storage const* p1, storage const* p2, storage const* p3)
+	{
+		return _mm_setr_epi32(*p0, *p1, *p2, *p3);
+	}
+
+	static __m128i load_rows(storage const* row0, storage const* row1)
+	{
+		__m128i rows = _mm_unpacklo_epi32(
+			_mm_cvtsi32_si128( *reinterpret_cast<int const*>(row0) ),
+			_mm_cvtsi32_si128( *reinterpret_cast<int const*>(row1) )
+			);
+		return _mm_unpacklo_epi16( rows, _mm_setzero_si128() );
+	}
+
+	static void store_rows(storage* row0, storage* row1, __m128i value)
+	{
+		// Values are in [0, 65535], so signed saturation is avoided by biasing.
+		__m128i biased = _mm_sub_epi32( value, _mm_set1_epi32(0x8000) );
+		__m128i packed = _mm_add_epi16( _mm_packs_epi32(biased, biased), _mm_set1_epi16(-0x8000) );
+		*reinterpret_cast<int*>(row0) = _mm_cvtsi128_si32(packed);
+		*reinterpret_cast<int*>(row1) = _mm_cvtsi128_si32( _mm_srli_si128(packed, 4) );
+	}
+
+	static void store(storage* p, __m128i value, int lane)
+	{
+		EFLIB_ALIGN(16) uint32_t values[4];
+		_mm_store_si128( reinterpret_cast<__m128i*>(values), value );
+		*p = static_cast<storage>(values[lane]);
+	}
 };
 
+// Early-z of quad on packed depth target. Samples of pixels in same position are tested together.
+template <uint32_t Format>
+uint64_t early_z_quad_packed(
+	surface* target, size_t x, size_t y, uint64_t quad_mask,
+	float const* depth, float const* aa_z_offset, uint32_t sample_count,
+	compare_function func, bool write_depth)
+{
+	typedef packed_depth<Format> traits;
+	typedef typename traits::storage storage;
+
+	__m128 quad_depth = _mm_loadu_ps(depth);
+	uint64_t passed = 0;
+
+	for(uint32_t s = 0; s < sample_count; ++s)
+	{
+		uint32_t covered = 0;
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			covered |= static_cast<uint32_t>( (quad_mask >> (i * MAX_SAMPLE_COUNT + s)) & 1 ) << i;
+		}
+		if(covered == 0)
+		{
+			continue;
+		}
+
+		__m128  new_depth = (sample_count == 1) ? quad_depth : _mm_add_ps( _mm_set1_ps(aa_z_offset[s]), quad_depth );
+		__m128i new_value = traits::encode(new_depth);
+
+		if(sample_count == 1 && covered == 0xF)
+		{
+			// Full quad of single sample target is two pairs of adjacent texels.
+			storage* row0 = static_cast<storage*>( target->texel_address(x, y,     0) );
+			storage* row1 = static_cast<storage*>( target->texel_address(x, y + 1, 0) );
+
+			__m128i old_value = traits::load_rows(row0, row1);
+			__m128  pass = depth_compare_ps( func, traits::key(new_value), traits::key(old_value) );
+			uint32_t lanes = static_cast<uint32_t>( _mm_movemask_ps(pass) );
+
+			if(write_depth && lanes != 0)
+			{
+				__m128i merged = traits::merge(old_value, new_value);
+				__m128i mask = _mm_castps_si128(pass);
+				traits::store_rows( row0, row1, _mm_or_si128( _mm_and_si128(mask, merged), _mm_andnot_si128(mask, old_value) ) );
+			}
+
+			passed |= (lanes & 1) | ( (lanes & 2) << (MAX_SAMPLE_COUNT - 1) ) | ( static_cast<uint64_t>(lanes & 4) << (MAX_SAMPLE_COUNT * 2 - 2) ) | ( static_cast<uint64_t>(lanes & 8) << (MAX_SAMPLE_COUNT * 3 - 3) );
+			continue;
+		}
+
+		storage  dummy = 0;
+		storage* addrs[4];
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			addrs[i] = (covered & (1 << i))
+				? static_cast<storage*>( target->texel_address(x + (i & 1), y + (i >> 1), s) )
+				: &dummy;
+		}
+
+		__m128i old_value = traits::load(addrs[0], addrs[1], addrs[2], addrs[3]);
+		__m128  pass = depth_compare_ps( func, traits::key(new_value), traits::key(old_value) );
+		uint32_t lanes = static_cast<uint32_t>( _mm_movemask_ps(pass) ) & covered;
+
+		if(write_depth && lanes != 0)
+		{
+			__m128i merged = traits::merge(old_value, new_value);
+			for(int i = 0; i < 4; ++i)
+			{
+				if( lanes & (1 << i) )
+				{
+					traits::store(addrs[i], merged, i);
+				}
+			}
+		}
+
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			passed |= static_cast<uint64_t>( (lanes >> i) & 1 ) << (i * MAX_SAMPLE_COUNT + s);
+		}
+	}
+
+	return passed;
+}
+#endif
+
 uint32_t mask_stencil_0(uint32_t /*stencil*/, uint32_t /*mask*/)
 {
 	return 0;
@@ -356,59 +731,231 @@ uint32_t depth_stencil_state::stencil_operation(bool front_face, bool depth_pass
 	return stencil_op_[(!front_face) * 3 + (!depth_pass) + static_cast<int>(stencil_pass)](ref, cur_stencil);
 }
 
-// frame buffer
-
-void read_depth_0_stencil_0(float& depth, uint32_t& stencil, uint32_t /*stencil_mask*/, void const* /*ds_data*/)
+blend_state::blend_state(const blend_desc& desc)
+	: desc_(desc)
 {
-    depth = 0.0f;
-    stencil = 0;
 }
 
-template <uint32_t Format>
-void read_depth_0_stencil_1(float& depth, uint32_t& stencil, uint32_t stencil_mask, void const* ds_data)
+const blend_desc& blend_state::get_desc() const
 {
-    depth = 0.0f;
-    stencil = depth_stencil_accessor<Format>::read_stencil(ds_data) & stencil_mask;
+	return desc_;
 }
 
-template <uint32_t Format>
-void read_depth_1_stencil_0(float& depth, uint32_t& stencil, uint32_t /*stencil_mask*/, void const* ds_data)
-{
-    depth = depth_stencil_accessor<Format>::read_depth(ds_data);
-    stencil = 0;
-}
+// color writers
 
-template <uint32_t Format>
-void read_depth_1_stencil_1(float& depth, uint32_t& stencil, uint32_t stencil_mask, void const* ds_data)
+static float blend_factor_component(blend_factor factor, float const* src, float const* dst, int comp)
 {
-    depth_stencil_accessor<Format>::read_depth_stencil(depth, stencil, ds_data);
-    stencil &= stencil_mask;
+	switch(factor)
+	{
+	case blend_factor_zero:				return 0.0f;
+	case blend_factor_one:				return 1.0f;
+	case blend_factor_src_color:		return src[comp];
+	case blend_factor_inv_src_color:	return 1.0f - src[comp];
+	case blend_factor_src_alpha:		return src[3];
+	case blend_factor_inv_src_alpha:	return 1.0f - src[3];
+	case blend_factor_dest_alpha:		return dst[3];
+	case blend_factor_inv_dest_alpha:	return 1.0f - dst[3];
+	case blend_factor_dest_color:		return dst[comp];
+	case blend_factor_inv_dest_color:	return 1.0f - dst[comp];
+	case blend_factor_src_alpha_sat:	return comp == 3 ? 1.0f : std::min(src[3], 1.0f - dst[3]);
+	}
+	return 0.0f;
 }
 
-void write_depth_0_stencil_0(void* /*ds_data*/, float /*depth*/, uint32_t /*stencil*/, uint32_t /*stencil_mask*/)
+static float blend_component(blend_op op, float src, float src_factor, float dst, float dst_factor)
 {
+	switch(op)
+	{
+	case blend_op_add:			return src * src_factor + dst * dst_factor;
+	case blend_op_subtract:		return src * src_factor - dst * dst_factor;
+	case blend_op_rev_subtract:	return dst * dst_factor - src * src_factor;
+	case blend_op_min:			return std::min(src, dst);
+	case blend_op_max:			return std::max(src, dst);
+	}
+	return src;
 }
 
-template <uint32_t Format>
-void write_depth_0_stencil_1(void* ds_data, float /*depth*/, uint32_t stencil, uint32_t stencil_mask)
+// Slow path for any format, color is converted by surface.
+static void write_color_generic(surface* target, size_t x, size_t y, size_t sample, vec4 const& color, render_target_blend_desc const& desc)
 {
-    depth_stencil_accessor<Format>::write_stencil(ds_data, stencil & stencil_mask);
-}
+	if(!desc.blend_enable && desc.write_mask == color_write_enable_all)
+	{
+		target->set_texel(x, y, sample, color_rgba32f(color));
+		return;
+	}
 
-template <uint32_t Format>
-void write_depth_1_stencil_0(void* ds_data, float depth, uint32_t /*stencil*/, uint32_t /*stencil_mask*/)
-{
-    depth_stencil_accessor<Format>::write_depth(ds_data, depth);
-}
+	color_rgba32f dst_color = target->get_texel(x, y, sample);
+	float const* src = &color[0];
+	float const* dst = &dst_color.r;
 
-template <uint32_t Format>
-void write_depth_1_stencil_1(void* ds_data, float depth, uint32_t stencil, uint32_t stencil_mask)
-{
-    depth_stencil_accessor<Format>::write_depth_stencil(ds_data, depth, stencil & stencil_mask);
+	float out[4];
+	for(int comp = 0; comp < 4; ++comp)
+	{
+		if( (desc.write_mask & (1 << comp)) == 0 )
+		{
+			out[comp] = dst[comp];
+		}
+		else if(!desc.blend_enable)
+		{
+			out[comp] = src[comp];
+		}
+		else if(comp == 3)
+		{
+			out[comp] = blend_component(
+				desc.alpha_op,
+				src[comp], blend_factor_component(desc.src_blend_alpha, src, dst, comp),
+				dst[comp], blend_factor_component(desc.dest_blend_alpha, src, dst, comp)
+				);
+		}
+		else
+		{
+			out[comp] = blend_component(
+				desc.color_op,
+				src[comp], blend_factor_component(desc.src_blend, src, dst, comp),
+				dst[comp], blend_factor_component(desc.dest_blend, src, dst, comp)
+				);
+		}
+	}
+
+	target->set_texel(x, y, sample, color_rgba32f(out));
 }
 
-void framebuffer::initialize(render_stages const* /*stages*/)
+// Writes all covered samples of quad to one target.
+static void write_color_quad_generic(
+	surface* target, size_t x, size_t y, uint64_t quad_mask,
+	ps_output const* quad, size_t target_index, render_target_blend_desc const& desc)
 {
+	for(int i = 0; i < 4; ++i)
+	{
+		uint32_t px_mask = static_cast<uint32_t>( (quad_mask >> (i * MAX_SAMPLE_COUNT)) & SAMPLE_MASK );
+		uint32_t i_samp;
+		while( _xmm_bsf(&i_samp, px_mask) )
+		{
+			write_color_generic(target, x + (i & 1), y + ( (i & 2) >> 1 ), i_samp, quad[i].color[target_index], desc);
+			px_mask &= px_mask - 1;
+		}
+	}
+}
+
+#if !defined(EFLIB_NO_SIMD)
+
+// Samples of pixel are adjacent in surface, so texel address is computed once per pixel.
+template <int Format, uint32_t Mode>
+void write_color_quad_native(
+	surface* target, size_t x, size_t y, uint64_t quad_mask,
+	ps_output const* quad, size_t target_index, render_target_blend_desc const& desc)
+{
+	size_t const texel_size = color_infos[Format].size;
+	for(int i = 0; i < 4; ++i)
+	{
+		uint32_t px_mask = static_cast<uint32_t>( (quad_mask >> (i * MAX_SAMPLE_COUNT)) & SAMPLE_MASK );
+		if(px_mask == 0)
+		{
+			continue;
+		}
+
+		uint8_t* texels = static_cast<uint8_t*>( target->texel_address(x + (i & 1), y + ( (i & 2) >> 1 ), 0) );
+		__m128 src = _mm_loadu_ps( &quad[i].color[target_index][0] );
+
+		uint32_t i_samp;
+		while( _xmm_bsf(&i_samp, px_mask) )
+		{
+			write_native_color<Format, Mode>(texels + i_samp * texel_size, src, desc);
+			px_mask &= px_mask - 1;
+		}
+	}
+}
+
+template <int Format, uint32_t Mode>
+void write_color_native(surface* target, size_t x, size_t y, size_t sample, vec4 const& color, render_target_blend_desc const& desc)
+{
+	write_native_color<Format, Mode>( target->texel_address(x, y, sample), _mm_loadu_ps(&color[0]), desc );
+}
+
+template <int Format>
+void select_native_color_writer(
+	void (*&writer)(surface*, size_t, size_t, size_t, vec4 const&, render_target_blend_desc const&),
+	void (*&quad_writer)(surface*, size_t, size_t, uint64_t, ps_output const*, size_t, render_target_blend_desc const&),
+	render_target_blend_desc const& desc)
+{
+	switch( get_color_write_mode(desc) )
+	{
+	case color_write_opaque:
+		writer = write_color_native<Format, color_write_opaque>;
+		quad_writer = write_color_quad_native<Format, color_write_opaque>;
+		break;
+	case color_write_masked:
+		writer = write_color_native<Format, color_write_masked>;
+		quad_writer = write_color_quad_native<Format, color_write_masked>;
+		break;
+	case color_write_blend:
+		writer = write_color_native<Format, color_write_blend>;
+		quad_writer = write_color_quad_native<Format, color_write_blend>;
+		break;
+	}
+}
+
+#endif
+
+// frame buffer
+
+void read_depth_0_stencil_0(float& depth, uint32_t& stencil, uint32_t /*stencil_mask*/, void const* /*ds_data*/)
+{
+    depth = 0.0f;
+    stencil = 0;
+}
+
+template <uint32_t Format>
+void read_depth_0_stencil_1(float& depth, uint32_t& stencil, uint32_t stencil_mask, void const* ds_data)
+{
+    depth = 0.0f;
+    stencil = depth_stencil_accessor<Format>::read_stencil(ds_data) & stencil_mask;
+}
+
+template <uint32_t Format>
+void read_depth_1_stencil_0(float& depth, uint32_t& stencil, uint32_t /*stencil_mask*/, void const* ds_data)
+{
+    depth = depth_stencil_accessor<Format>::read_depth(ds_data);
+    stencil = 0;
+}
+
+template <uint32_t Format>
+void read_depth_1_stencil_1(float& depth, uint32_t& stencil, uint32_t stencil_mask, void const* ds_data)
+{
+    depth_stencil_accessor<Format>::read_depth_stencil(depth, stencil, ds_data);
+    stencil &= stencil_mask;
+}
+
+void write_depth_0_stencil_0(void* /*ds_data*/, float /*depth*/, uint32_t /*stencil*/, uint32_t /*stencil_mask*/)
+{
+}
+
+template <uint32_t Format>
+void write_depth_0_stencil_1(void* ds_data, float /*depth*/, uint32_t stencil, uint32_t stencil_mask)
+{
+    depth_stencil_accessor<Format>::write_stencil(ds_data, stencil & stencil_mask);
+}
+
+template <uint32_t Format>
+void write_depth_1_stencil_0(void* ds_data, float depth, uint32_t /*stencil*/, uint32_t /*stencil_mask*/)
+{
+    depth_stencil_accessor<Format>::write_depth(ds_data, depth);
+}
+
+template <uint32_t Format>
+void write_depth_1_stencil_1(void* ds_data, float depth, uint32_t stencil, uint32_t stencil_mask)
+{
+    depth_stencil_accessor<Format>::write_depth_stencil(ds_data, depth, stencil & stencil_mask);
+}
+
+static float quantize_depth_none(float depth)
+{
+    return depth;
+}
+
+void framebuffer::initialize(render_stages const* stages)
+{
+	stages_ = stages;
 }
 
 void framebuffer::update(render_state* state)
@@ -449,6 +996,162 @@ void framebuffer::update(render_state* state)
     }
 
     update_ds_rw_functions(ds_format_changed, ds_state_changed, output_depth_enabled);
+
+	ds_planes_ = nullptr;
+	if(ds_target_ != nullptr && ds_target_->depth_planes() != nullptr)
+	{
+		if(!early_z_enabled_)
+		{
+			// Depth and stencil are read and written by raw storage in late-z.
+			ds_target_->resolve_clear();
+		}
+		else if(ds_state_->get_desc().depth_enable)
+		{
+			ds_planes_ = ds_target_->depth_planes();
+		}
+	}
+
+	blend_state_ = state->blend_state.get();
+	color_target_count_ = state->color_targets.size();
+	update_color_write_functions();
+
+	oit_lists_ = nullptr;
+	if(blend_state_ != nullptr && blend_state_->get_desc().oit_enable && color_targets_[0] != nullptr)
+	{
+		oit_lists_ = color_targets_[0]->fragment_lists();
+	}
+
+	update_om_function(state);
+}
+
+void framebuffer::update_color_write_functions()
+{
+	static blend_state const default_blend_state( (blend_desc()) );
+	blend_state const* bs = blend_state_ ? blend_state_ : &default_blend_state;
+
+	written_target_count_ = 0;
+	for(size_t i = 0; i < MAX_RENDER_TARGETS; ++i)
+	{
+		color_writers_[i] = nullptr;
+		color_quad_writers_[i] = nullptr;
+		color_blend_descs_[i] = bs->get_target_desc(i);
+
+		render_target_blend_desc const& desc = color_blend_descs_[i];
+		if(i >= color_target_count_ || color_targets_[i] == nullptr || desc.write_mask == 0)
+		{
+			continue;
+		}
+
+		written_targets_[written_target_count_++] = i;
+		color_writers_[i] = write_color_generic;
+		color_quad_writers_[i] = write_color_quad_generic;
+
+#if !defined(EFLIB_NO_SIMD)
+		switch( color_targets_[i]->get_pixel_format() )
+		{
+		case pixel_format_color_rgba32f:
+			select_native_color_writer<pixel_format_color_rgba32f>(color_writers_[i], color_quad_writers_[i], desc);
+			break;
+		case pixel_format_color_rgba8:
+			select_native_color_writer<pixel_format_color_rgba8>(color_writers_[i], color_quad_writers_[i], desc);
+			break;
+		case pixel_format_color_bgra8:
+			select_native_color_writer<pixel_format_color_bgra8>(color_writers_[i], color_quad_writers_[i], desc);
+			break;
+		default:
+			break;
+		}
+#endif
+	}
+}
+
+void framebuffer::update_om_function(render_state const* state)
+{
+	om_quad_func_ = nullptr;
+
+	// Fused output merger only supports single color target without stencil and blend shader.
+	if( stages_ == nullptr || !stages_->host || state->cpp_bs || oit_lists_ != nullptr
+		|| color_target_count_ != 1 || color_writers_[0] == nullptr
+		|| ds_target_ == nullptr || ds_target_->get_pixel_format() != pixel_format_color_rg32f
+		|| ds_state_->get_desc().stencil_enable )
+	{
+		return;
+	}
+
+	depth_stencil_desc const& ds_desc = ds_state_->get_desc();
+
+	om_quad_key key;
+	if(early_z_enabled_ || !ds_desc.depth_enable)
+	{
+		key.depth_func	= compare_function_always;
+		key.depth_write	= false;
+	}
+	else
+	{
+		key.depth_func	= ds_desc.depth_func;
+		key.depth_write	= ds_desc.depth_write_mask && ds_desc.depth_func != compare_function_never;
+	}
+	key.color_format		= color_targets_[0]->get_pixel_format();
+	key.color_write_mode	= get_color_write_mode(color_blend_descs_[0]);
+
+	om_quad_func_ = stages_->host->get_om_function(key);
+	if(om_quad_func_ == nullptr)
+	{
+		return;
+	}
+
+	om_quad_data_.color_data	= static_cast<uint8_t*>( color_targets_[0]->texel_address(0, 0, 0) );
+	om_quad_data_.color_pitch	= color_targets_[0]->pitch();
+	om_quad_data_.ds_data		= static_cast<uint8_t*>( ds_target_->texel_address(0, 0, 0) );
+	om_quad_data_.ds_pitch		= ds_target_->pitch();
+	om_quad_data_.sample_count	= sample_count_;
+	om_quad_data_.blend			= color_blend_descs_[0];
+}
+
+void framebuffer::write_color(size_t x, size_t y, size_t sample, const ps_output& ps)
+{
+	for(size_t i = 0; i < color_target_count_; ++i)
+	{
+		if(color_writers_[i] != nullptr)
+		{
+			color_writers_[i](color_targets_[i], x, y, sample, ps.color[i], color_blend_descs_[i]);
+		}
+	}
+}
+
+void framebuffer::write_color_quad(size_t x, size_t y, uint64_t quad_mask, ps_output const* quad)
+{
+	for(size_t i = 0; i < written_target_count_; ++i)
+	{
+		size_t const target_index = written_targets_[i];
+		color_quad_writers_[target_index](
+			color_targets_[target_index], x, y, quad_mask, quad, target_index, color_blend_descs_[target_index]
+			);
+	}
+}
+
+template <uint32_t Format>
+void framebuffer::select_ds_rw_functions(bool read_depth, bool read_stencil, bool write_depth, bool write_stencil)
+{
+    if(read_depth)
+    {
+        read_depth_stencil_ = read_stencil ? read_depth_1_stencil_1<Format> : read_depth_1_stencil_0<Format>;
+    }
+    else
+    {
+        read_depth_stencil_ = read_stencil ? read_depth_0_stencil_1<Format> : read_depth_0_stencil_0;
+    }
+
+    if(write_depth)
+    {
+        write_depth_stencil_ = write_stencil ? write_depth_1_stencil_1<Format> : write_depth_1_stencil_0<Format>;
+    }
+    else
+    {
+        write_depth_stencil_ = write_stencil ? write_depth_0_stencil_1<Format> : write_depth_0_stencil_0;
+    }
+
+    quantize_depth_ = depth_stencil_accessor<Format>::quantize_depth;
 }
 
 void framebuffer::update_ds_rw_functions(bool ds_format_changed, bool ds_state_changed, bool output_depth_enabled)
@@ -460,6 +1163,8 @@ void framebuffer::update_ds_rw_functions(bool ds_format_changed, bool ds_state_c
 
     read_depth_stencil_  = read_depth_0_stencil_0; 
     write_depth_stencil_ = write_depth_0_stencil_0;
+    quantize_depth_      = quantize_depth_none;
+	early_z_quad_		 = nullptr;
 
     if(ds_target_ == nullptr)
     {
@@ -471,76 +1176,160 @@ void framebuffer::update_ds_rw_functions(bool ds_format_changed, bool ds_state_c
     bool write_depth = false;
     bool write_stencil = false;
 
-    switch(ds_target_->get_pixel_format())
+    if(ds_state_->get_desc().depth_enable)
     {
-    case pixel_format_color_rg32f:
-        if(ds_state_->get_desc().depth_enable)
+        if( ds_state_->get_desc().depth_func != compare_function_never
+            && ds_state_->get_desc().depth_func != compare_function_always )
         {
-            if( ds_state_->get_desc().depth_func != compare_function_never
-                && ds_state_->get_desc().depth_func != compare_function_always )
-            {
-                read_depth = true;
-            }
-
-            if(ds_state_->get_desc().depth_write_mask && ds_state_->get_desc().depth_func != compare_function_never)
-            {
-                write_depth = true;
-            }
+            read_depth = true;
         }
 
-        read_stencil = write_stencil = ds_state_->get_desc().stencil_enable;
-
-        if(read_depth)
-        {
-            if(read_stencil)
-            {
-                read_depth_stencil_ = read_depth_1_stencil_1<pixel_format_color_rg32f>;
-            }
-            else
-            {
-                read_depth_stencil_ = read_depth_1_stencil_0<pixel_format_color_rg32f>;
-            }
-        }
-        else
+        if(ds_state_->get_desc().depth_write_mask && ds_state_->get_desc().depth_func != compare_function_never)
         {
-            if(read_stencil)
-            {
-                read_depth_stencil_ = read_depth_0_stencil_1<pixel_format_color_rg32f>;
-            }
-            else
-            {
-                read_depth_stencil_ = read_depth_0_stencil_0;
-            }
-        }
-        
-        if(write_depth)
-        {
-            if(write_stencil)
-            {
-                write_depth_stencil_ = write_depth_1_stencil_1<pixel_format_color_rg32f>;
-            }
-            else
-            {
-                write_depth_stencil_ = write_depth_1_stencil_0<pixel_format_color_rg32f>;
-            }
-        }
-        else
-        {
-            if(write_stencil)
-            {
-                write_depth_stencil_ = write_depth_0_stencil_1<pixel_format_color_rg32f>;
-            }
-            else
-            {
-                write_depth_stencil_ = write_depth_0_stencil_0;
-            }
+            write_depth = true;
         }
+    }
+
+    read_stencil = write_stencil = ds_state_->get_desc().stencil_enable;
+
+    switch(ds_target_->get_pixel_format())
+    {
+    case pixel_format_color_rg32f:
+        select_ds_rw_functions<pixel_format_color_rg32f>(read_depth, read_stencil, write_depth, write_stencil);
+        break;
+    case pixel_format_color_d32f:
+        select_ds_rw_functions<pixel_format_color_d32f>(read_depth, read_stencil, write_depth, write_stencil);
+#if !defined(EFLIB_NO_SIMD)
+		early_z_quad_ = early_z_quad_packed<pixel_format_color_d32f>;
+#endif
+        break;
+    case pixel_format_color_d24s8:
+        select_ds_rw_functions<pixel_format_color_d24s8>(read_depth, read_stencil, write_depth, write_stencil);
+#if !defined(EFLIB_NO_SIMD)
+		early_z_quad_ = early_z_quad_packed<pixel_format_color_d24s8>;
+#endif
+        break;
+    case pixel_format_color_d16:
+        select_ds_rw_functions<pixel_format_color_d16>(read_depth, read_stencil, write_depth, write_stencil);
+#if !defined(EFLIB_NO_SIMD)
+		early_z_quad_ = early_z_quad_packed<pixel_format_color_d16>;
+#endif
         break;
     default:
         return;
     }
 
     early_z_enabled_ = !ds_state_->get_desc().stencil_enable && !output_depth_enabled;
+
+	// Packed early-z accesses memory for depth test only.
+	if(!ds_state_->get_desc().depth_enable)
+	{
+		early_z_quad_ = nullptr;
+	}
+}
+
+void framebuffer::prepare_tile(size_t left, size_t top, size_t width, size_t height)
+{
+	for(size_t i = 0; i < MAX_RENDER_TARGETS; ++i)
+	{
+		if(color_targets_[i] != nullptr)
+		{
+			color_targets_[i]->fill_cleared_tiles(left, top, width, height);
+		}
+	}
+
+	if(ds_target_ != nullptr)
+	{
+		ds_target_->fill_cleared_tiles(left, top, width, height);
+	}
+}
+
+void framebuffer::bind_tile_targets(framebuffer const& parent)
+{
+	// Tile surfaces are kept between draws, and are recreated only if format of target is changed.
+	surface_ptr tile_targets[MAX_RENDER_TARGETS + 1];
+	std::copy(tile_targets_, tile_targets_ + MAX_RENDER_TARGETS + 1, tile_targets);
+	*this = parent;
+	std::copy(tile_targets, tile_targets + MAX_RENDER_TARGETS + 1, tile_targets_);
+
+	parent_ = &parent;
+	for(size_t i = 0; i < MAX_RENDER_TARGETS + 1; ++i)
+	{
+		surface* target = (i < MAX_RENDER_TARGETS) ? parent.color_targets_[i] : parent.ds_target_;
+		if(target == nullptr)
+		{
+			continue;
+		}
+
+		surface_ptr& tile = tile_targets_[i];
+		if( !tile || tile->get_pixel_format() != target->get_pixel_format() || tile->sample_count() != target->sample_count() )
+		{
+			size_t const tile_size = surface::CLEAR_TILE_SIZE;
+			tile = boost::make_shared<surface>( tile_size, tile_size, target->sample_count(), target->get_pixel_format() );
+		}
+
+		if(i < MAX_RENDER_TARGETS)
+		{
+			color_targets_[i] = tile.get();
+		}
+		else
+		{
+			ds_target_ = tile.get();
+		}
+	}
+
+	// Compressed depth of parent is decompressed when tile is read.
+	ds_planes_ = nullptr;
+
+	if(om_quad_func_ != nullptr)
+	{
+		om_quad_data_.color_data	= static_cast<uint8_t*>( color_targets_[0]->texel_address(0, 0, 0) );
+		om_quad_data_.color_pitch	= color_targets_[0]->pitch();
+		om_quad_data_.ds_data		= static_cast<uint8_t*>( ds_target_->texel_address(0, 0, 0) );
+		om_quad_data_.ds_pitch		= ds_target_->pitch();
+	}
+}
+
+void framebuffer::begin_tile(size_t left, size_t top, size_t width, size_t height)
+{
+	surface* parent_ds = parent_->ds_target_;
+	surface* size_ref  = parent_ds ? parent_ds : parent_->color_targets_[0];
+
+	tile_rect_[0] = left;
+	tile_rect_[1] = top;
+	tile_rect_[2] = std::min<size_t>(width,  size_ref->width()  - left);
+	tile_rect_[3] = std::min<size_t>(height, size_ref->height() - top );
+
+	for(size_t i = 0; i < MAX_RENDER_TARGETS; ++i)
+	{
+		if(parent_->color_targets_[i] != nullptr)
+		{
+			parent_->color_targets_[i]->read_tile(*color_targets_[i], left, top, tile_rect_[2], tile_rect_[3]);
+		}
+	}
+
+	if(parent_ds != nullptr)
+	{
+		parent_ds->read_tile(*ds_target_, left, top, tile_rect_[2], tile_rect_[3]);
+	}
+}
+
+void framebuffer::end_tile()
+{
+	for(size_t i = 0; i < MAX_RENDER_TARGETS; ++i)
+	{
+		if(parent_->color_targets_[i] != nullptr)
+		{
+			parent_->color_targets_[i]->write_tile(*color_targets_[i], tile_rect_[0], tile_rect_[1], tile_rect_[2], tile_rect_[3]);
+		}
+	}
+
+	if(parent_->ds_target_ != nullptr)
+	{
+		parent_->ds_target_->write_tile(*ds_target_, tile_rect_[0], tile_rect_[1], tile_rect_[2], tile_rect_[3]);
+	}
+
+	tile_rect_[0] = tile_rect_[1] = 0;
 }
 
 framebuffer::framebuffer()
@@ -552,12 +1341,31 @@ framebuffer::framebuffer()
 
     ds_target_ = nullptr;
 	ds_state_ = nullptr;
+	blend_state_ = nullptr;
 	stencil_ref_ = 0;
     stencil_read_mask_ = 0;
     stencil_write_mask_ = 0;
     
 	read_depth_stencil_ = nullptr;
 	write_depth_stencil_ = nullptr;
+	quantize_depth_ = quantize_depth_none;
+
+	color_target_count_ = 0;
+	written_target_count_ = 0;
+	for(size_t i = 0; i < MAX_RENDER_TARGETS; ++i)
+	{
+		color_writers_[i] = nullptr;
+		color_quad_writers_[i] = nullptr;
+	}
+
+	stages_ = nullptr;
+	om_quad_func_ = nullptr;
+	ds_planes_ = nullptr;
+	oit_lists_ = nullptr;
+	early_z_quad_ = nullptr;
+
+	parent_ = nullptr;
+	memset( tile_rect_, 0, sizeof(tile_rect_) );
 }
 
 framebuffer::~framebuffer()
@@ -566,16 +1374,20 @@ framebuffer::~framebuffer()
 
 void framebuffer::render_sample(cpp_blend_shader* cpp_bs, size_t x, size_t y, size_t i_sample, const ps_output& ps, float depth, bool front_face)
 {
-	EFLIB_ASSERT(cpp_bs, "Blend shader is null or invalid.");
-	if(!cpp_bs) return;
-
 	//composing output
     pixel_accessor target_pixel(color_targets_, ds_target_);
 	target_pixel.set_pos(x, y);
     
 	if(early_z_enabled_)
 	{
-		cpp_bs->execute(i_sample, target_pixel, ps);
+		if(cpp_bs)
+		{
+			cpp_bs->execute(i_sample, target_pixel, ps);
+		}
+		else
+		{
+			write_color(x, y, i_sample, ps);
+		}
 		return;
 	}
 
@@ -584,21 +1396,61 @@ void framebuffer::render_sample(cpp_blend_shader* cpp_bs, size_t x, size_t y, si
     uint32_t    old_stencil;
     read_depth_stencil_(old_depth, old_stencil, stencil_read_mask_, ds_data);
 
+    depth = quantize_depth_(depth);
     bool depth_passed	= ds_state_->depth_test(depth, old_depth);
     bool stencil_passed = ds_state_->stencil_test(front_face, stencil_ref_, old_stencil);
 
 	if (depth_passed && stencil_passed)
 	{
 		int32_t new_stencil = ds_state_->stencil_operation(front_face, depth_passed, stencil_passed, stencil_ref_, old_stencil);
-		cpp_bs->execute(i_sample, target_pixel, ps);
+		if(cpp_bs)
+		{
+			cpp_bs->execute(i_sample, target_pixel, ps);
+		}
+		else
+		{
+			write_color(x, y, i_sample, ps);
+		}
         write_depth_stencil_(ds_data, depth, new_stencil, stencil_write_mask_);
 	}
 }
 
 void framebuffer::render_sample_quad(cpp_blend_shader* cpp_bs, size_t x, size_t y, uint64_t sample_mask, ps_output const* quad, float const* depth, bool front_face, float const* aa_offset)
 {
-	EFLIB_ASSERT(cpp_bs, "Blend shader is null or invalid.");
-	if(!cpp_bs) return;
+	x -= tile_rect_[0];
+	y -= tile_rect_[1];
+
+	if(cpp_bs == nullptr && om_quad_func_ != nullptr)
+	{
+		om_quad_func_(&om_quad_data_, x, y, sample_mask, quad, depth, aa_offset);
+		return;
+	}
+
+	// Transparent fragments are kept until resolve, so neither blend shader nor color writers are used.
+	if(oit_lists_ != nullptr)
+	{
+		if(!early_z_enabled_)
+		{
+			sample_mask = late_z_test_quad(x, y, sample_mask, depth, front_face, aa_offset);
+		}
+		append_fragments(x, y, sample_mask, quad, depth, aa_offset);
+		return;
+	}
+
+	// Without blend shader, depth and stencil of all samples are resolved first,
+	// then each written target stores the whole quad in its native format.
+	if(cpp_bs == nullptr)
+	{
+		if(!early_z_enabled_)
+		{
+			sample_mask = late_z_test_quad(x, y, sample_mask, depth, front_face, aa_offset);
+		}
+		if(sample_mask != 0)
+		{
+			write_color_quad(x, y, sample_mask, quad);
+		}
+		return;
+	}
 
 	for(int i = 0; i < 4; ++i)
 	{
@@ -636,8 +1488,67 @@ void framebuffer::render_sample_quad(cpp_blend_shader* cpp_bs, size_t x, size_t
 	}
 }
 
+void framebuffer::append_fragments(size_t x, size_t y, uint64_t quad_mask, ps_output const* quad, float const* depth, float const* aa_offset)
+{
+	for(int i = 0; i < 4; ++i)
+	{
+		uint32_t px_sample_mask = static_cast<uint32_t>( (quad_mask >> (i * MAX_SAMPLE_COUNT)) & SAMPLE_MASK );
+		uint32_t i_samp;
+		while ( _xmm_bsf(&i_samp, px_sample_mask) )
+		{
+			float const sample_depth = (sample_count_ == 1) ? depth[i] : depth[i] + aa_offset[i_samp];
+			oit_lists_->append(tile_rect_[0] + x + (i & 1), tile_rect_[1] + y + ( (i & 2) >> 1 ), i_samp, quad[i].color[0], sample_depth);
+			px_sample_mask &= px_sample_mask - 1;
+		}
+	}
+}
+
+uint64_t framebuffer::late_z_test_quad(size_t x, size_t y, uint64_t quad_mask, float const* depth, bool front_face, float const* aa_offset)
+{
+	uint64_t passed = 0;
+	for(int i = 0; i < 4; ++i)
+	{
+		uint32_t px_sample_mask = static_cast<uint32_t>( (quad_mask >> (i * MAX_SAMPLE_COUNT)) & SAMPLE_MASK );
+		if(px_sample_mask == 0)
+		{
+			continue;
+		}
+
+		uint8_t* ds_texels = static_cast<uint8_t*>( ds_target_->texel_address(x + (i & 1), y + ( (i & 2) >> 1 ), 0) );
+		size_t const ds_texel_size = color_infos[ds_target_->get_pixel_format()].size;
+
+		uint32_t i_samp;
+		while ( _xmm_bsf(&i_samp, px_sample_mask) )
+		{
+			px_sample_mask &= px_sample_mask - 1;
+
+			float const sample_depth = quantize_depth_( (sample_count_ == 1) ? depth[i] : depth[i] + aa_offset[i_samp] );
+
+			void*		ds_data = ds_texels + i_samp * ds_texel_size;
+			float		old_depth;
+			uint32_t	old_stencil;
+			read_depth_stencil_(old_depth, old_stencil, stencil_read_mask_, ds_data);
+
+			bool depth_passed	= ds_state_->depth_test(sample_depth, old_depth);
+			bool stencil_passed = ds_state_->stencil_test(front_face, stencil_ref_, old_stencil);
+			if (depth_passed && stencil_passed)
+			{
+				int32_t new_stencil = ds_state_->stencil_operation(front_face, depth_passed, stencil_passed, stencil_ref_, old_stencil);
+				write_depth_stencil_(ds_data, sample_depth, new_stencil, stencil_write_mask_);
+				passed |= 1ULL << (i * MAX_SAMPLE_COUNT + i_samp);
+			}
+		}
+	}
+	return passed;
+}
+
 uint64_t framebuffer::early_z_test(size_t x, size_t y, float depth, float const* aa_z_offset)
 {
+	if(ds_planes_ != nullptr)
+	{
+		ds_planes_->decompress(x, y);
+	}
+
     pixel_accessor target_pixel(color_targets_, ds_target_);
 	target_pixel.set_pos(x, y);
     
@@ -647,6 +1558,7 @@ uint64_t framebuffer::early_z_test(size_t x, size_t y, float depth, float const*
         float       old_depth;
         uint32_t    old_stencil;
         read_depth_stencil_(old_depth, old_stencil, stencil_read_mask_, ds_data);
+        depth = quantize_depth_(depth);
         if( ds_state_->depth_test(depth, old_depth) )
 		{
 			assert( !ds_state_->get_desc().stencil_enable );
@@ -663,7 +1575,7 @@ uint64_t framebuffer::early_z_test(size_t x, size_t y, float depth, float const*
         float       old_depth;
         uint32_t    old_stencil;
         read_depth_stencil_(old_depth, old_stencil, stencil_read_mask_, ds_data);
-		float new_depth = aa_z_offset[i] + depth;
+		float new_depth = quantize_depth_(aa_z_offset[i] + depth);
 		bool depth_test_passed = ds_state_->depth_test(new_depth, old_depth);
         mask |= ( depth_test_passed ? 1 : 0 ) << i;
 		if(depth_test_passed)
@@ -675,8 +1587,19 @@ uint64_t framebuffer::early_z_test(size_t x, size_t y, float depth, float const*
     return mask;
 }
 
-uint64_t framebuffer::early_z_test_quad(size_t x, size_t y, float const* depth, float const* aa_z_offset)
+uint64_t framebuffer::early_z_test_quad(size_t x, size_t y, float const* depth, float const* aa_z_offset, depth_plane const* z_plane)
 {
+	x -= tile_rect_[0];
+	y -= tile_rect_[1];
+
+	if( (ds_planes_ != nullptr && z_plane != nullptr) || early_z_quad_ != nullptr )
+	{
+		uint64_t px_mask = px_full_mask_;
+		uint64_t quad_mask = 
+			px_mask | (px_mask << MAX_SAMPLE_COUNT) | (px_mask << (MAX_SAMPLE_COUNT * 2)) | (px_mask << (MAX_SAMPLE_COUNT * 3));
+		return early_z_test_quad_local(x, y, quad_mask, depth, aa_z_offset, z_plane);
+	}
+
 	return 
 		( early_z_test(x+0, y+0, depth[0], aa_z_offset) << (MAX_SAMPLE_COUNT * 0) ) |
 		( early_z_test(x+1, y+0, depth[1], aa_z_offset) << (MAX_SAMPLE_COUNT * 1) )	|
@@ -691,6 +1614,11 @@ uint64_t framebuffer::early_z_test(size_t x, size_t y, uint32_t px_mask, float d
 		return early_z_test(x, y, depth, aa_z_offset);
 	}
 
+	if(ds_planes_ != nullptr)
+	{
+		ds_planes_->decompress(x, y);
+	}
+
 	pixel_accessor target_pixel(color_targets_, ds_target_);
 	target_pixel.set_pos(x, y);
 
@@ -702,7 +1630,7 @@ uint64_t framebuffer::early_z_test(size_t x, size_t y, uint32_t px_mask, float d
 		float       old_depth;
 		uint32_t    old_stencil;
 		read_depth_stencil_(old_depth, old_stencil, stencil_read_mask_, ds_data);
-		float new_depth = aa_z_offset[i_samp] + depth;
+		float new_depth = quantize_depth_(aa_z_offset[i_samp] + depth);
 		bool depth_test_passed = ds_state_->depth_test(new_depth, old_depth);
         mask |= ( depth_test_passed ? 1 : 0 ) << i_samp;
 		if(depth_test_passed)
@@ -714,8 +1642,32 @@ uint64_t framebuffer::early_z_test(size_t x, size_t y, uint32_t px_mask, float d
 	return mask;
 }
 
-uint64_t framebuffer::early_z_test_quad(size_t x, size_t y, uint64_t quad_mask, float const* depth, float const* aa_z_offset)
+uint64_t framebuffer::early_z_test_quad(size_t x, size_t y, uint64_t quad_mask, float const* depth, float const* aa_z_offset, depth_plane const* z_plane)
+{
+	return early_z_test_quad_local(x - tile_rect_[0], y - tile_rect_[1], quad_mask, depth, aa_z_offset, z_plane);
+}
+
+uint64_t framebuffer::early_z_test_quad_local(size_t x, size_t y, uint64_t quad_mask, float const* depth, float const* aa_z_offset, depth_plane const* z_plane)
 {
+	if(ds_planes_ != nullptr && z_plane != nullptr)
+	{
+		uint64_t mask;
+		if( ds_planes_->test_quad(
+			mask, x, y, quad_mask, depth, *z_plane,
+			ds_state_->get_desc().depth_func, ds_state_->get_desc().depth_write_mask) )
+		{
+			return mask;
+		}
+	}
+
+	if(early_z_quad_ != nullptr)
+	{
+		return early_z_quad_(
+			ds_target_, x, y, quad_mask, depth, aa_z_offset, sample_count_,
+			ds_state_->get_desc().depth_func, ds_state_->get_desc().depth_write_mask
+			);
+	}
+
 	uint32_t px_mask;
 	
 	uint64_t mask = 0;
@@ -734,6 +1686,23 @@ uint64_t framebuffer::early_z_test_quad(size_t x, size_t y, uint64_t quad_mask,
 	return mask;
 }
 
+template <uint32_t Format>
+static void (*select_clear_op(uint32_t flag))(void*, float, uint32_t, uint32_t)
+{
+	switch(flag)
+	{
+	case (clear_depth | clear_stencil):
+		return write_depth_1_stencil_1<Format>;
+	case clear_depth:
+		return write_depth_1_stencil_0<Format>;
+	case clear_stencil:
+		return write_depth_0_stencil_1<Format>;
+	default:
+		EFLIB_ASSERT_UNIMPLEMENTED();
+		return write_depth_0_stencil_0;
+	}
+}
+
 void framebuffer::clear_depth_stencil(surface* tar, uint32_t flag, float depth, uint32_t stencil)
 {
 	auto clear_op = write_depth_0_stencil_0;
@@ -741,27 +1710,24 @@ void framebuffer::clear_depth_stencil(surface* tar, uint32_t flag, float depth,
 	switch(tar->get_pixel_format())
     {
     case pixel_format_color_rg32f:
-		{
-			switch(flag)
-			{
-			case (clear_depth | clear_stencil):
-				clear_op = write_depth_1_stencil_1<pixel_format_color_rg32f>;
-				break;
-			case clear_depth:
-				clear_op = write_depth_1_stencil_0<pixel_format_color_rg32f>;
-				break;
-			case clear_stencil:
-				clear_op = write_depth_0_stencil_1<pixel_format_color_rg32f>;
-				break;
-			default:
-				EFLIB_ASSERT_UNIMPLEMENTED();
-			}
-			break;
-		}
+		clear_op = select_clear_op<pixel_format_color_rg32f>(flag);
+		break;
+	case pixel_format_color_d32f:
+		clear_op = select_clear_op<pixel_format_color_d32f>(flag);
+		break;
+	case pixel_format_color_d24s8:
+		clear_op = select_clear_op<pixel_format_color_d24s8>(flag);
+		break;
+	case pixel_format_color_d16:
+		clear_op = select_clear_op<pixel_format_color_d16>(flag);
+		break;
 	default:
 		EFLIB_ASSERT_UNIMPLEMENTED();
 	}
 
+	// Partial clear keeps other channel, so pending clear must be materialized first.
+	tar->resolve_clear();
+
 	for(size_t y = 0; y < tar->height(); ++y)
 	{
 		for(size_t x = 0; x < tar->width(); ++x)
@@ -5,176 +5,303 @@
 #include <salviar/include/thread_pool.h>
 #include <salviar/include/vertex_cache.h>
 #include <salviar/include/shader_regs.h>
+#include <salviar/include/shader_regs_op.h>
 
 #include <eflib/include/math/math.h>
 #include <eflib/include/platform/cpuinfo.h>
 
+#include <algorithm>
+
 using boost::shared_array;
-using boost::atomic;
-using eflib::clampss;
+using std::make_pair;
+using std::vector;
 
 int const GEOMETRY_SETUP_PACKAGE_SIZE = 8;
-int const COMPACT_CLIPPED_VERTS_PACKAGE_SIZE = 8;
+size_t const PROJECTED_VERTS_TABLE_SIZE = 1024;
 
 BEGIN_NS_SALVIAR();
 
 geom_setup_engine::geom_setup_engine():
 	ctxt_(NULL),
-	clipping_package_count_(0),
-	clipped_verts_cap_(0),
-	clipped_package_verts_count_cap_(0),
-	clipped_package_compacted_addresses_cap_(0),
-	compacted_verts_cap_(0),
 	thread_count_( eflib::num_available_threads() )
 {
 }
 
-void geom_setup_engine::execute(geom_setup_context const* ctxt, uint64_t (*fetch_time_stamp)())
+void geom_setup_engine::execute(geom_setup_context const* ctxt)
 {
 	ctxt_ = ctxt;
 
-	clip_geometries();
-	compact_start_time_ = fetch_time_stamp();
-	compact_geometries();
-}
-
-void geom_setup_engine::clip_geometries()
-{
-	clipping_package_count_ = thread_context::compute_package_count(
-		ctxt_->prim_count, GEOMETRY_SETUP_PACKAGE_SIZE
-		);
-
-	if(clipping_package_count_ > clipped_package_verts_count_cap_)
-	{
-		clipped_package_verts_count_.reset(new uint32_t[clipping_package_count_]);
-		clipped_package_verts_count_cap_ = clipping_package_count_;
-	}
-
-	// Initialize resource used by clipper.
-	if( clipped_verts_cap_ < ctxt_->prim_count * 3 * 3)
-	{
-		clipped_verts_.reset(new vs_output* [ctxt_->prim_count * 3 * 3]);	// Every triangle can clipped out 3 triangles at most.
-		clipped_verts_cap_ = ctxt_->prim_count * 3 * 3;
-	}
-
 	if(!vso_pools_)
 	{
 		vso_pools_.reset(new vs_output_pool[thread_count_]);
+		projected_pools_.reset(new vs_output_pool[thread_count_]);
+		projected_verts_.resize(thread_count_);
 	}
 
+	// Verts are stored compactly by count of attributes.
+	size_t const vso_size = ctxt_->vso_ops->compact_size;
+
+	// Two clipping plane. In extreme case, there are 4 verts generated by clipper for a triangle,
+	// and 2 verts for each edge of wireframe triangle.
+	size_t const max_clipped_verts = (pt_wireframe_tri == ctxt_->prim) ? 6 : 4;
+
 	for(size_t i = 0; i < thread_count_; ++ i)
 	{
 		vso_pools_[i].clear();
-		vso_pools_[i].reserve(ctxt_->prim_count * 4, 16);	// Two clipping plane. In extreme case, there are 4 verts generated by clipper.
+		vso_pools_[i].reserve(ctxt_->prim_count * max_clipped_verts, 16, vso_size);
+		projected_pools_[i].clear();
+		projected_pools_[i].reserve(ctxt_->prim_count * 3, 16, vso_size);	// Verts from vertex cache are projected once per primitive at most.
+		projected_verts_[i].assign( PROJECTED_VERTS_TABLE_SIZE, projected_vert(NULL, NULL) );
 	}
 
 	// Execute threads
 	execute_threads(
-		[this] (thread_context const* thread_ctx) -> void { this->threaded_clip_geometries(thread_ctx); },
+		[this] (thread_context const* thread_ctx) -> void { this->threaded_setup_geometries(thread_ctx); },
 		ctxt_->prim_count, GEOMETRY_SETUP_PACKAGE_SIZE
 		);
 
 	ctxt_->dvc->update_statistic();
 }
 
-void geom_setup_engine::threaded_clip_geometries(thread_context const* thread_ctx)
+vs_output* geom_setup_engine::project(vs_output* vert, uint32_t thread_id, projected_vert* prim_verts, uint32_t& prim_verts_count)
 {
-	clip_context clip_ctxt;
-	clip_ctxt.vert_pool	= &(vso_pools_[thread_ctx->thread_id]);
-	clip_ctxt.vso_ops	= ctxt_->vso_ops;
-	clip_ctxt.cull		= ctxt_->cull;
-	clip_ctxt.prim		= ctxt_->prim;
-
-	clipper clp;
-	clp.set_context(&clip_ctxt);
-
-	clip_results clip_rslt;
-
-    uint32_t clip_invocations = 0;
-
-	thread_context::package_cursor cur = thread_ctx->next_package();
-	while( cur.valid() )
+	// Verts of current primitive are looked up first, because verts generated by clipper are projected in place
+	// and they must not be projected twice even if they were evicted from table.
+	for(uint32_t i = 0; i < prim_verts_count; ++i)
 	{
-		std::pair<int32_t, int32_t> prim_range = cur.item_range();
+		if(prim_verts[i].first == vert)
+		{
+			return prim_verts[i].second;
+		}
+	}
 
-		clip_rslt.clipped_verts		  = clipped_verts_.get() + prim_range.first * 9;
-		uint32_t& clipped_verts_count = clipped_package_verts_count_[ cur.package_index() ];
+	vs_output_pool& clipped_pool = vso_pools_[thread_id];
+	bool const is_clipped_vert = clipped_pool.contains(vert);
 
-		clipped_verts_count = 0;
-		for (int32_t i = prim_range.first; i < prim_range.second; ++ i)
+	projected_vert* slot = NULL;
+	if(!is_clipped_vert)
+	{
+		size_t slot_index = ( reinterpret_cast<uintptr_t>(vert) / sizeof(eflib::vec4) ) & (PROJECTED_VERTS_TABLE_SIZE - 1);
+		slot = &projected_verts_[thread_id][slot_index];
+		if(slot->first == vert)
 		{
-			if (3 == ctxt_->prim_size)
-			{
-				vs_output* pv[3];
-				ctxt_->dvc->fetch3(pv, i, thread_ctx->thread_id);
+			prim_verts[prim_verts_count++] = *slot;
+			return slot->second;
+		}
+	}
 
-                ++clip_invocations;
-				clp.clip(pv, &clip_rslt);
+	// Verts from vertex cache may be shared with primitives on other threads, which are still clipped
+	// with clip space position. So they are copied before projection.
+	vs_output* ret = vert;
+	if(!is_clipped_vert)
+	{
+		ret = projected_pools_[thread_id].alloc();
+		ctxt_->vso_ops->copy(*ret, *vert);
+	}
 
-				// Step output to next range, sum total clipped verts count
-				clip_rslt.clipped_verts += clip_rslt.num_clipped_verts;
-				clipped_verts_count += clip_rslt.num_clipped_verts;
-			}
-			else if (2 == ctxt_->prim_size)
-			{
-				assert(false);
-			}
-		}
+	viewport_transform(ret->position(), *ctxt_->vp);
+	ctxt_->vso_ops->project(*ret, *ret);
 
-		cur = thread_ctx->next_package();
+	prim_verts[prim_verts_count++] = make_pair(vert, ret);
+	if(slot)
+	{
+		*slot = make_pair(vert, ret);
 	}
 
-    ctxt_->acc_cinvocations(ctxt_->pipeline_stat, clip_invocations);
+	return ret;
 }
 
-void geom_setup_engine::compact_geometries()
+bool geom_setup_engine::is_culled(vs_output* const* tri_verts) const
 {
-	// Compute compacted address of packages.
-	if(clipped_package_compacted_addresses_cap_ < clipping_package_count_ + 1)
+	eflib::vec4 const& pos0 = tri_verts[0]->position();
+	eflib::vec4 const& pos1 = tri_verts[1]->position();
+	eflib::vec4 const& pos2 = tri_verts[2]->position();
+
+	// Facing of triangle which crosses w = 0 could not be computed in screen space, so it is kept.
+	if(pos0.w() <= 0.0f || pos1.w() <= 0.0f || pos2.w() <= 0.0f)
 	{
-		clipped_package_compacted_addresses_.reset(new uint32_t[clipping_package_count_+1]);
-		clipped_package_compacted_addresses_cap_ = clipping_package_count_ + 1;
+		return false;
 	}
-	
-	uint32_t* addresses = clipped_package_compacted_addresses_.get();
-	addresses[0] = 0;
-	for (int i = 1; i <= clipping_package_count_; ++ i)
+
+	eflib::vec2 const p0 = pos0.xy() * (1.0f / pos0.w());
+	eflib::vec2 const p1 = pos1.xy() * (1.0f / pos1.w());
+	eflib::vec2 const p2 = pos2.xy() * (1.0f / pos2.w());
+
+	float const area = (p2.x() - p0.x()) * (p1.y() - p0.y()) - (p2.y() - p0.y()) * (p1.x() - p0.x());
+	return ctxt_->cull(area);
+}
+
+bool geom_setup_engine::is_edge_drawn(uint32_t tri_id, uint32_t edge, uint32_t thread_id) const
+{
+	uint32_t const ppi = static_cast<uint32_t>(ctxt_->prims_per_instance);
+	uint32_t const inst_base = tri_id - tri_id % ppi;
+	uint32_t const owner = ctxt_->edge_owners[(tri_id - inst_base) * 3 + edge];
+	if(owner == SELF_OWNED_EDGE)
 	{
-		addresses[i] = addresses[i-1] + clipped_package_verts_count_[i-1];
+		return true;
 	}
 
-	if(compacted_verts_cap_ < addresses[clipping_package_count_])
+	if(!ctxt_->culling)
 	{
-		compacted_verts_.reset(new vs_output*[ addresses[clipping_package_count_] ]);
-		compacted_verts_cap_ = addresses[clipping_package_count_];
+		return false;
 	}
 
-	// Execute threads for compacting
-	execute_threads(
-		[this] (thread_context const* thread_ctx) -> void { this->threaded_compact_geometries(thread_ctx); },
-		clipping_package_count_, COMPACT_CLIPPED_VERTS_PACKAGE_SIZE
-		);
+	vs_output* owner_verts[3];
+	ctxt_->dvc->fetch(owner_verts, inst_base + owner, thread_id);
+	return is_culled(owner_verts);
 }
 
-void geom_setup_engine::threaded_compact_geometries(thread_context const* thread_ctx)
+void geom_setup_engine::threaded_setup_geometries(thread_context const* thread_ctx)
 {
-	thread_context::package_cursor current_package = thread_ctx->next_package();
+	uint32_t const thread_id = static_cast<uint32_t>(thread_ctx->thread_id);
+
+	clip_context clip_ctxt;
+	clip_ctxt.vert_pool	= &(vso_pools_[thread_id]);
+	clip_ctxt.vso_ops	= ctxt_->vso_ops;
+	clip_ctxt.cull		= ctxt_->cull;
+	clip_ctxt.prim		= ctxt_->prim;
+
+	clipper clp;
+	clp.set_context(&clip_ctxt);
+
+	vs_output*			clipped_verts[CLIP_PACKET_SIZE * MAX_CLIPPED_TRIANGLES * 3];
+	uint32_t			clipped_verts_count[CLIP_PACKET_SIZE];
+	vs_output const*	setup_verts[GEOMETRY_SETUP_PACKAGE_SIZE * MAX_CLIPPED_TRIANGLES * 3];
+	uint32_t			setup_seqs[GEOMETRY_SETUP_PACKAGE_SIZE * MAX_CLIPPED_TRIANGLES];
 
-	while ( current_package.valid() )
+	geom_setup_package package;
+	package.thread_id	= thread_id;
+	package.verts		= setup_verts;
+	package.seqs		= setup_seqs;
+
+	clip_results clip_rslt;
+	clip_rslt.clipped_verts = clipped_verts;
+
+	vs_output*		clipped_line_verts[2];
+	clip_results	line_rslt;
+	line_rslt.clipped_verts = clipped_line_verts;
+
+    uint32_t clip_invocations = 0;
+	uint32_t clip_primitives = 0;
+
+	thread_context::package_cursor cur = thread_ctx->next_package();
+	while( cur.valid() )
 	{
-		std::pair<int32_t, int32_t> compact_range = current_package.item_range();
+		std::pair<int32_t, int32_t> prim_range = cur.item_range();
 
-		for (int32_t i = compact_range.first; i < compact_range.second; ++ i)
+		package.prim_count = 0;
+		for (int32_t i = prim_range.first; i < prim_range.second; )
 		{
-			vs_output** compacted_addr	= compacted_verts_.get() + clipped_package_compacted_addresses_[i];
-			vs_output** sparse_addr		= clipped_verts_.get() + GEOMETRY_SETUP_PACKAGE_SIZE * i * 9;
-			size_t		copy_size		= clipped_package_verts_count_[i] * sizeof(vs_output*);
+			if (pt_solid_tri == ctxt_->prim)
+			{
+				uint32_t tri_count = std::min<uint32_t>(CLIP_PACKET_SIZE, prim_range.second - i);
+
+				vs_output* pv[3 * CLIP_PACKET_SIZE];
+				for (uint32_t i_tri = 0; i_tri < tri_count; ++i_tri)
+				{
+					ctxt_->dvc->fetch(pv + i_tri * 3, i + i_tri, thread_id);
+				}
+
+                clip_invocations += tri_count;
+				clp.clip_packet(pv, tri_count, &clip_rslt, clipped_verts_count);
+
+				// Project verts and assign sequence numbers to clipped triangles.
+				vs_output** tri_verts = clipped_verts;
+				for (uint32_t i_tri = 0; i_tri < tri_count; ++i_tri)
+				{
+					projected_vert	prim_verts[MAX_CLIPPED_TRIANGLES * 3];
+					uint32_t		prim_verts_count = 0;
+
+					uint32_t const num_clipped_tris = clipped_verts_count[i_tri] / 3;
+					for (uint32_t i_clipped = 0; i_clipped < num_clipped_tris; ++i_clipped)
+					{
+						setup_seqs[package.prim_count] = (i + i_tri) * MAX_CLIPPED_TRIANGLES + i_clipped;
+						for (int i_vert = 0; i_vert < 3; ++i_vert)
+						{
+							setup_verts[package.prim_count * 3 + i_vert] =
+								project(tri_verts[i_clipped * 3 + i_vert], thread_id, prim_verts, prim_verts_count);
+						}
+						++package.prim_count;
+					}
+
+					tri_verts += clipped_verts_count[i_tri];
+				}
+
+				i += tri_count;
+			}
+			else if (pt_wireframe_tri == ctxt_->prim)
+			{
+				vs_output* tri[3];
+				ctxt_->dvc->fetch(tri, i, thread_id);
+				++clip_invocations;
+
+				if ( !(ctxt_->culling && is_culled(tri)) )
+				{
+					projected_vert	prim_verts[MAX_CLIPPED_TRIANGLES * 3];
+					uint32_t		prim_verts_count = 0;
+
+					for (uint32_t i_edge = 0; i_edge < 3; ++i_edge)
+					{
+						if ( !is_edge_drawn(i, i_edge, thread_id) )
+						{
+							continue;
+						}
+
+						vs_output* edge_verts[2] = { tri[i_edge], tri[(i_edge + 1) % 3] };
+						clp.clip(edge_verts, &line_rslt);
+						if (line_rslt.num_clipped_verts == 0)
+						{
+							continue;
+						}
+
+						setup_seqs[package.prim_count] = i * MAX_CLIPPED_TRIANGLES + i_edge;
+						for (int i_vert = 0; i_vert < 2; ++i_vert)
+						{
+							setup_verts[package.prim_count * 2 + i_vert] =
+								project(clipped_line_verts[i_vert], thread_id, prim_verts, prim_verts_count);
+						}
+						++package.prim_count;
+					}
+				}
+
+				++i;
+			}
+			else
+			{
+				vs_output* line[2];
+				ctxt_->dvc->fetch(line, i, thread_id);
+				++clip_invocations;
+
+				clp.clip(line, &line_rslt);
+				if (line_rslt.num_clipped_verts > 0)
+				{
+					projected_vert	prim_verts[2];
+					uint32_t		prim_verts_count = 0;
+
+					setup_seqs[package.prim_count] = i * MAX_CLIPPED_TRIANGLES;
+					for (int i_vert = 0; i_vert < 2; ++i_vert)
+					{
+						setup_verts[package.prim_count * 2 + i_vert] =
+							project(clipped_line_verts[i_vert], thread_id, prim_verts, prim_verts_count);
+					}
+					++package.prim_count;
+				}
+
+				++i;
+			}
+		}
 
-			memcpy(compacted_addr, sparse_addr, copy_size);
+		if (package.prim_count > 0)
+		{
+			clip_primitives += package.prim_count;
+			ctxt_->dispatch(&package);
 		}
 
-		current_package = thread_ctx->next_package();
+		cur = thread_ctx->next_package();
 	}
+
+    ctxt_->acc_cinvocations(ctxt_->pipeline_stat, clip_invocations);
+    ctxt_->acc_cprimitives(ctxt_->pipeline_stat, clip_primitives);
 }
 
 END_NS_SALVIAR();
@@ -2,6 +2,7 @@
 
 #include <salviar/include/clipper.h>
 #include <salviar/include/framebuffer.h>
+#include <salviar/include/depth_planes.h>
 #include <salviar/include/host.h>
 #include <salviar/include/render_state.h>
 #include <salviar/include/render_stages.h>
@@ -21,14 +22,11 @@
 
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/format.hpp>
+#include <boost/make_shared.hpp>
 #include <eflib/include/platform/boost_end.h>
 
 #include <algorithm>
 
-#if defined(EFLIB_MSVC)
-#include <ppl.h>
-#endif
-
 using eflib::num_available_threads;
 
 using boost::atomic;
@@ -42,8 +40,29 @@ using namespace eflib;
 using namespace boost;
 
 int const TILE_SIZE = 64;
-int const DISPATCH_PRIMITIVE_PACKAGE_SIZE = 8;
-int const VP_PROJ_TRANSFORM_PAKCAGE_SIZE = 8;
+int const SMALL_TRIANGLE_SIZE = 8;	// Triangle whose bounding box is not larger than it is a small triangle.
+
+// Vertex positions are snapped to 16.8 fixed point and samples are on 1/16 pixel grid.
+int const		SUBPIXEL_BITS		= 8;
+int const		SUBPIXEL_SCALE		= 1 << SUBPIXEL_BITS;
+int const		SAMPLE_POS_BITS		= 4;
+int32_t const	SAMPLE_POS_SCALE	= 1 << SAMPLE_POS_BITS;
+// Vertexes in [-FIXED_POINT_RANGE, FIXED_POINT_RANGE] pixels are snapped, so edge factors 'a' and 'b' are
+// less than 2 * 2^14 * 2^8 = 2^23. Samples of a 4x4 block are less than 4 pixels (64 steps of 1/16 pixel)
+// away from its top-left corner on each axis, so edge values of samples vary less than 2 * 64 * 2^23 = 2^30
+// from the corner. Corner value clamped to 2^30 keeps its sign after stepping, and stepped values are in int32.
+float const		FIXED_POINT_RANGE	= 16384.0f;
+int64_t const	EDGE_VALUE_CLAMP	= 1 << 30;
+// Float edge values of tile tests are rounded from values up to about 2^28 with 24-bit mantissa.
+// Tile is rejected or accepted only if it is farther than this relative tolerance from the edge.
+float const		TILE_TEST_EPSILON	= 1.0f / (1 << 18);
+
+// Bound of rounding error of edge value evaluated at coordinates in [0, coord_max].
+static float edge_test_tolerance(vec4 const& edge_factor, float coord_max)
+{
+	return ( fabs( edge_factor.z() ) + ( fabs( edge_factor.x() ) + fabs( edge_factor.y() ) ) * coord_max ) * TILE_TEST_EPSILON;
+}
+
 int const RASTERIZE_PRIMITIVE_PACKAGE_SIZE = 1;
 
 struct pixel_statistic
@@ -55,17 +74,17 @@ struct pixel_statistic
 struct drawing_triangle_context
 {
     float const*			aa_z_offset;
+	depth_plane const*		z_plane;
 	triangle_info const*	tri_info;
     pixel_statistic*		pixel_stat;
 };
 
 /*************************************************
- *   Steps for line rasterization
- *			1 Find major direction and computing distance and differential on major direction.
- *			2 Calculate ddx and ddy for mip-mapping.
- *			3 Computing pixel position and interpolated attribute by DDA with major direction and differential.
- *			4 Executing pixel shader
- *			5 Render pixel into framebuffer.
+ *   Steps for line rasterization:
+ *			1 Find major direction of line.
+ *			2 Step pixel centers in tile on major direction by DDA, two pixels per step,
+ *			  and gather pixels into quads.
+ *			3 Interpolate, shade and render quads by the same path of triangle.
  *
  *   Note:
  *			1 Position is in window coordinate.
@@ -75,142 +94,110 @@ struct drawing_triangle_context
 void rasterizer::rasterize_line(rasterize_prim_context const* ctx)
 {
 	// Extract to local variables
-    cpp_pixel_shader*	cpp_ps	= ctx->shaders.cpp_ps;
-    pixel_shader_unit*	psu		= ctx->shaders.ps_unit;
-	viewport  const&	vp		= *ctx->tile_vp;
-	vs_output const&	v0		= *clipped_verts_[ctx->prim_id*2+0];
-	vs_output const&	v1		= *clipped_verts_[ctx->prim_id*2+1];
-
-	// Rasterize
-	vs_output diff;
-	vso_ops_->sub(diff, v1, v0);
-	eflib::vec4 const& dir = diff.position();
-	float diff_dir = abs(dir.x()) > abs(dir.y()) ? dir.x() : dir.y();
-
-	// Computing differential.
-	vs_output ddx, ddy;
-	vso_ops_->mul(ddx, diff, (diff.position().x() / (diff.position().xy().length_sqr())));
-	vso_ops_->mul(ddy, diff, (diff.position().y() / (diff.position().xy().length_sqr())));
-
-	int vpleft  = fast_floori( max(0.0f, vp.x) );
-	int vptop   = fast_floori( max(0.0f, vp.y) );
-    int vpright = fast_floori( min(vp.x+vp.w, target_vp_->w) );
-    int vpbottom= fast_floori( min(vp.y+vp.h, target_vp_->h) );
-
-	ps_output px_out;
-
-	// Divided drawing to x major DDA method and y major DDA method.
-	if( abs(dir.x()) > abs(dir.y()))
-	{
-		//Swap start and end to make diff is positive.
-		const vs_output *start, *end;
-		if(dir.x() < 0){
-			start = &v1;
-			end = &v0;
-			diff_dir = -diff_dir;
-		} else {
-			start = &v0;
-			end = &v1;
-		}
+    cpp_pixel_shader*	 cpp_ps		= ctx->shaders.cpp_ps;
+	viewport const&		 vp			= *ctx->tile_vp;
+	triangle_info const* line_info	= &ctx->prim->tri_info;
+	vec4 const&			 pos0		= ctx->prim->verts[0]->position();
+	vec4 const&			 pos1		= ctx->prim->verts[1]->position();
+
+	float const dx		= pos1.x() - pos0.x();
+	float const dy		= pos1.y() - pos0.y();
+	bool  const x_major	= abs(dx) >= abs(dy);
+	float const slope	= x_major ? dy / dx : dx / dy;
+
+	// Coordinates on major and minor direction. Start point has less major coordinate.
+	float major0 = x_major ? pos0.x() : pos0.y();
+	float major1 = x_major ? pos1.x() : pos1.y();
+	float minor0 = x_major ? pos0.y() : pos0.x();
+	if(major1 < major0)
+	{
+		std::swap(major0, major1);
+		minor0 = x_major ? pos1.y() : pos1.x();
+	}
 
-		EFLIB_ASSERT_UNIMPLEMENTED();
+	int tile_left		= fast_floori( max(0.0f, vp.x) );
+	int tile_top		= fast_floori( max(0.0f, vp.y) );
+    int tile_right		= fast_floori( min(vp.x + vp.w, target_vp_->w) );
+    int tile_bottom		= fast_floori( min(vp.y + vp.h, target_vp_->h) );
+	if(scissor_enable_)
+	{
+		tile_left	= max(tile_left,	scissor_bounds_[0]);
+		tile_top	= max(tile_top,		scissor_bounds_[1]);
+		tile_right	= min(tile_right,	scissor_bounds_[2]);
+		tile_bottom	= min(tile_bottom,	scissor_bounds_[3]);
+	}
 
-		float fsx = fast_floor(start->position().x() + 0.5f);
+	int const tile_minor0	= x_major ? tile_top	: tile_left;
+	int const tile_minor1	= x_major ? tile_bottom	: tile_right;
 
-		int sx = fast_floori(fsx);
-		int ex = fast_floori(end->position().x() - 0.5f);
+	// Pixels whose centers are in [major0, major1) are drawn, so joint of line strip is drawn once.
+	int const sm = std::max( fast_ceili(major0 - 0.5f), x_major ? tile_left  : tile_top    );
+	int const em = std::min( fast_ceili(major1 - 0.5f), x_major ? tile_right : tile_bottom );
+	if(sm >= em)
+	{
+		return;
+	}
 
-		// Clamp to visible screen.
-		sx = eflib::clamp<int>(sx, vpleft, int(vpright - 1));
-		ex = eflib::clamp<int>(ex, vpleft, int(vpright));
+	float aa_z_offset[MAX_NUM_MULTI_SAMPLES];
+	for (unsigned long i_sample = 0; i_sample < target_sample_count_; ++ i_sample)
+	{
+		const vec2& sp = samples_pattern_[i_sample];
+		aa_z_offset[i_sample] = (sp.x() - 0.5f) * line_info->planes.a[0].z() + (sp.y() - 0.5f) * line_info->planes.b[0].z();
+	}
 
-		// Set attributes of start point.
-		vs_output px_start, px_end;
-		vso_ops_->copy(px_start, *start);
-		vso_ops_->copy(px_end, *end);
-		float step = sx + 0.5f - start->position().x();
-		vs_output px_in;
-		vso_ops_->lerp(px_in, px_start, px_end, step / diff_dir);
+    drawing_triangle_context line_ctx;
+    line_ctx.aa_z_offset	= aa_z_offset;
+	line_ctx.z_plane		= nullptr;
+    line_ctx.pixel_stat		= ctx->pixel_stat;
+	line_ctx.tri_info		= line_info;
+	if (cpp_ps != nullptr)
+	{
+		cpp_ps->update_front_face(line_info->front_face);
+	}
 
-		// Draw line with x major DDA.
-		vs_output unprojed;
-		for(int iPixel = sx; iPixel < ex; ++iPixel)
+	// Pixels on two adjacent major coordinates are in one or two quads.
+	for(int m = sm & ~1; m < em; m += 2)
+	{
+		uint32_t	quad_minor[2];
+		uint64_t	quad_masks[2];
+		int			num_quads = 0;
+
+		for(int i = 0; i < 2; ++i)
 		{
-			// Ingore pixels which are outside of viewport.
-			if(px_in.position().y() >= vpbottom){
-				if(dir.y() > 0) break;
+			int const pm = m + i;
+			if(pm < sm || pm >= em)
+			{
 				continue;
 			}
-			if(px_in.position().y() < 0){
-				if(dir.y() < 0) break;
+
+			int const pn = fast_floori( minor0 + (pm + 0.5f - major0) * slope );
+			if(pn < tile_minor0 || pn >= tile_minor1)
+			{
 				continue;
 			}
 
-			// Render pixel.
-			vso_ops_->unproject(unprojed, px_in);
+			int const px = x_major ? pm : pn;
+			int const py = x_major ? pn : pm;
+			uint64_t const pixel_mask = full_mask_ << ( ( (px & 1) + (py & 1) * 2 ) * MAX_SAMPLE_COUNT );
 
-#if 0
-			if(cpp_ps->execute(unprojed, px_out))
+			uint32_t const qn = static_cast<uint32_t>(pn & ~1);
+			if(num_quads > 0 && quad_minor[num_quads-1] == qn)
 			{
-				frame_buffer_->render_sample(cpp_bs_, iPixel, fast_floori(px_in.position().y()), 0, px_out, px_out.depth);
+				quad_masks[num_quads-1] |= pixel_mask;
+			}
+			else
+			{
+				quad_minor[num_quads] = qn;
+				quad_masks[num_quads] = pixel_mask;
+				++num_quads;
 			}
-#endif
-			// Increment ddx
-			++ step;
-			vso_ops_->lerp(px_in, px_start, px_end, step / diff_dir);
-		}
-	}
-	else //y major
-	{
-		const vs_output *start, *end;
-		if(dir.y() < 0){
-			start = &v1;
-			end = &v0;
-			diff_dir = -diff_dir;
-		} else {
-			start = &v0;
-			end = &v1;
 		}
 
-		EFLIB_ASSERT_UNIMPLEMENTED();
-		
-		float fsy = fast_floor(start->position().y() + 0.5f);
-
-		int sy = fast_floori(fsy);
-		int ey = fast_floori(end->position().y() - 0.5f);
-
-		sy = eflib::clamp<int>(sy, vptop, int(vpbottom - 1));
-		ey = eflib::clamp<int>(ey, vptop, int(vpbottom));
-
-		vs_output px_start, px_end;
-		vso_ops_->copy(px_start, *start);
-		vso_ops_->copy(px_end, *end);
-		float step = sy + 0.5f - start->position().y();
-		vs_output px_in;
-		vso_ops_->lerp(px_in, px_start, px_end, step / diff_dir);
-
-		vs_output unprojed;
-		for(int iPixel = sy; iPixel < ey; ++iPixel)
+		for(int i_quad = 0; i_quad < num_quads; ++i_quad)
 		{
-			if(px_in.position().x() >= vpright){
-				if(dir.x() > 0) break;
-				continue;
-			}
-			if(px_in.position().x() < 0){
-				if(dir.x() < 0) break;
-				continue;
-			}
-
-			vso_ops_->unproject(unprojed, px_in);
-
-#if 0
-			if(cpp_ps->execute(unprojed, px_out))
-			{
-				frame_buffer_->render_sample(cpp_bs_, fast_floori(px_in.position().x()), iPixel, 0, px_out, px_out.depth);
-			}
-#endif
-			++ step;
-			vso_ops_->lerp(px_in, px_start, px_end, step / diff_dir);
+			uint32_t const left	= x_major ? static_cast<uint32_t>(m) : quad_minor[i_quad];
+			uint32_t const top	= x_major ? quad_minor[i_quad] : static_cast<uint32_t>(m);
+			draw_quad(left, top, quad_masks[i_quad], &ctx->shaders, &line_ctx);
 		}
 	}
 }
@@ -222,6 +209,12 @@ void rasterizer::initialize(render_stages const* stages)
 	host_			= stages->host.get();
 }
 
+void rasterizer::update_draw_args(render_state const* state)
+{
+	index_fetcher_.update(state);
+	update_prim_info(state);
+}
+
 void rasterizer::update(render_state const* state)
 {
 	state_		            = state->ras_state.get();
@@ -233,6 +226,7 @@ void rasterizer::update(render_state const* state)
     target_vp_              = &(state->target_vp);
     target_sample_count_    = state->target_sample_count;
 	full_mask_				= (1ULL << target_sample_count_) - 1;
+	custom_samples_pattern_	= (target_sample_count_ > 1 && state->sample_position_count == target_sample_count_) ? state->sample_positions : nullptr;
 	quad_full_mask_			= 
 		( full_mask_ << (MAX_SAMPLE_COUNT * 0) ) |
 		( full_mask_ << (MAX_SAMPLE_COUNT * 1) ) |
@@ -242,7 +236,20 @@ void rasterizer::update(render_state const* state)
 	
 	vs_reflection_ = state->vx_shader ? state->vx_shader->get_reflection() : nullptr;
 
-	update_prim_info(state);
+	scissor_enable_			= state_->get_desc().scissor_enable;
+	scissor_bounds_[0]		= state->scissor.x;
+	scissor_bounds_[1]		= state->scissor.y;
+	scissor_bounds_[2]		= state->scissor.x + state->scissor.w;
+	scissor_bounds_[3]		= state->scissor.y + state->scissor.h;
+
+	sample_shading_			= state_->get_desc().sample_shading_enable && (target_sample_count_ > 1);
+	tile_buffer_enable_		= state_->get_desc().tile_buffer_enable;
+
+	// Depth written by pixel shader cannot be shared by pixels, so it is shaded per pixel.
+	bool const coarse_shading_disabled = sample_shading_ || (cpp_ps_ && cpp_ps_->output_depth());
+	shading_rate_			= coarse_shading_disabled ? shading_rate_1x1 : state_->get_desc().sr;
+
+	update_draw_args(state);
 
     // Initialize statistics.
     pipeline_stat_ = state->asyncs[static_cast<uint32_t>(async_object_ids::pipeline_statistics)].get();
@@ -276,19 +283,13 @@ void rasterizer::update(render_state const* state)
 	if(pipeline_prof_)
 	{
 		fetch_time_stamp_	= &async_pipeline_profiles::time_stamp;
-		acc_vp_trans_		= &async_pipeline_profiles::accumulate<pipeline_profile_id::vp_trans>;
-		acc_tri_dispatch_	= &async_pipeline_profiles::accumulate<pipeline_profile_id::tri_dispatch>;
 		acc_ras_			= &async_pipeline_profiles::accumulate<pipeline_profile_id::ras>;
 		acc_clipping_		= &async_pipeline_profiles::accumulate<pipeline_profile_id::clipping>;
-		acc_compact_clip_	= &async_pipeline_profiles::accumulate<pipeline_profile_id::compact_clip>;
 	}
 	else
 	{
 		fetch_time_stamp_	= &time_stamp_fn::null;
 		acc_clipping_		= &accumulate_fn<uint64_t>::null;
-		acc_compact_clip_   = &accumulate_fn<uint64_t>::null;
-		acc_vp_trans_		= &accumulate_fn<uint64_t>::null;
-		acc_tri_dispatch_	= &accumulate_fn<uint64_t>::null;
 		acc_ras_			= &accumulate_fn<uint64_t>::null;
 	}
 }
@@ -298,6 +299,24 @@ void rasterizer::draw_full_tile(
 	drawing_shader_context const* shaders,
 	drawing_triangle_context const* triangle_ctx)
 {
+	if(shading_rate_ != shading_rate_1x1)
+	{
+		for(int top = tile_top; top < tile_bottom; top += 4)
+		{
+			for(int left = tile_left; left < tile_right; left += 4)
+			{
+				uint64_t quad_masks[4];
+				for(int quad = 0; quad < 4; ++quad)
+				{
+					bool const inside = (left + ((quad & 1) << 1) < tile_right) && (top + (quad & 2) < tile_bottom);
+					quad_masks[quad] = inside ? quad_full_mask_ : 0;
+				}
+				draw_coarse_block(left, top, quad_masks, shaders, triangle_ctx);
+			}
+		}
+		return;
+	}
+
 	for(int top = tile_top; top < tile_bottom; top += 2)
 	{
 		for(int left = tile_left; left < tile_right; left += 2)
@@ -308,35 +327,14 @@ void rasterizer::draw_full_tile(
 }
 
 void rasterizer::draw_partial_tile(
-	int left0, int top0, int left, int top,
-	const eflib::vec4* edge_factors,
+	int left, int top,
 	drawing_shader_context const* shaders,
     drawing_triangle_context const* triangle_ctx)
 {
-    auto& v0 = *triangle_ctx->tri_info->v0;
-
-	size_t sx = left - left0;
-	size_t sy = top - top0;
-	const uint32_t full_mask = (1UL << target_sample_count_) - 1;
-
-#ifndef EFLIB_NO_SIMD
-	const __m128 mtx = _mm_set_ps(1, 0, 1, 0);
-	const __m128 mty = _mm_set_ps(1, 1, 0, 0);
+	triangle_info const* tri_info = triangle_ctx->tri_info;
 
-	__m128 medge0 = _mm_load_ps(&edge_factors[0].x());
-	__m128 medge1 = _mm_load_ps(&edge_factors[1].x());
-	__m128 medge2 = _mm_load_ps(&edge_factors[2].x());
-
-	__m128 mtmp = _mm_unpacklo_ps(medge0, medge1);
-	__m128 medgex = _mm_shuffle_ps(mtmp, medge2, _MM_SHUFFLE(3, 0, 1, 0));
-	__m128 medgey = _mm_shuffle_ps(mtmp, medge2, _MM_SHUFFLE(3, 1, 3, 2));
-	mtmp = _mm_unpackhi_ps(medge0, medge1);
-	__m128 medgez = _mm_shuffle_ps(mtmp, medge2, _MM_SHUFFLE(3, 2, 1, 0));
-
-	__m128 mleft = _mm_set1_ps(left);
-	__m128 mtop = _mm_set1_ps(top);
-	__m128 mevalue3 = _mm_sub_ps(medgez, _mm_add_ps(_mm_mul_ps(mleft, medgex), _mm_mul_ps(mtop, medgey)));
-#endif
+	int32_t const* edge_x = tri_info->fixed_edge_x;
+	int32_t const* edge_y = tri_info->fixed_edge_y;
 
 	EFLIB_ALIGN(16) uint32_t pixel_mask[4 * 4];
 
@@ -350,103 +348,163 @@ void rasterizer::draw_partial_tile(
 	memset(pixel_mask, 0, sizeof(pixel_mask));
 #endif
 
-#if !defined(EFLIB_NO_SIMD)
-	for (size_t i_sample = 0; i_sample < target_sample_count_; ++ i_sample)
+	if(!tri_info->fixed_edges)
 	{
-		const vec2& sp = samples_pattern_[i_sample];
-		__m128 mspx = _mm_set1_ps(sp.x());
-		__m128 mspy = _mm_set1_ps(sp.y());
-
-		for(int iy = 0; iy < 4; ++ iy)
+		// Triangle is out of fixed point range. Its edges are tested in float without fill rule.
+		vec4 const* edge_factors = tri_info->edge_factors;
+		for(int iy = 0; iy < 4; ++iy)
 		{
-			__m128 my = _mm_add_ps(mspy, _mm_set1_ps(iy));
-			__m128 mx = _mm_add_ps(mspx, _mm_set_ps(3, 2, 1, 0));
-			
-			__m128 mask_rej = _mm_setzero_ps();
+			for(int ix = 0; ix < 4; ++ix)
 			{
-				__m128 mstepx = _mm_shuffle_ps(medgex, medgex, _MM_SHUFFLE(0, 0, 0, 0));
-				__m128 mstepy = _mm_shuffle_ps(medgey, medgey, _MM_SHUFFLE(0, 0, 0, 0));
-				__m128 msteprej = _mm_add_ps(_mm_mul_ps(mx, mstepx), _mm_mul_ps(my, mstepy));
-
-				__m128 mevalue = _mm_shuffle_ps(mevalue3, mevalue3, _MM_SHUFFLE(0, 0, 0, 0));
+				for(size_t i_sample = 0; i_sample < target_sample_count_; ++i_sample)
+				{
+					vec2 const& sp = samples_pattern_[i_sample];
+					float const fx = left + ix + sp.x();
+					float const fy = top  + iy + sp.y();
+					bool inside = true;
+					for(int e = 0; e < 3; ++e)
+					{
+						if(fx * edge_factors[e].x() + fy * edge_factors[e].y() < edge_factors[e].z())
+						{
+							inside = false;
+							break;
+						}
+					}
 
-				mask_rej = _mm_or_ps(mask_rej, _mm_cmplt_ps(msteprej, mevalue));
+					if(inside)
+					{
+						pixel_mask[iy * 4 + ix] |= 1UL << i_sample;
+					}
+				}
 			}
-			{
-				__m128 mstepx = _mm_shuffle_ps(medgex, medgex, _MM_SHUFFLE(1, 1, 1, 1));
-				__m128 mstepy = _mm_shuffle_ps(medgey, medgey, _MM_SHUFFLE(1, 1, 1, 1));
-				__m128 msteprej = _mm_add_ps(_mm_mul_ps(mx, mstepx), _mm_mul_ps(my, mstepy));
+		}
+	}
+	else
+	{
+		// Evaluate edge functions at top-left corner of block in 64-bit, then step in 32-bit.
+		int32_t evalue[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			int64_t value =
+				  static_cast<int64_t>(edge_x[e]) * left * SAMPLE_POS_SCALE
+				+ static_cast<int64_t>(edge_y[e]) * top  * SAMPLE_POS_SCALE
+				- tri_info->fixed_edge_threshold[e];
+			evalue[e] = static_cast<int32_t>( std::max(-EDGE_VALUE_CLAMP, std::min(value, EDGE_VALUE_CLAMP)) );
+		}
 
-				__m128 mevalue = _mm_shuffle_ps(mevalue3, mevalue3, _MM_SHUFFLE(1, 1, 1, 1));
+#if !defined(EFLIB_NO_SIMD)
+		for (size_t i_sample = 0; i_sample < target_sample_count_; ++ i_sample)
+		{
+			const vec2& sp = samples_pattern_[i_sample];
+			int32_t const spx = static_cast<int32_t>(sp.x() * SAMPLE_POS_SCALE);
+			int32_t const spy = static_cast<int32_t>(sp.y() * SAMPLE_POS_SCALE);
 
-				mask_rej = _mm_or_ps(mask_rej, _mm_cmplt_ps(msteprej, mevalue));
-			}
+			// Edge values of a row of 4 pixels, stepped by rows.
+			__m128i mvalue[3];
+			__m128i mstepy[3];
+			for (int e = 0; e < 3; ++e)
 			{
-				__m128 mstepx = _mm_shuffle_ps(medgex, medgex, _MM_SHUFFLE(2, 2, 2, 2));
-				__m128 mstepy = _mm_shuffle_ps(medgey, medgey, _MM_SHUFFLE(2, 2, 2, 2));
-				__m128 msteprej = _mm_add_ps(_mm_mul_ps(mx, mstepx), _mm_mul_ps(my, mstepy));
+				int32_t const stepx = edge_x[e] * SAMPLE_POS_SCALE;
+				int32_t const value = evalue[e] + edge_x[e] * spx + edge_y[e] * spy;
+				mvalue[e] = _mm_set_epi32(value + stepx * 3, value + stepx * 2, value + stepx, value);
+				mstepy[e] = _mm_set1_epi32(edge_y[e] * SAMPLE_POS_SCALE);
+			}
 
-				__m128 mevalue = _mm_shuffle_ps(mevalue3, mevalue3, _MM_SHUFFLE(2, 2, 2, 2));
+			__m128i sample_bit = _mm_set1_epi32(1UL << i_sample);
+			for(int iy = 0; iy < 4; ++ iy)
+			{
+				__m128i mask_rej = _mm_or_si128(
+					_mm_or_si128( _mm_cmplt_epi32(mvalue[0], zero), _mm_cmplt_epi32(mvalue[1], zero) ),
+					_mm_cmplt_epi32(mvalue[2], zero)
+					);
 
-				mask_rej = _mm_or_ps(mask_rej, _mm_cmplt_ps(msteprej, mevalue));
-			}
+				__m128i sample_mask = _mm_andnot_si128(mask_rej, sample_bit);
 
-			__m128 sample_mask = _mm_castsi128_ps(_mm_set1_epi32(1UL << i_sample));
-			sample_mask = _mm_andnot_ps(mask_rej, sample_mask);
+				__m128i stored_mask = _mm_load_si128( reinterpret_cast<__m128i*>(pixel_mask + iy * 4) );
+				stored_mask = _mm_or_si128(sample_mask, stored_mask);
+				_mm_store_si128(reinterpret_cast<__m128i*>(pixel_mask + iy * 4), stored_mask);
 
-			__m128 stored_mask = _mm_load_ps( reinterpret_cast<float*>(pixel_mask + iy * 4) );
-			stored_mask = _mm_or_ps(sample_mask, stored_mask);
-			_mm_store_ps(reinterpret_cast<float*>(pixel_mask + iy * 4), stored_mask);
+				mvalue[0] = _mm_add_epi32(mvalue[0], mstepy[0]);
+				mvalue[1] = _mm_add_epi32(mvalue[1], mstepy[1]);
+				mvalue[2] = _mm_add_epi32(mvalue[2], mstepy[2]);
+			}
 		}
-	}
 #else
-	float evalue[3];
-	for (int e = 0; e < 3; ++ e)
-	{
-		evalue[e] = edge_factors[e].z() - (left * edge_factors[e].x() + top * edge_factors[e].y());
-	}
-
-	for(int iy = 0; iy < 4; ++iy)
-	{
-		// Rasterizer.
-		for(size_t ix = 0; ix < 4; ++ix)
+		for(int iy = 0; iy < 4; ++iy)
 		{
-			for (int i_sample = 0; i_sample < target_sample_count_; ++ i_sample)
+			// Rasterizer.
+			for(size_t ix = 0; ix < 4; ++ix)
 			{
-				vec2  const& sp = samples_pattern_[i_sample];
-				float const  fx = ix + sp.x();
-				float const  fy = iy + sp.y();
-				bool inside = true;
-				for (int e = 0; e < 3; ++ e)
+				for (int i_sample = 0; i_sample < target_sample_count_; ++ i_sample)
 				{
-					if (fx * edge_factors[e].x() + fy * edge_factors[e].y() < evalue[e])
+					vec2    const& sp = samples_pattern_[i_sample];
+					int32_t const  fx = static_cast<int32_t>( (ix + sp.x()) * SAMPLE_POS_SCALE );
+					int32_t const  fy = static_cast<int32_t>( (iy + sp.y()) * SAMPLE_POS_SCALE );
+					bool inside = true;
+					for (int e = 0; e < 3; ++ e)
 					{
-						inside = false;
-						break;
+						if (evalue[e] + fx * edge_x[e] + fy * edge_y[e] < 0)
+						{
+							inside = false;
+							break;
+						}
+					}
+
+					if (inside)
+					{
+						pixel_mask[iy * 4 + ix] |= 1UL << i_sample;
 					}
 				}
+			}
+		}
+#endif
+	}
 
-				if (inside)
+	// Clamp coverage by scissor if the tile is across edge of scissor.
+	if( scissor_enable_ &&
+		(left < scissor_bounds_[0] || top < scissor_bounds_[1] || left + 4 > scissor_bounds_[2] || top + 4 > scissor_bounds_[3])
+		)
+	{
+		for(int iy = 0; iy < 4; ++iy)
+		{
+			bool const y_inside = (scissor_bounds_[1] <= top + iy) && (top + iy < scissor_bounds_[3]);
+			for(int ix = 0; ix < 4; ++ix)
+			{
+				bool const x_inside = (scissor_bounds_[0] <= left + ix) && (left + ix < scissor_bounds_[2]);
+				if(!(x_inside && y_inside))
 				{
-					pixel_mask[iy * 4 + ix] |= 1UL << i_sample;
+					pixel_mask[iy * 4 + ix] = 0;
 				}
 			}
 		}
 	}
-#endif
+
+	uint64_t quad_masks[4];
+	for(int quad = 0; quad < 4; ++quad)
+	{
+		int const quad_start = ( (quad & 1) << 1 ) | ( (quad & 2) << 2 );
+		quad_masks[quad] = 
+			( (pixel_mask[quad_start+0] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 0) ) |
+			( (pixel_mask[quad_start+1] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 1) ) |
+			( (pixel_mask[quad_start+4] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 2) ) |
+			( (pixel_mask[quad_start+5] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 3) );
+	}
+
+	if(shading_rate_ != shading_rate_1x1)
+	{
+		if(quad_masks[0] | quad_masks[1] | quad_masks[2] | quad_masks[3])
+		{
+			draw_coarse_block(left, top, quad_masks, shaders, triangle_ctx);
+		}
+		return;
+	}
 
     for(int quad = 0; quad < 4; ++quad)
     {
 		int const quad_x = (quad & 1) << 1;
 		int const quad_y = (quad & 2);
 
-		int const quad_start = quad_x | (quad_y << 2);
-
-		uint64_t quad_mask = 
-			( (pixel_mask[quad_start+0] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 0) ) |
-			( (pixel_mask[quad_start+1] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 1) ) |
-			( (pixel_mask[quad_start+4] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 2) ) |
-			( (pixel_mask[quad_start+5] & static_cast<uint64_t>(SAMPLE_MASK)) << (MAX_SAMPLE_COUNT * 3) );
+		uint64_t const quad_mask = quad_masks[quad];
 
 		// No sample need to render.
         if(quad_mask == 0)
@@ -635,13 +693,9 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
     cpp_pixel_shader*	cpp_ps			= ctx->shaders.cpp_ps;
     pixel_shader_unit*	psu				= ctx->shaders.ps_unit;
 	viewport  const&	vp				= *ctx->tile_vp;
-	uint32_t			prim_id			= ctx->prim_id >> 1;
-	uint32_t			full			= ctx->prim_id & 1;
-	vs_output const&	v0				= *clipped_verts_[prim_id*3+0];
-	vs_output const&	v1				= *clipped_verts_[prim_id*3+1];
-	vs_output const&	v2				= *clipped_verts_[prim_id*3+2];
+	uint32_t			full			= ctx->full;
 
-	triangle_info const* tri_info     = tri_infos_.data() + prim_id;
+	triangle_info const* tri_info     = &ctx->prim->tri_info;
 	eflib::vec4 const*	 edge_factors = tri_info->edge_factors;
 	bool const mark_x[3] = 
 	{
@@ -689,13 +743,18 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
 	EFLIB_ALIGN(16) float rej_to_acc[4];
 	EFLIB_ALIGN(16) float evalue[4];
 	float part_evalue[4];
+	// Tolerance is subtracted from 'evalue' and twice of it from 'rej_to_acc', so tiles near edges are neither
+	// rejected nor accepted by rounded values.
+	float tolerance[4];
+	float const coord_max = static_cast<float>( std::max(target_vp_->w, target_vp_->h) );
 	for (int e = 0; e < 3; ++ e)
 	{
+		tolerance[e] = edge_test_tolerance(edge_factors[e], coord_max);
 		step_x[e] = TILE_SIZE * edge_factors[e].x();
 		step_y[e] = TILE_SIZE * edge_factors[e].y();
-		rej_to_acc[e] = -abs(step_x[e]) - abs(step_y[e]);
+		rej_to_acc[e] = -abs(step_x[e]) - abs(step_y[e]) - 2.0f * tolerance[e];
 		part_evalue[e] = mark_x[e] * TILE_SIZE * edge_factors[e].x() + mark_y[e] * TILE_SIZE * edge_factors[e].y();
-		evalue[e] = edge_factors[e].z() - part_evalue[e];
+		evalue[e] = edge_factors[e].z() - part_evalue[e] - tolerance[e];
 	}
 	step_x[3] = step_y[3] = 0;
 
@@ -705,7 +764,7 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
 		for (unsigned long i_sample = 0; i_sample < target_sample_count_; ++ i_sample)
 		{
 			const vec2& sp = samples_pattern_[i_sample];
-			aa_z_offset[i_sample] = (sp.x() - 0.5f) * tri_info->ddx.position().z() + (sp.y() - 0.5f) * tri_info->ddy.position().z();
+			aa_z_offset[i_sample] = (sp.x() - 0.5f) * tri_info->planes.a[0].z() + (sp.y() - 0.5f) * tri_info->planes.b[0].z();
 		}
 	}
     else
@@ -713,8 +772,19 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
         aa_z_offset[0] = 0.0f;
     }
 
+	// Depth plane is used by compressed depth buffer.
+	depth_plane z_plane;
+	z_plane.a = tri_info->planes.a[0].z();
+	z_plane.b = tri_info->planes.b[0].z();
+	z_plane.c = tri_info->planes.c[0].z();
+	for (unsigned long i_sample = 0; i_sample < depth_plane::MAX_SAMPLES; ++ i_sample)
+	{
+		z_plane.aa_offset[i_sample] = (i_sample < target_sample_count_) ? aa_z_offset[i_sample] : 0.0f;
+	}
+
     drawing_triangle_context tri_ctx;
     tri_ctx.aa_z_offset = aa_z_offset;
+	tri_ctx.z_plane		= &z_plane;
     tri_ctx.pixel_stat  = ctx->pixel_stat;
 	tri_ctx.tri_info	= tri_info;
 	if (cpp_ps != nullptr)
@@ -722,6 +792,24 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
 		cpp_ps->update_front_face(tri_info->front_face);
 	}
 
+	if (ctx->prim->small)
+	{
+		// Small triangle: coverage of 4x4 blocks in bounding box are computed directly.
+		int const left		= std::max( fast_floori(tri_info->bounding_box[0]), vpleft0 ) & ~3;
+		int const top		= std::max( fast_floori(tri_info->bounding_box[2]), vptop0  ) & ~3;
+		int const right		= std::min( std::min( fast_floori(tri_info->bounding_box[1]) + 1, vpright0  ), static_cast<int>(target_vp_->w) );
+		int const bottom	= std::min( std::min( fast_floori(tri_info->bounding_box[3]) + 1, vpbottom0 ), static_cast<int>(target_vp_->h) );
+
+		for (int y = top; y < bottom; y += 4)
+		{
+			for (int x = left; x < right; x += 4)
+			{
+				this->draw_partial_tile(x, y, &ctx->shaders, &tri_ctx);
+			}
+		}
+		return;
+	}
+
 	while (test_region_size[src_stage] > 0)
 	{
 		test_region_size[dst_stage] = 0;
@@ -733,9 +821,9 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
 		{
 			step_x[e] *= 0.25f;
 			step_y[e] *= 0.25f;
-			rej_to_acc[e] *= 0.25f;
+			rej_to_acc[e] = -abs(step_x[e]) - abs(step_y[e]) - 2.0f * tolerance[e];
 			part_evalue[e] *= 0.25f;
-			evalue[e] = edge_factors[e].z() - part_evalue[e];
+			evalue[e] = edge_factors[e].z() - part_evalue[e] - tolerance[e];
 		}
 
 		for (size_t ivp = 0; ivp < test_region_size[src_stage]; ++ ivp)
@@ -750,6 +838,23 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
             const int vpright = min(vpleft0 + cur_region.x + cur_region.w * 4, static_cast<uint32_t>(target_vp_->w));
 			const int vpbottom = min(vptop0 + cur_region.y + cur_region.h * 4, static_cast<uint32_t>(target_vp_->h));
 
+			// Region out of scissor is skipped, and region across edge of scissor is tested by pixels.
+			if (scissor_enable_)
+			{
+				if ( vpright <= scissor_bounds_[0] || vpleft >= scissor_bounds_[2]
+					|| vpbottom <= scissor_bounds_[1] || vptop >= scissor_bounds_[3] )
+				{
+					continue;
+				}
+
+				if ( (TVT_FULL == intersect)
+					&& ( vpleft < scissor_bounds_[0] || vpright > scissor_bounds_[2]
+					  || vptop < scissor_bounds_[1] || vpbottom > scissor_bounds_[3] ) )
+				{
+					intersect = TVT_PARTIAL;
+				}
+			}
+
 			// For one pixel region
 			if ((TVT_PARTIAL == intersect) && (cur_region.w <= 1) && (cur_region.h <= 1))
 			{
@@ -769,7 +874,7 @@ void rasterizer::rasterize_triangle(rasterize_prim_context const* ctx)
 
 			case TVT_PIXEL:
 				// The tile is small enough for pixel level matching.
-				this->draw_partial_tile(vpleft0, vptop0, vpleft, vptop, edge_factors, &ctx->shaders, &tri_ctx);
+				this->draw_partial_tile(vpleft, vptop, &ctx->shaders, &tri_ctx);
 				break;
 
 			default:
@@ -797,123 +902,162 @@ rasterizer::~rasterizer()
 {
 }
 
-void rasterizer::threaded_dispatch_primitive(thread_context const* thread_ctx)
+void rasterizer::dispatch_primitives(geom_setup_package const* package)
 {
-	vector<vector<uint32_t>>& tiled_prims = threaded_tiled_prims_[thread_ctx->thread_id];
-	for(auto& prims: tiled_prims)
-	{
-		prims.clear();
-	}
+	vector<vector<binned_prim>>&	tiled_prims = threaded_tiled_prims_[package->thread_id];
+	setup_prim_pool&				prims		= threaded_setup_prims_[package->thread_id];
 
-	thread_context::package_cursor current_package = thread_ctx->next_package();
-	while ( current_package.valid() )
+	for (uint32_t i = 0; i < package->prim_count; ++ i)
 	{
-		auto prim_range = current_package.item_range();
+		uint32_t const	seq		= package->seqs[i];
+		setup_prim*		prim	= prims.alloc();
+		for (uint32_t i_vert = 0; i_vert < prim_size_; ++ i_vert)
+		{
+			prim->verts[i_vert] = package->verts[i * prim_size_ + i_vert];
+		}
 
-		for (int32_t i = prim_range.first; i < prim_range.second; ++ i)
+		if (3 == prim_size_)
 		{
-			if (3 == prim_size_)
-			{
-				compute_triangle_info(i);
-			}
+			compute_triangle_info(prim);
+		}
+		else
+		{
+			compute_line_info(prim);
+		}
 
-			triangle_info const* tri_info = tri_infos_.data() + i;
-			
-			if (tri_info->v0 == nullptr)
-			{
-				continue;
-			}
-			float const x_min = tri_info->bounding_box[0];
-			float const x_max = tri_info->bounding_box[1];
-			float const y_min = tri_info->bounding_box[2];
-			float const y_max = tri_info->bounding_box[3];
+		triangle_info const* tri_info = &prim->tri_info;
+		
+		if (tri_info->v0 == nullptr)
+		{
+			continue;
+		}
+		float const x_min = tri_info->bounding_box[0];
+		float const x_max = tri_info->bounding_box[1];
+		float const y_min = tri_info->bounding_box[2];
+		float const y_max = tri_info->bounding_box[3];
 
-			const int sx = std::min(fast_floori(std::max(0.0f, x_min) / TILE_SIZE),		static_cast<int>(tile_x_count_));
-			const int sy = std::min(fast_floori(std::max(0.0f, y_min) / TILE_SIZE),		static_cast<int>(tile_y_count_));
-			const int ex = std::min(fast_ceili (std::max(0.0f, x_max) / TILE_SIZE) + 1,	static_cast<int>(tile_x_count_));
-			const int ey = std::min(fast_ceili (std::max(0.0f, y_max) / TILE_SIZE) + 1,	static_cast<int>(tile_y_count_));
+		prim->small = (3 == prim_size_) && (x_max - x_min <= SMALL_TRIANGLE_SIZE) && (y_max - y_min <= SMALL_TRIANGLE_SIZE);
+		if (prim->small)
+		{
+			// Small triangle covers 2x2 tiles at most. It is binned by bounding box without edge tests.
+			const int ssx = std::max(fast_floori(std::max(0.0f, x_min)) / TILE_SIZE,		scissor_tiles_[0]);
+			const int ssy = std::max(fast_floori(std::max(0.0f, y_min)) / TILE_SIZE,		scissor_tiles_[1]);
+			const int sex = std::min(fast_floori(std::max(0.0f, x_max)) / TILE_SIZE + 1,	scissor_tiles_[2]);
+			const int sey = std::min(fast_floori(std::max(0.0f, y_max)) / TILE_SIZE + 1,	scissor_tiles_[3]);
 
-			if ((sx + 1 == ex) && (sy + 1 == ey))
+			for (int y = ssy; y < sey; ++ y)
 			{
-				// Small primitive
-				tiled_prims[sy * tile_x_count_ + sx].push_back(i << 1);
+				for (int x = ssx; x < sex; ++ x)
+				{
+					tiled_prims[y * tile_x_count_ + x].push_back( binned_prim(seq, 0, prim) );
+				}
 			}
-			else
+			continue;
+		}
+
+		// Tiles out of scissor are never binned.
+		const int sx = std::max(fast_floori(std::max(0.0f, x_min) / TILE_SIZE),		scissor_tiles_[0]);
+		const int sy = std::max(fast_floori(std::max(0.0f, y_min) / TILE_SIZE),		scissor_tiles_[1]);
+		const int ex = std::min(fast_ceili (std::max(0.0f, x_max) / TILE_SIZE) + 1,	scissor_tiles_[2]);
+		const int ey = std::min(fast_ceili (std::max(0.0f, y_max) / TILE_SIZE) + 1,	scissor_tiles_[3]);
+
+		if (sx >= ex || sy >= ey)
+		{
+			continue;
+		}
+
+		if ((sx + 1 == ex) && (sy + 1 == ey))
+		{
+			// Small primitive
+			tiled_prims[sy * tile_x_count_ + sx].push_back( binned_prim(seq, 0, prim) );
+		}
+		else
+		{
+			if (3 == prim_size_)
 			{
-				if (3 == prim_size_)
+				vec4 const* edge_factors = tri_info->edge_factors;
+
+				bool const mark_x[3] =
 				{
-					vec4 const* edge_factors = tri_infos_[i].edge_factors;
+					edge_factors[0].x() > 0, edge_factors[1].x() > 0, edge_factors[2].x() > 0
+				};
 
-					bool const mark_x[3] =
-					{
-						edge_factors[0].x() > 0, edge_factors[1].x() > 0, edge_factors[2].x() > 0
-					};
+				bool const mark_y[3] =
+				{
+					edge_factors[0].y() > 0, edge_factors[1].y() > 0, edge_factors[2].y() > 0
+				};
+
+				float step_x[3];
+				float step_y[3];
+				float rej_to_acc[3];
+				float tolerance[3];
+				float const coord_max = static_cast<float>( std::max(target_vp_->w, target_vp_->h) );
+				for (int e = 0; e < 3; ++ e)
+				{
+					step_x[e] = TILE_SIZE * edge_factors[e].x();
+					step_y[e] = TILE_SIZE * edge_factors[e].y();
+					rej_to_acc[e] = -abs(step_x[e]) - abs(step_y[e]);
+					tolerance[e] = edge_test_tolerance(edge_factors[e], coord_max);
+				}
 
-					bool const mark_y[3] =
+				for (int y = sy; y < ey; ++ y)
+				{
+					for (int x = sx; x < ex; ++ x)
 					{
-						edge_factors[0].y() > 0, edge_factors[1].y() > 0, edge_factors[2].y() > 0
-					};
+						int rejection = 0;
+						int acception = 1;
 
-					float step_x[3];
-					float step_y[3];
-					float rej_to_acc[3];
-					for (int e = 0; e < 3; ++ e)
-					{
-						step_x[e] = TILE_SIZE * edge_factors[e].x();
-						step_y[e] = TILE_SIZE * edge_factors[e].y();
-						rej_to_acc[e] = -abs(step_x[e]) - abs(step_y[e]);
-					}
+						// Trival rejection & acception
+						for (int e = 0; e < 3; ++ e)
+						{
+							float evalue = edge_factors[e].z() - ((x + mark_x[e]) * TILE_SIZE * edge_factors[e].x() + (y + mark_y[e]) * TILE_SIZE * edge_factors[e].y());
+							rejection |= (tolerance[e] < evalue);
+							acception &= (rej_to_acc[e] >= evalue + tolerance[e]);
+						}
 
-					for (int y = sy; y < ey; ++ y)
-					{
-						for (int x = sx; x < ex; ++ x)
+						if (!rejection)
 						{
-							int rejection = 0;
-							int acception = 1;
-
-							// Trival rejection & acception
-							for (int e = 0; e < 3; ++ e)
-							{
-								float evalue = edge_factors[e].z() - ((x + mark_x[e]) * TILE_SIZE * edge_factors[e].x() + (y + mark_y[e]) * TILE_SIZE * edge_factors[e].y());
-								rejection |= (0 < evalue);
-								acception &= (rej_to_acc[e] >= evalue);
-							}
-
-							if (!rejection)
-							{
-								tiled_prims[y * tile_x_count_ + x].push_back((i << 1) | acception);
-							}
+							tiled_prims[y * tile_x_count_ + x].push_back( binned_prim(seq, acception, prim) );
 						}
 					}
 				}
-				else
+			}
+			else
+			{
+				// Tile is rejected if all corners are on same side of line and farther than half pixel on minor direction.
+				vec4 const& line_eq		= tri_info->edge_factors[0];
+				float const half_width	= 0.5f * std::max( abs(line_eq.x()), abs(line_eq.y()) );
+
+				for (int y = sy; y < ey; ++ y)
 				{
-					for (int y = sy; y < ey; ++ y)
+					float const ey0 = line_eq.y() * (y * TILE_SIZE) + line_eq.z();
+					float const ey1 = ey0 + line_eq.y() * TILE_SIZE;
+					for (int x = sx; x < ex; ++ x)
 					{
-						for (int x = sx; x < ex; ++ x)
+						float const ex0 = line_eq.x() * (x * TILE_SIZE);
+						float const ex1 = ex0 + line_eq.x() * TILE_SIZE;
+
+						float const emin = std::min( std::min(ex0 + ey0, ex1 + ey0), std::min(ex0 + ey1, ex1 + ey1) );
+						float const emax = std::max( std::max(ex0 + ey0, ex1 + ey0), std::max(ex0 + ey1, ex1 + ey1) );
+						if (emin > half_width || emax < -half_width)
 						{
-							tiled_prims[y * tile_x_count_ + x].push_back(i << 1);
+							continue;
 						}
+
+						tiled_prims[y * tile_x_count_ + x].push_back( binned_prim(seq, 0, prim) );
 					}
 				}
 			}
 		}
-
-		current_package = thread_ctx->next_package();
 	}
 }
 
-void rasterizer::compute_triangle_info(uint32_t i)
+void rasterizer::compute_triangle_info(setup_prim* prim)
 {
-	triangle_info* tri_info = tri_infos_.data() + i;
+	triangle_info* tri_info = &prim->tri_info;
 	tri_info->v0 = nullptr;
 
-	vs_output const* verts[3] =
-	{
-		clipped_verts_[i*prim_size_+0],
-		clipped_verts_[i*prim_size_+1],
-		clipped_verts_[i*prim_size_+2],
-	};
+	vs_output const* const* verts = prim->verts;
 
 	vec4 const* vert_pos[3] =
 	{
@@ -979,27 +1123,176 @@ void rasterizer::compute_triangle_info(uint32_t i)
 	tri_info->bounding_box[2] = std::min( std::min( vert_pos[0]->y(), vert_pos[1]->y() ), vert_pos[2]->y() );	// ymin
 	tri_info->bounding_box[3] = std::max( std::max( vert_pos[0]->y(), vert_pos[1]->y() ), vert_pos[2]->y() );	// ymax
 
+	// Vertexes far out of viewport cannot be snapped without overflow of integer edge values.
+	// Triangle is tested by float edge factors only, and fill rule is not applied to it.
+	bool fixed_edges = true;
 	for (int i_vert = 0; i_vert < 3; ++ i_vert)
 	{
-		// Edge factors: x * (y1 - y0) - y * (x1 - x0) - (y1 * x0 - x1 * y0)
-		int const se = i_vert;
-		int const ee = (i_vert + 1) % 3;
-
-		vec4* edge_factors = tri_info->edge_factors;
-		edge_factors[i_vert].x(vert_pos[se]->y() - vert_pos[ee]->y()										);
-		edge_factors[i_vert].y(vert_pos[ee]->x() - vert_pos[se]->x()										);
-		edge_factors[i_vert].z(vert_pos[ee]->x() * vert_pos[se]->y() - vert_pos[ee]->y() * vert_pos[se]->x());
-		edge_factors[i_vert].w(0.0f);
+		if( !( fabs( vert_pos[i_vert]->x() ) <= FIXED_POINT_RANGE && fabs( vert_pos[i_vert]->y() ) <= FIXED_POINT_RANGE ) )
+		{
+			fixed_edges = false;
+		}
 	}
+	tri_info->fixed_edges = fixed_edges;
 
-	// Compute difference of attributes.
+	if( !fixed_edges )
 	{
-		vso_ops_->compute_derivative(tri_info->ddx, tri_info->ddy, e01, e02, inv_area);
+		double x[3], y[3];
+		for (int i_vert = 0; i_vert < 3; ++ i_vert)
+		{
+			x[i_vert] = vert_pos[i_vert]->x();
+			y[i_vert] = vert_pos[i_vert]->y();
+		}
+		double const orient = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) > 0.0 ? 1.0 : -1.0;
+
+		for (int i_vert = 0; i_vert < 3; ++ i_vert)
+		{
+			int const se = i_vert;
+			int const ee = (i_vert + 1) % 3;
+
+			vec4* edge_factors = tri_info->edge_factors;
+			edge_factors[i_vert].x( static_cast<float>( (y[se] - y[ee]) * orient ) );
+			edge_factors[i_vert].y( static_cast<float>( (x[ee] - x[se]) * orient ) );
+			edge_factors[i_vert].z( static_cast<float>( (x[ee] * y[se] - y[ee] * x[se]) * orient ) );
+			edge_factors[i_vert].w(0.0f);
+		}
 	}
+	else
+	{
+		// Snap vertexes to 16.8 fixed point.
+		// Edges shared by adjacent triangles get exactly same integer edge functions,
+		// so every sample on them is owned by only one triangle.
+		int32_t fixed_x[3], fixed_y[3];
+		for (int i_vert = 0; i_vert < 3; ++ i_vert)
+		{
+			fixed_x[i_vert] = static_cast<int32_t>( floor(static_cast<double>(vert_pos[i_vert]->x()) * SUBPIXEL_SCALE + 0.5) );
+			fixed_y[i_vert] = static_cast<int32_t>( floor(static_cast<double>(vert_pos[i_vert]->y()) * SUBPIXEL_SCALE + 0.5) );
+		}
+
+		// Orient edges to make inside of triangle positive whatever the winding is.
+		int64_t const fixed_area =
+			  static_cast<int64_t>(fixed_x[1] - fixed_x[0]) * (fixed_y[2] - fixed_y[0])
+			- static_cast<int64_t>(fixed_y[1] - fixed_y[0]) * (fixed_x[2] - fixed_x[0]);
+		// Triangle is degenerated after snapping.
+		if( fixed_area == 0 ) return;
+		int32_t const orient = fixed_area > 0 ? 1 : -1;
+
+		for (int i_vert = 0; i_vert < 3; ++ i_vert)
+		{
+			// Edge factors: x * (y1 - y0) - y * (x1 - x0) - (y1 * x0 - x1 * y0)
+			int const se = i_vert;
+			int const ee = (i_vert + 1) % 3;
+
+			int32_t const a = (fixed_y[se] - fixed_y[ee]) * orient;
+			int32_t const b = (fixed_x[ee] - fixed_x[se]) * orient;
+			int64_t const c = ( static_cast<int64_t>(fixed_x[ee]) * fixed_y[se] - static_cast<int64_t>(fixed_y[ee]) * fixed_x[se] ) * orient;
+
+			// Samples are in 1/16 pixel, so 'a * x + b * y' is in 2^-12 and 'c' is in 2^-16.
+			// Samples on top or left edges are inside, others are outside.
+			int const shift = SUBPIXEL_BITS - SAMPLE_POS_BITS;
+			bool const top_left = a > 0 || (a == 0 && b > 0);
+			tri_info->fixed_edge_x[i_vert] = a;
+			tri_info->fixed_edge_y[i_vert] = b;
+			tri_info->fixed_edge_threshold[i_vert] = top_left
+				? ( c + (1 << shift) - 1 ) >> shift
+				: ( c >> shift ) + 1;
+
+			// Float edge factors are used by tile tests, they are computed from snapped positions too.
+			vec4* edge_factors = tri_info->edge_factors;
+			edge_factors[i_vert].x( static_cast<float>(a) / SUBPIXEL_SCALE );
+			edge_factors[i_vert].y( static_cast<float>(b) / SUBPIXEL_SCALE );
+			edge_factors[i_vert].z( static_cast<float>( static_cast<double>(c) / (SUBPIXEL_SCALE * SUBPIXEL_SCALE) ) );
+			edge_factors[i_vert].w(0.0f);
+		}
+	}
+	tri_info->fixed_edge_x[3] = 0;
+	tri_info->fixed_edge_y[3] = 0;
+
+	// Compute plane equations of position and attributes.
+	vso_ops_->compute_planes(tri_info->planes, *reordered_verts[0], e01, e02, inv_area);
 
 	tri_info->v0 = reordered_verts[0];
 }
 
+void rasterizer::compute_line_info(setup_prim* prim)
+{
+	triangle_info* line_info = &prim->tri_info;
+	line_info->v0 = nullptr;
+
+	vs_output const& v0 = *prim->verts[0];
+	vs_output const& v1 = *prim->verts[1];
+
+	vec4 const& pos0 = v0.position();
+	vec4 const& pos1 = v1.position();
+
+	float const dx = pos1.x() - pos0.x();
+	float const dy = pos1.y() - pos0.y();
+
+	// Return for zero-length line.
+	if( equal<float>(dx, 0.0f) && equal<float>(dy, 0.0f) ) return;
+
+	line_info->front_face = true;
+
+	// Pixels within half pixel to line are candidates.
+	line_info->bounding_box[0] = std::min( pos0.x(), pos1.x() ) - 0.5f;	// xmin
+	line_info->bounding_box[1] = std::max( pos0.x(), pos1.x() ) + 0.5f;	// xmax
+	line_info->bounding_box[2] = std::min( pos0.y(), pos1.y() ) - 0.5f;	// ymin
+	line_info->bounding_box[3] = std::max( pos0.y(), pos1.y() ) + 0.5f;	// ymax
+
+	// Line equation: a * x + b * y + c
+	line_info->edge_factors[0] = vec4(-dy, dx, dy * pos0.x() - dx * pos0.y(), 0.0f);
+
+	// Planes of line are same as a triangle whose second edge is perpendicular to line
+	// and has no change of attributes along it.
+	vs_output e01, e0n;
+	vso_ops_->sub(e01, v1, v0);
+	vso_ops_->mul(e0n, e01, 0.0f);
+	e0n.position() = vec4(-dy, dx, 0.0f, 0.0f);
+
+	float const area = cross_prod2( e0n.position().xy(), e01.position().xy() );
+	vso_ops_->compute_planes(line_info->planes, v0, e01, e0n, 1.0f / area);
+
+	line_info->v0 = &v0;
+}
+
+void rasterizer::generate_wireframe_edges()
+{
+	size_t const num_edges = prim_count_ * 3;
+
+	vector<uint32_t> indexes(num_edges);
+	if(num_edges > 0)
+	{
+		uint32_t min_index, max_index;
+		index_fetcher_.fetch_indexes(&indexes[0], &min_index, &max_index, 0, prim_count_);
+	}
+
+	// Sort edges by their verts, so triangles share an edge are adjacent.
+	// First triangle of each edge owns it, and the others record the owner.
+	wireframe_edges_.resize(num_edges);
+	for (uint32_t i_tri = 0; i_tri < prim_count_; ++i_tri)
+	{
+		for (uint32_t i_edge = 0; i_edge < 3; ++i_edge)
+		{
+			uint32_t const id0 = indexes[i_tri * 3 + i_edge];
+			uint32_t const id1 = indexes[i_tri * 3 + (i_edge + 1) % 3];
+			uint64_t const key = ( static_cast<uint64_t>( std::min(id0, id1) ) << 32 ) | std::max(id0, id1);
+			wireframe_edges_[i_tri * 3 + i_edge] = make_pair(key, i_tri * 3 + i_edge);
+		}
+	}
+	std::sort( wireframe_edges_.begin(), wireframe_edges_.end() );
+
+	wireframe_edge_owners_.assign(num_edges, SELF_OWNED_EDGE);
+	for (size_t i = 1, owner = 0; i < num_edges; ++i)
+	{
+		if (wireframe_edges_[i].first != wireframe_edges_[owner].first)
+		{
+			owner = i;
+			continue;
+		}
+		wireframe_edge_owners_[wireframe_edges_[i].second] = wireframe_edges_[owner].second / 3;
+	}
+}
+
 void rasterizer::threaded_rasterize_multi_prim(thread_context const* thread_ctx)
 {
 	viewport tile_vp;
@@ -1008,7 +1301,7 @@ void rasterizer::threaded_rasterize_multi_prim(thread_context const* thread_ctx)
 	tile_vp.minz = vp_->minz;
 	tile_vp.maxz = vp_->maxz;
 
-	std::vector<uint32_t> prims;
+	std::vector<binned_prim> prims;
     pixel_statistic pixel_stat;
     pixel_stat.ps_invocations = 0;
     pixel_stat.backend_input_pixels = 0;
@@ -1017,6 +1310,7 @@ void rasterizer::threaded_rasterize_multi_prim(thread_context const* thread_ctx)
     rast_ctxt.shaders.cpp_ps	= threaded_cpp_ps_[thread_ctx->thread_id];
     rast_ctxt.shaders.ps_unit	= threaded_psu_[thread_ctx->thread_id];
     rast_ctxt.shaders.cpp_bs    = cpp_bs_;
+	rast_ctxt.shaders.frame_buffer	= tile_buffer_enable_ ? threaded_tile_fbs_[thread_ctx->thread_id].get() : frame_buffer_;
 	rast_ctxt.tile_vp		    = &tile_vp;
 	rast_ctxt.sorted_prims	    = &prims;
     rast_ctxt.pixel_stat        = &pixel_stat;
@@ -1042,7 +1336,42 @@ void rasterizer::threaded_rasterize_multi_prim(thread_context const* thread_ctx)
 
 			rast_ctxt.sorted_prims = &prims;
 
-			rasterize_prims_(this, &rast_ctxt);
+			if( prims.empty() )
+			{
+				rasterize_prims_(this, &rast_ctxt);
+			}
+			else if(tile_buffer_enable_)
+			{
+				// Tile is loaded once, rendered by all primitives of this draw and stored once.
+				// Only union of bounding boxes of the primitives is loaded and stored. It is extended by
+				// one pixel for lines which are half pixel wide, and aligned to 4x4 blocks.
+				float const tile_left	= tile_vp.x;
+				float const tile_top	= tile_vp.y;
+				float x_min = tile_left + TILE_SIZE, x_max = tile_left;
+				float y_min = tile_top  + TILE_SIZE, y_max = tile_top;
+				for (size_t i_prim = 0; i_prim < prims.size(); ++ i_prim)
+				{
+					vec4 const& bounding_box = prims[i_prim].prim->tri_info.bounding_box;
+					x_min = std::min(x_min, bounding_box[0]);
+					x_max = std::max(x_max, bounding_box[1]);
+					y_min = std::min(y_min, bounding_box[2]);
+					y_max = std::max(y_max, bounding_box[3]);
+				}
+
+				int const left		= std::max( fast_floori( std::max(x_min, tile_left) ) - 1, x * TILE_SIZE ) & ~3;
+				int const top		= std::max( fast_floori( std::max(y_min, tile_top ) ) - 1, y * TILE_SIZE ) & ~3;
+				int const right		= std::min( fast_floori( std::min(x_max, tile_left + TILE_SIZE) ) + 2, (x + 1) * TILE_SIZE );
+				int const bottom	= std::min( fast_floori( std::min(y_max, tile_top  + TILE_SIZE) ) + 2, (y + 1) * TILE_SIZE );
+
+				rast_ctxt.shaders.frame_buffer->begin_tile(left, top, right - left, bottom - top);
+				rasterize_prims_(this, &rast_ctxt);
+				rast_ctxt.shaders.frame_buffer->end_tile();
+			}
+			else
+			{
+				frame_buffer_->prepare_tile(x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+				rasterize_prims_(this, &rast_ctxt);
+			}
 
 			current_package = thread_ctx->next_package();
 		}
@@ -1057,10 +1386,12 @@ void rasterizer::rasterize_multi_line(rasterize_multi_prim_context const* ctx)
 	rasterize_prim_context prim_ctxt;
     prim_ctxt.shaders	= ctx->shaders;
 	prim_ctxt.tile_vp	= ctx->tile_vp;
+    prim_ctxt.pixel_stat= ctx->pixel_stat;
 
-	for (uint32_t prim_with_mask: *ctx->sorted_prims)
+	for (binned_prim const& prim: *ctx->sorted_prims)
 	{
-		prim_ctxt.prim_id = prim_with_mask >> 1;
+		prim_ctxt.prim = prim.prim;
+		prim_ctxt.full = prim.full;
 		rasterize_line(&prim_ctxt);
 	}
 }
@@ -1072,9 +1403,10 @@ void rasterizer::rasterize_multi_triangle(rasterize_multi_prim_context const* ct
 	prim_ctxt.tile_vp	= ctx->tile_vp;
     prim_ctxt.pixel_stat= ctx->pixel_stat;
 
-	for (uint32_t prim_with_mask: *ctx->sorted_prims)
+	for (binned_prim const& prim: *ctx->sorted_prims)
 	{
-		prim_ctxt.prim_id = prim_with_mask;
+		prim_ctxt.prim = prim.prim;
+		prim_ctxt.full = prim.full;
 		rasterize_triangle(&prim_ctxt);
 	}
 }
@@ -1089,6 +1421,7 @@ void rasterizer::update_prim_info(render_state const* state)
 	bool is_solid = false;
 
     prim_count_ = state->prim_count;
+	instance_count_ = state->instance_count;
 
 	switch (state_->get_desc().fm)
 	{
@@ -1108,7 +1441,7 @@ void rasterizer::update_prim_info(render_state const* state)
 		break;
 	case primitive_line_list:
 	case primitive_line_strip:
-		is_line = false;
+		is_line = true;
 		break;
 	case primitive_triangle_list:
 	case primitive_triangle_fan:
@@ -1125,6 +1458,10 @@ void rasterizer::update_prim_info(render_state const* state)
 	{
 		prim_ = pt_wireframe_tri;
 	}
+	else if (is_line)
+	{
+		prim_ = pt_line;
+	}
 	else
 	{
 		prim_ = pt_none;
@@ -1201,10 +1538,36 @@ void rasterizer::prepare_draw()
 		break;
 	}
 
+	// Custom positions are snapped to precision of fixed-point edge functions,
+	// so that depth offsets of samples are consistent with coverage.
+	if (custom_samples_pattern_ != nullptr)
+	{
+		for (size_t i_sample = 0; i_sample < target_sample_count_; ++i_sample)
+		{
+			vec2 const& sp = custom_samples_pattern_[i_sample];
+			samples_pattern_[i_sample] = vec2(
+				static_cast<int32_t>(sp.x() * SAMPLE_POS_SCALE) / static_cast<float>(SAMPLE_POS_SCALE),
+				static_cast<int32_t>(sp.y() * SAMPLE_POS_SCALE) / static_cast<float>(SAMPLE_POS_SCALE)
+				);
+		}
+	}
+
 	// Compute tile count
 	tile_x_count_	= static_cast<size_t>(vp_->w + TILE_SIZE - 1) / TILE_SIZE;
 	tile_y_count_	= static_cast<size_t>(vp_->h + TILE_SIZE - 1) / TILE_SIZE;
 	tile_count_		= tile_x_count_ * tile_y_count_;
+
+	scissor_tiles_[0] = 0;
+	scissor_tiles_[1] = 0;
+	scissor_tiles_[2] = static_cast<int>(tile_x_count_);
+	scissor_tiles_[3] = static_cast<int>(tile_y_count_);
+	if (scissor_enable_)
+	{
+		scissor_tiles_[0] = std::max(scissor_tiles_[0], std::max(scissor_bounds_[0], 0) / TILE_SIZE);
+		scissor_tiles_[1] = std::max(scissor_tiles_[1], std::max(scissor_bounds_[1], 0) / TILE_SIZE);
+		scissor_tiles_[2] = std::min(scissor_tiles_[2], (std::max(scissor_bounds_[2], 0) + TILE_SIZE - 1) / TILE_SIZE);
+		scissor_tiles_[3] = std::min(scissor_tiles_[3], (std::max(scissor_bounds_[3], 0) + TILE_SIZE - 1) / TILE_SIZE);
+	}
 }
 
 void rasterizer::draw()
@@ -1214,49 +1577,47 @@ void rasterizer::draw()
 
 	size_t num_threads	= num_available_threads();
 
+	// Reset bins and primitives of all threads.
+	threaded_tiled_prims_.resize(num_threads);
+	threaded_setup_prims_.resize(num_threads);
+	for (size_t i = 0; i < num_threads; ++ i)
+	{
+		threaded_tiled_prims_[i].resize(tile_count_);
+		for (auto& prims: threaded_tiled_prims_[i])
+		{
+			prims.clear();
+		}
+		threaded_setup_prims_[i].clear();
+	}
+
+	// Clip, project and dispatch primitives into tiles' bucket in one pass.
 	geom_setup_context	geom_setup_ctx;
 
 	geom_setup_ctx.cull			    = state_->get_cull_func();
+	geom_setup_ctx.culling			= state_->get_desc().cm != cull_none;
+	geom_setup_ctx.edge_owners		= nullptr;
 	geom_setup_ctx.dvc			    = vert_cache_;
+	geom_setup_ctx.vp				= vp_;
 	geom_setup_ctx.prim			    = prim_;
-	geom_setup_ctx.prim_count	    = prim_count_;
+	geom_setup_ctx.prim_count	    = prim_count_ * instance_count_;
+	geom_setup_ctx.prims_per_instance = prim_count_;
 	geom_setup_ctx.prim_size	    = prim_size_;
 	geom_setup_ctx.vso_ops		    = vso_ops_;
+	geom_setup_ctx.dispatch			= [this](geom_setup_package const* package) { this->dispatch_primitives(package); };
     geom_setup_ctx.pipeline_stat    = pipeline_stat_;
     geom_setup_ctx.acc_cinvocations = acc_cinvocations_;
+    geom_setup_ctx.acc_cprimitives	= acc_cprimitives_;
 
 	uint64_t clipping_start_time = fetch_time_stamp_();
-	gse_.execute(&geom_setup_ctx, fetch_time_stamp_);
-	acc_clipping_(pipeline_prof_, gse_.compact_start_time() - clipping_start_time);
-	acc_compact_clip_(pipeline_prof_, fetch_time_stamp_() - gse_.compact_start_time());
-
-	clipped_verts_			= gse_.verts();
-	clipped_verts_count_	= gse_.verts_count();
-	clipped_prims_count_	= clipped_verts_count_ / prim_size_;
-
-    acc_ia_primitives_(pipeline_stat_, prim_count_);
-    acc_cprimitives_(pipeline_stat_, clipped_prims_count_);
-
-	// Project and Transformed to Viewport
-	uint64_t vp_trans_start_time = fetch_time_stamp_();
-	viewport_and_project_transform(clipped_verts_, clipped_verts_count_);
-	acc_vp_trans_(pipeline_prof_, fetch_time_stamp_() - vp_trans_start_time);
-
-	uint64_t tri_dispatch_start_time = fetch_time_stamp_();
-	// Dispatch primitives into tiles' bucket
-	threaded_tiled_prims_.resize(num_threads);
-	tri_infos_.resize(clipped_prims_count_);
-	for (size_t i = 0; i < num_threads; ++ i)
+	if (pt_wireframe_tri == prim_)
 	{
-		threaded_tiled_prims_[i].resize(tile_count_);
+		generate_wireframe_edges();
+		geom_setup_ctx.edge_owners = wireframe_edge_owners_.empty() ? nullptr : &wireframe_edge_owners_[0];
 	}
+	gse_.execute(&geom_setup_ctx);
+	acc_clipping_(pipeline_prof_, fetch_time_stamp_() - clipping_start_time);
 
-	// Execute dispatching primitive
-	execute_threads(
-		[this](thread_context const* thread_ctx) { this->threaded_dispatch_primitive(thread_ctx); },
-		clipped_prims_count_, DISPATCH_PRIMITIVE_PACKAGE_SIZE, num_threads
-		);
-	acc_tri_dispatch_(pipeline_prof_, fetch_time_stamp_() - tri_dispatch_start_time);
+    acc_ia_primitives_(pipeline_stat_, static_cast<uint64_t>(prim_count_) * instance_count_);
 
 	// Rasterize tiles
 	switch(prim_)
@@ -1293,6 +1654,19 @@ void rasterizer::draw()
 		}
 	}
 
+	if(tile_buffer_enable_)
+	{
+		threaded_tile_fbs_.resize(num_threads);
+		for (size_t i = 0; i < num_threads; ++ i)
+		{
+			if(!threaded_tile_fbs_[i])
+			{
+				threaded_tile_fbs_[i] = boost::make_shared<framebuffer>();
+			}
+			threaded_tile_fbs_[i]->bind_tile_targets(*frame_buffer_);
+		}
+	}
+
 	uint64_t ras_start_time = fetch_time_stamp_();
 	execute_threads(
 		[this](thread_context const* thread_ctx){ this->threaded_rasterize_multi_prim(thread_ctx); },
@@ -1307,54 +1681,6 @@ void rasterizer::draw()
 	}
 }
 
-void threaded_viewport_and_project_transform(
-	vs_output_functions::project proj_fn,
-	vs_output** verts,
-	viewport const* vp,
-	thread_context const* thread_ctx)
-{
-	thread_context::package_cursor current_package = thread_ctx->next_package();
-	while ( current_package.valid() )
-	{
-		auto prim_range = current_package.item_range();
-
-		for (int32_t i = prim_range.first; i < prim_range.second; ++ i)
-		{
-			vs_output* vso = verts[i];
-			viewport_transform(vso->position(), *vp);
-			proj_fn(*vso, *vso);
-		}
-		current_package = thread_ctx->next_package();
-	}
-}
-
-void rasterizer::viewport_and_project_transform(vs_output** vertexes, size_t num_verts)
-{
-	vs_output_functions::project proj_fn = vso_ops_->project;
-
-	// Gathering vs_output need to be processed.
-	vector<vs_output*> sorted;
-	sorted.insert( sorted.end(), vertexes, vertexes+num_verts );
-
-#if defined(EFLIB_MSVC)
-	concurrency::parallel_sort( sorted.data(), sorted.data() + sorted.size() );
-#else
-	std::sort( sorted.begin(), sorted.end() );
-#endif
-
-	sorted.erase( std::unique(sorted.begin(), sorted.end()), sorted.end() );
-
-	vs_output** trans_proj_verts = sorted.data();
-
-	execute_threads(
-		[this, trans_proj_verts](thread_context const* thread_ctx)
-		{
-			threaded_viewport_and_project_transform(this->vso_ops_->project, trans_proj_verts, this->vp_, thread_ctx);
-		},
-		static_cast<int>( sorted.size() ), VP_PROJ_TRANSFORM_PAKCAGE_SIZE
-	);
-}
-
 void rasterizer::draw_full_quad(
 	uint32_t left, uint32_t top,
 	drawing_shader_context const* shaders,
@@ -1364,14 +1690,11 @@ void rasterizer::draw_full_quad(
 #if 1
 	EFLIB_ALIGN(16) vs_output pixels[4];
 
-	float const dx = 0.5f + left - triangle_ctx->tri_info->v0->position().x();
-	float const dy = 0.5f + top  - triangle_ctx->tri_info->v0->position().y();
+	interpolation_planes const& planes = triangle_ctx->tri_info->planes;
+	float const x = 0.5f + left;
+	float const y = 0.5f + top;
 
-	vso_ops_->step_2d_unproj_pos_quad(
-		pixels, *triangle_ctx->tri_info->v0, 
-		dx, triangle_ctx->tri_info->ddx,
-		dy, triangle_ctx->tri_info->ddy
-		);
+	vso_ops_->interpolate_pos_quad(pixels, planes, x, y);
 
 	uint64_t  quad_mask = quad_full_mask_;
 	ps_output pso[4];
@@ -1383,23 +1706,25 @@ void rasterizer::draw_full_quad(
 		pixels[3].position().z()
 	};
 
-	if ( frame_buffer_->early_z_enabled() )
+	if ( shaders->frame_buffer->early_z_enabled() )
 	{
-		quad_mask = frame_buffer_->early_z_test_quad(left, top, depth, triangle_ctx->aa_z_offset);
+		quad_mask = shaders->frame_buffer->early_z_test_quad(left, top, depth, triangle_ctx->aa_z_offset, triangle_ctx->z_plane);
 	}
 
 	if (quad_mask == 0)
 	{
 		return;
 	}
+
+	if (sample_shading_)
+	{
+		draw_quad_samples(left, top, quad_mask, depth, shaders, triangle_ctx);
+		return;
+	}
 	
 	triangle_ctx->pixel_stat->ps_invocations += 4;
 
-	vso_ops_->step_2d_unproj_attr_quad(
-		pixels, *triangle_ctx->tri_info->v0, 
-		dx, triangle_ctx->tri_info->ddx,
-		dy, triangle_ctx->tri_info->ddy
-		);
+	vso_ops_->interpolate_attr_quad(pixels, planes, x, y);
 	          
 #if 0
 	for(int i = 0; i < 4; ++i)
@@ -1427,7 +1752,7 @@ void rasterizer::draw_full_quad(
 	if(quad_mask != 0)
 	{
 		triangle_ctx->pixel_stat->backend_input_pixels += 4;
-		frame_buffer_->render_sample_quad(
+		shaders->frame_buffer->render_sample_quad(
 			shaders->cpp_bs, left, top, quad_mask,
 			pso, depth, triangle_ctx->tri_info->front_face, triangle_ctx->aa_z_offset
 			);
@@ -1443,14 +1768,11 @@ void rasterizer::draw_quad(
 #if 1
 	EFLIB_ALIGN(16) vs_output pixels[4];
 
-	auto v0  =  triangle_ctx->tri_info->v0;
-	auto ddx = &triangle_ctx->tri_info->ddx; 
-	auto ddy = &triangle_ctx->tri_info->ddy;
+	interpolation_planes const& planes = triangle_ctx->tri_info->planes;
+	float const quad_x = 0.5f + left;
+	float const quad_y = 0.5f + top;
 
-	float const quad_dx = 0.5f + left - v0->position().x();
-	float const quad_dy = 0.5f + top  - v0->position().y();
-
-	vso_ops_->step_2d_unproj_pos_quad(pixels, *v0, quad_dx, *ddx, quad_dy, *ddy);
+	vso_ops_->interpolate_pos_quad(pixels, planes, quad_x, quad_y);
 
 	ps_output pso[4];
 	float     depth[4] = 
@@ -1462,9 +1784,9 @@ void rasterizer::draw_quad(
 	};
 
 	uint64_t tested_quad_mask = quad_mask;
-	if ( frame_buffer_->early_z_enabled() )
+	if ( shaders->frame_buffer->early_z_enabled() )
 	{
-		tested_quad_mask = frame_buffer_->early_z_test_quad(left, top, quad_mask, depth, triangle_ctx->aa_z_offset);
+		tested_quad_mask = shaders->frame_buffer->early_z_test_quad(left, top, quad_mask, depth, triangle_ctx->aa_z_offset, triangle_ctx->z_plane);
 	}
 
 	if(tested_quad_mask == 0)
@@ -1472,9 +1794,15 @@ void rasterizer::draw_quad(
 		return;
 	}
 
+	if(sample_shading_)
+	{
+		draw_quad_samples(left, top, tested_quad_mask, depth, shaders, triangle_ctx);
+		return;
+	}
+
 	if(!has_centroid_)
 	{
-		vso_ops_->step_2d_unproj_attr_quad(pixels, *v0, quad_dx, *ddx, quad_dy, *ddy);
+		vso_ops_->interpolate_attr_quad(pixels, planes, quad_x, quad_y);
 	}
 	else
 	{
@@ -1483,8 +1811,8 @@ void rasterizer::draw_quad(
 			int ix = (i_pixel & 1);
 			int iy = (i_pixel & 2) >> 1;
 
-			float dx = quad_dx + ix;
-			float dy = quad_dy + iy;
+			float x = quad_x + ix;
+			float y = quad_y + iy;
 
 			uint32_t pixel_mask = ( quad_mask >> (i_pixel * MAX_SAMPLE_COUNT) ) & SAMPLE_MASK;
 
@@ -1508,10 +1836,10 @@ void rasterizer::draw_quad(
 
 				pixel_mask = mask_backup;
 
-				dx += sp_centroid.x() - 0.5f;
-				dy += sp_centroid.y() - 0.5f;
+				x += sp_centroid.x() - 0.5f;
+				y += sp_centroid.y() - 0.5f;
 			}
-			vso_ops_->step_2d_unproj_attr(pixels[i_pixel], *v0, dx, *ddx, dy, *ddy);
+			vso_ops_->interpolate_attr(pixels[i_pixel], planes, x, y);
 		}
 	}
 
@@ -1530,7 +1858,7 @@ void rasterizer::draw_quad(
 	if(quad_mask != 0)
 	{
 		triangle_ctx->pixel_stat->backend_input_pixels += 4;
-		frame_buffer_->render_sample_quad(
+		shaders->frame_buffer->render_sample_quad(
 			shaders->cpp_bs, left, top, tested_quad_mask,
 			pso, depth, triangle_ctx->tri_info->front_face, triangle_ctx->aa_z_offset
 			);
@@ -1538,4 +1866,159 @@ void rasterizer::draw_quad(
 #endif
 }
 
+void rasterizer::draw_quad_samples(
+	uint32_t left, uint32_t top, uint64_t quad_mask, float const* depth,
+	drawing_shader_context const* shaders,
+	drawing_triangle_context const* triangle_ctx)
+{
+	EFLIB_ALIGN(16) vs_output pixels[4];
+
+	interpolation_planes const& planes = triangle_ctx->tri_info->planes;
+
+	// Bit of sample 0 in all pixels of quad.
+	uint64_t const quad_sample0_mask =
+		(1ULL << (MAX_SAMPLE_COUNT * 0)) | (1ULL << (MAX_SAMPLE_COUNT * 1)) |
+		(1ULL << (MAX_SAMPLE_COUNT * 2)) | (1ULL << (MAX_SAMPLE_COUNT * 3)) ;
+
+	for(size_t i_sample = 0; i_sample < target_sample_count_; ++i_sample)
+	{
+		uint64_t sample_mask = quad_mask & (quad_sample0_mask << i_sample);
+		if(sample_mask == 0)
+		{
+			continue;
+		}
+
+		vec2 const& sp = samples_pattern_[i_sample];
+		float const x = left + sp.x();
+		float const y = top  + sp.y();
+		vso_ops_->interpolate_pos_quad(pixels, planes, x, y);
+		vso_ops_->interpolate_attr_quad(pixels, planes, x, y);
+
+		float sample_depth[4] =
+		{
+			pixels[0].position().z(),
+			pixels[1].position().z(),
+			pixels[2].position().z(),
+			pixels[3].position().z()
+		};
+
+		triangle_ctx->pixel_stat->ps_invocations += 4;
+
+		ps_output pso[4];
+		if(shaders->ps_unit)
+		{
+			shaders->ps_unit->update(pixels, vs_reflection_);
+			shaders->ps_unit->execute(pso, sample_depth);
+		}
+		else
+		{
+			sample_mask &= shaders->cpp_ps->execute(pixels, pso, sample_depth);
+		}
+
+		if(sample_mask != 0)
+		{
+			// Depth of sample is still evaluated from depth of pixel center and offset of sample.
+			triangle_ctx->pixel_stat->backend_input_pixels += 4;
+			shaders->frame_buffer->render_sample_quad(
+				shaders->cpp_bs, left, top, sample_mask,
+				pso, depth, triangle_ctx->tri_info->front_face, triangle_ctx->aa_z_offset
+				);
+		}
+	}
+}
+
+void rasterizer::draw_coarse_block(
+	uint32_t left, uint32_t top, uint64_t const* quad_masks,
+	drawing_shader_context const* shaders,
+	drawing_triangle_context const* triangle_ctx)
+{
+	EFLIB_ALIGN(16) vs_output pixels[4];
+
+	interpolation_planes const& planes = triangle_ctx->tri_info->planes;
+
+	// Depth is still tested per pixel.
+	float		depth[4][4];
+	uint64_t	tested_masks[4];
+	uint64_t	any_passed = 0;
+	for(int quad = 0; quad < 4; ++quad)
+	{
+		tested_masks[quad] = quad_masks[quad];
+		if(quad_masks[quad] == 0)
+		{
+			continue;
+		}
+
+		uint32_t const quad_left = left + ( (quad & 1) << 1 );
+		uint32_t const quad_top  = top  + (quad & 2);
+		vso_ops_->interpolate_pos_quad(pixels, planes, 0.5f + quad_left, 0.5f + quad_top);
+		for(int i_pixel = 0; i_pixel < 4; ++i_pixel)
+		{
+			depth[quad][i_pixel] = pixels[i_pixel].position().z();
+		}
+
+		if ( shaders->frame_buffer->early_z_enabled() )
+		{
+			tested_masks[quad] = (quad_masks[quad] == quad_full_mask_)
+				? shaders->frame_buffer->early_z_test_quad(quad_left, quad_top, depth[quad], triangle_ctx->aa_z_offset, triangle_ctx->z_plane)
+				: shaders->frame_buffer->early_z_test_quad(quad_left, quad_top, quad_masks[quad], depth[quad], triangle_ctx->aa_z_offset, triangle_ctx->z_plane);
+		}
+		any_passed |= tested_masks[quad];
+	}
+
+	if(any_passed == 0)
+	{
+		return;
+	}
+
+	// Pixels of shading quad are centers of coarse pixels, so derivatives are scaled by shading rate.
+	// With 2x2 rate, coarse pixel i is quad i of block.
+	// With 4x4 rate, the block is one coarse pixel and the other pixels of shading quad are helpers.
+	float const rate = static_cast<float>(shading_rate_);
+	float const coarse_x = left + rate * 0.5f;
+	float const coarse_y = top  + rate * 0.5f;
+
+	float coarse_depth[4];
+	for(int i_pixel = 0; i_pixel < 4; ++i_pixel)
+	{
+		float const x = coarse_x + rate * (i_pixel & 1);
+		float const y = coarse_y + rate * ( (i_pixel & 2) >> 1 );
+		pixels[i_pixel].position() = planes.a[0] * x + planes.b[0] * y + planes.c[0];
+		vso_ops_->interpolate_attr(pixels[i_pixel], planes, x, y);
+		coarse_depth[i_pixel] = pixels[i_pixel].position().z();
+	}
+
+	triangle_ctx->pixel_stat->ps_invocations += (shading_rate_ == shading_rate_2x2) ? 4 : 1;
+
+	ps_output coarse_pso[4];
+	uint64_t  shaded_mask = quad_full_mask_;
+	if(shaders->ps_unit)
+	{
+		shaders->ps_unit->update(pixels, vs_reflection_);
+		shaders->ps_unit->execute(coarse_pso, coarse_depth);
+	}
+	else
+	{
+		shaded_mask &= shaders->cpp_ps->execute(pixels, coarse_pso, coarse_depth);
+	}
+
+	// Broadcast color of coarse pixel to all samples it covers.
+	for(int quad = 0; quad < 4; ++quad)
+	{
+		int const coarse_pixel = (shading_rate_ == shading_rate_2x2) ? quad : 0;
+		if( tested_masks[quad] == 0 || ( (shaded_mask >> (coarse_pixel * MAX_SAMPLE_COUNT)) & full_mask_ ) == 0 )
+		{
+			continue;
+		}
+
+		ps_output pso[4];
+		pso[0] = pso[1] = pso[2] = pso[3] = coarse_pso[coarse_pixel];
+
+		triangle_ctx->pixel_stat->backend_input_pixels += 4;
+		shaders->frame_buffer->render_sample_quad(
+			shaders->cpp_bs, left + ( (quad & 1) << 1 ), top + (quad & 2), tested_masks[quad],
+			pso, depth[quad], triangle_ctx->tri_info->front_face, triangle_ctx->aa_z_offset
+			);
+	}
+}
+
 END_NS_SALVIAR();
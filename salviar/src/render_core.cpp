@@ -8,6 +8,7 @@
 #include <salviar/include/rasterizer.h>
 #include <salviar/include/framebuffer.h>
 #include <salviar/include/surface.h>
+#include <salviar/include/fragment_lists.h>
 #include <salviar/include/vertex_cache.h>
 #include <salviar/include/stream_assembler.h>
 #include <salviar/include/shader_unit.h>
@@ -37,10 +38,14 @@ result render_core::execute()
     case command_id::draw:
     case command_id::draw_index:
         return draw();
+    case command_id::multi_draw_index:
+        return multi_draw();
     case command_id::clear_color:
         return clear_color();
     case command_id::clear_depth_stencil:
         return clear_depth_stencil();
+    case command_id::resolve_transparency:
+        return resolve_transparency();
     case command_id::async_begin:
         return async_start();
     case command_id::async_end:
@@ -59,16 +64,61 @@ result render_core::draw()
 		return result::ok;
 	}
 
+	update_stages();
+    stages_.ras->draw();
+
+	return result::ok;
+}
+
+result render_core::multi_draw()
+{
+	if(state_->color_targets.empty() || !state_->depth_stencil_target)
+	{
+		return result::ok;
+	}
+
+	// Stages are updated once. Only index range and per-draw constants are changed between draws.
+	update_stages();
+
+	auto const& draws = state_->multi_draws;
+	for(size_t i_draw = 0; i_draw < draws.size(); ++i_draw)
+	{
+		if(i_draw > 0)
+		{
+			state_->start_index	= draws[i_draw].start_index;
+			state_->prim_count	= draws[i_draw].prim_count;
+			state_->base_vertex	= draws[i_draw].base_vertex;
+			stages_.ras->update_draw_args(state_.get());
+			stages_.vert_cache->update_draw_args(state_.get());
+		}
+
+		// Per-draw constants were rejected by renderer if vertex shader is not compiled.
+		if(state_->per_draw_size > 0)
+		{
+			stages_.host->vx_update_constant(
+				state_->per_draw_var,
+				&state_->per_draw_data[i_draw * state_->per_draw_size],
+				state_->per_draw_size
+				);
+		}
+
+		stages_.ras->draw();
+	}
+
+	return result::ok;
+}
+
+void render_core::update_stages()
+{
+	update_specialized_shader();
+
 	stages_.assembler->update(state_.get());
 	stages_.ras->update(state_.get());
 	stages_.vert_cache->update(state_.get());
 	stages_.host->update(state_.get());
     stages_.backend->update(state_.get());
 	apply_shader_cbuffer();
-
-    stages_.ras->draw();
-
-	return result::ok;
+	resolve_texture_clears();
 }
 
 render_core::render_core()
@@ -86,6 +136,22 @@ render_core::render_core()
 	stages_.backend->initialize(&stages_);
 }
 
+void render_core::update_specialized_shader()
+{
+	if(!state_->px_shader || !state_->ps_proto)
+	{
+		return;
+	}
+
+	// Pixel shader is recompiled if values of specialized variables were changed.
+	shader_object* specialized_ps = state_->px_shader->specialized(state_->px_cbuffer);
+	if(state_->ps_proto->code != specialized_ps)
+	{
+		state_->ps_proto.reset( new pixel_shader_unit() );
+		state_->ps_proto->initialize(specialized_ps);
+	}
+}
+
 void render_core::apply_shader_cbuffer()
 {
 	if(state_->ps_proto)
@@ -105,9 +171,40 @@ void render_core::apply_shader_cbuffer()
 	}
 }
 
+void render_core::resolve_texture_clears()
+{
+	// Pending clears of bound textures are filled once per draw instead of per sampled texel.
+	shader_cbuffer const* cbuffers[] = { &state_->vx_cbuffer, &state_->px_cbuffer };
+	for(auto cbuffer: cbuffers)
+	{
+		for(auto const& samp: cbuffer->samplers())
+		{
+			if(samp.second)
+			{
+				samp.second->resolve_clear();
+			}
+		}
+	}
+
+	if(state_->cpp_vs)
+	{
+		state_->cpp_vs->resolve_sampler_clears();
+	}
+
+	if(state_->cpp_ps)
+	{
+		state_->cpp_ps->resolve_sampler_clears();
+	}
+
+	if(state_->cpp_bs)
+	{
+		state_->cpp_bs->resolve_sampler_clears();
+	}
+}
+
 result render_core::clear_color()
 {
-    state_->clear_color_target->fill_texels(state_->clear_color);
+    state_->clear_color_target->clear(state_->clear_color);
     return result::ok;
 }
 
@@ -118,7 +215,7 @@ result render_core::clear_depth_stencil()
 		auto ds_color = color_rgba32f(
 			    state_->clear_z, *reinterpret_cast<float*>(&state_->clear_stencil), 0.0f, 0.0f
 				);
-		state_->clear_ds_target->fill_texels(ds_color);
+		state_->clear_ds_target->clear(ds_color);
 	}
 	else
 	{
@@ -130,6 +227,12 @@ result render_core::clear_depth_stencil()
     return result::ok;
 }
 
+result render_core::resolve_transparency()
+{
+	state_->oit_resolve_target->fragment_lists()->resolve();
+	return result::ok;
+}
+
 result render_core::async_start()
 {
     state_->current_async->start_counting();
@@ -10,6 +10,7 @@ void copy_using_state(render_state* dest, render_state const* src)
     {
     case command_id::draw:
     case command_id::draw_index:
+    case command_id::multi_draw_index:
         *dest = *src;
         if(src->cpp_vs)
         {
@@ -35,6 +36,10 @@ void copy_using_state(render_state* dest, render_state const* src)
 	    dest->clear_stencil      = src->clear_stencil     ;
         dest->clear_color        = src->clear_color       ;
         break;
+    case command_id::resolve_transparency:
+        dest->cmd                = src->cmd;
+        dest->oit_resolve_target = src->oit_resolve_target;
+        break;
     case command_id::async_begin:
     case command_id::async_end:
         dest->cmd                = src->cmd;
@@ -1,6 +1,7 @@
 #include <salviar/include/renderer_impl.h>
 
 #include <salviar/include/binary_modules.h>
+#include <salviar/include/buffer.h>
 #include <salviar/include/shader_regs.h>
 #include <salviar/include/shader_regs_op.h>
 #include <salviar/include/shader_cbuffer.h>
@@ -164,6 +165,17 @@ cpp_blend_shader_ptr renderer_impl::get_blend_shader() const
 	return state_->cpp_bs;
 }
 
+result renderer_impl::set_blend_state(blend_state_ptr const& bs)
+{
+	state_->blend_state = bs;
+	return result::ok;
+}
+
+blend_state_ptr renderer_impl::get_blend_state() const
+{
+	return state_->blend_state;
+}
+
 result renderer_impl::set_viewport(const viewport& vp)
 {
     if( vp.x < 0 ||
@@ -184,6 +196,42 @@ viewport renderer_impl::get_viewport() const
 	return state_->vp;
 }
 
+result renderer_impl::set_scissor_rect(eflib::rect<int32_t> const& rc)
+{
+	if(rc.w < 0 || rc.h < 0)
+	{
+		return result::invalid_parameter;
+	}
+	state_->scissor = rc;
+	return result::ok;
+}
+
+eflib::rect<int32_t> renderer_impl::get_scissor_rect() const
+{
+	return state_->scissor;
+}
+
+result renderer_impl::set_sample_positions(size_t count, eflib::vec2 const* positions)
+{
+	if(count > MAX_SAMPLE_COUNT || (count > 0 && positions == nullptr) )
+	{
+		return result::invalid_parameter;
+	}
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		if( positions[i].x() < 0.0f || positions[i].x() >= 1.0f
+		 || positions[i].y() < 0.0f || positions[i].y() >= 1.0f )
+		{
+			return result::invalid_parameter;
+		}
+	}
+
+	state_->sample_position_count = static_cast<uint32_t>(count);
+	std::copy(positions, positions + count, state_->sample_positions);
+	return result::ok;
+}
+
 //do not support get function for a while
 result renderer_impl::set_render_targets(size_t color_target_count, surface_ptr const* color_targets, surface_ptr const& ds_target)
 {
@@ -246,6 +294,9 @@ result renderer_impl::set_render_targets(size_t color_target_count, surface_ptr
         switch(ds_target->get_pixel_format())
         {
         case pixel_format_color_rg32f:
+        case pixel_format_color_d32f:
+        case pixel_format_color_d24s8:
+        case pixel_format_color_d16:
             break;
         default:
             return result::failed;
@@ -326,12 +377,16 @@ renderer_impl::renderer_impl()
 
 	state_->ras_state.reset(new raster_state(raster_desc()));
 	state_->ds_state.reset(new depth_stencil_state(depth_stencil_desc()));
+	state_->blend_state.reset(new blend_state(blend_desc()));
 
 	state_->vp.minz = 0.0f;
 	state_->vp.maxz = 1.0f;
 	state_->vp.w = 0.0f;
 	state_->vp.h = 0.0f;
 	state_->vp.x = state_->vp.y = 0;
+
+	state_->scissor = eflib::rect<int32_t>(0, 0, MAX_RENDER_TARGET_WIDTH, MAX_RENDER_TARGET_HEIGHT);
+	state_->sample_position_count = 0;
 }
 
 result renderer_impl::set_vs_variable_value( std::string const& name, void const* var_addr, size_t sz)
@@ -392,25 +447,126 @@ result renderer_impl::set_vs_sampler( std::string const& name, sampler_ptr const
 }
 
 result renderer_impl::draw(size_t startpos, size_t primcnt)
+{
+	return draw_instanced(startpos, primcnt, 1, 0);
+}
+
+result renderer_impl::draw_index(size_t startpos, size_t primcnt, int basevert)
+{
+	return draw_index_instanced(startpos, primcnt, basevert, 1, 0);
+}
+
+result renderer_impl::draw_instanced(size_t startpos, size_t primcnt, size_t instcnt, size_t startinst)
 {
     state_->cmd = command_id::draw;
-	state_->start_index = static_cast<uint32_t>(startpos);
-	state_->prim_count  = static_cast<uint32_t>(primcnt);
-	state_->base_vertex = 0;
+	state_->start_index		= static_cast<uint32_t>(startpos);
+	state_->prim_count		= static_cast<uint32_t>(primcnt);
+	state_->base_vertex		= 0;
+	state_->instance_count	= static_cast<uint32_t>(instcnt);
+	state_->start_instance	= static_cast<uint32_t>(startinst);
 
     return commit_state_and_command();
 }
 
-result renderer_impl::draw_index(size_t startpos, size_t primcnt, int basevert)
+result renderer_impl::draw_index_instanced(size_t startpos, size_t primcnt, int basevert, size_t instcnt, size_t startinst)
 {
     state_->cmd = command_id::draw_index;
-	state_->start_index = static_cast<uint32_t>(startpos);
-	state_->prim_count  = static_cast<uint32_t>(primcnt);
-	state_->base_vertex = basevert;
+	state_->start_index		= static_cast<uint32_t>(startpos);
+	state_->prim_count		= static_cast<uint32_t>(primcnt);
+	state_->base_vertex		= basevert;
+	state_->instance_count	= static_cast<uint32_t>(instcnt);
+	state_->start_instance	= static_cast<uint32_t>(startinst);
 
     return commit_state_and_command();
 }
 
+result renderer_impl::multi_draw_indexed(
+	draw_index_args const* draws, size_t draw_count,
+	std::string const& per_draw_var, void const* constants, size_t constants_size)
+{
+	if(draw_count == 0)
+	{
+		return result::ok;
+	}
+
+	bool const has_per_draw_constants = constants && constants_size > 0 && !per_draw_var.empty();
+
+	// Per-draw constants are only available for compiled vertex shader.
+	if(has_per_draw_constants && state_->cpp_vs)
+	{
+		return result::invalid_parameter;
+	}
+
+	// Per-draw constants are written to buffer of vertex shader, but specialized variable is folded into code.
+	if( has_per_draw_constants && state_->vx_shader && state_->vx_shader->is_specialized_variable(per_draw_var) )
+	{
+		return result::invalid_parameter;
+	}
+
+	state_->cmd = command_id::multi_draw_index;
+	state_->multi_draws.assign(draws, draws + draw_count);
+	state_->start_index		= draws[0].start_index;
+	state_->prim_count		= draws[0].prim_count;
+	state_->base_vertex		= draws[0].base_vertex;
+	state_->instance_count	= 1;
+	state_->start_instance	= 0;
+
+	// Per-draw constants are packed by draw order.
+	state_->per_draw_data.clear();
+	state_->per_draw_size = 0;
+	if(has_per_draw_constants)
+	{
+		state_->per_draw_var	= per_draw_var;
+		state_->per_draw_size	= constants_size;
+		state_->per_draw_data.resize(draw_count * constants_size);
+		for(size_t i_draw = 0; i_draw < draw_count; ++i_draw)
+		{
+			memcpy(
+				&state_->per_draw_data[i_draw * constants_size],
+				static_cast<uint8_t const*>(constants) + draws[i_draw].constants_offset,
+				constants_size
+				);
+		}
+	}
+
+    return commit_state_and_command();
+}
+
+result renderer_impl::multi_draw_indexed_indirect(
+	buffer_ptr const& draws, size_t offset, size_t draw_count,
+	std::string const& per_draw_var, size_t constants_size)
+{
+	if(!draws)
+	{
+		return result::invalid_parameter;
+	}
+
+	// Arguments and per-draw constants must be in the buffer.
+	size_t const buffer_size = draws->size();
+	if( offset > buffer_size || draw_count > (buffer_size - offset) / sizeof(draw_index_args) )
+	{
+		return result::invalid_parameter;
+	}
+
+	uint8_t const* draws_data = draws->raw_data(0);
+	draw_index_args const* args = reinterpret_cast<draw_index_args const*>(draws_data + offset);
+	if( constants_size > 0 && !per_draw_var.empty() )
+	{
+		for(size_t i_draw = 0; i_draw < draw_count; ++i_draw)
+		{
+			if( constants_size > buffer_size || args[i_draw].constants_offset > buffer_size - constants_size )
+			{
+				return result::invalid_parameter;
+			}
+		}
+	}
+
+	return multi_draw_indexed(
+		args, draw_count,
+		per_draw_var, draws_data, constants_size
+		);
+}
+
 result renderer_impl::clear_color(surface_ptr const& color_target, color_rgba32f const& c)
 {
     state_->clear_color_target = color_target;
@@ -431,6 +587,19 @@ result renderer_impl::clear_depth_stencil(surface_ptr const& depth_stencil_targe
     return commit_state_and_command();
 }
 
+result renderer_impl::resolve_transparency(surface_ptr const& color_target)
+{
+	if(!color_target)
+	{
+		return result::invalid_parameter;
+	}
+
+	state_->oit_resolve_target = color_target;
+	state_->cmd = command_id::resolve_transparency;
+
+	return commit_state_and_command();
+}
+
 result renderer_impl::begin(async_object_ptr const& async_obj)
 {
     if(!async_obj->begin())
@@ -582,6 +582,14 @@ color_rgba32f sampler::sample_surface(
 		);
 }
 
+void sampler::resolve_clear() const
+{
+	if(tex_)
+	{
+		tex_->resolve_clear();
+	}
+}
+
 sampler::sampler(sampler_desc const& desc, texture_ptr const& tex)
 	: desc_(desc)
 	, tex_(tex)
@@ -197,234 +197,151 @@ namespace vs_output_op_funcs
 		return out;
 	}
 
-	vs_output& step_2d_unproj_pos(
-		vs_output& out, const vs_output& in,
-		float step0, const vs_output& derivation0,
-		float step1, const vs_output& derivation1
-        )
+	vs_output* interpolate_pos_quad(vs_output* out, interpolation_planes const& planes, float x, float y)
 	{
 #if defined(VSO_INTERP_SSE_ENABLED)
-		__m128 const* d0_m128	= reinterpret_cast<__m128 const*>( derivation0.raw_data() );
-		__m128 const* d1_m128	= reinterpret_cast<__m128 const*>( derivation1.raw_data() );
-		__m128 const* in_m128	= reinterpret_cast<__m128 const*>( in.raw_data() );
-		__m128*		  out_m128	= reinterpret_cast<__m128 *>( out.raw_data() );
-		__m128		  step0_m128= _mm_load_ps1(&step0);
-		__m128		  step1_m128= _mm_load_ps1(&step1);
+		__m128 a_m128 = _mm_load_ps( &planes.a[0].x() );
+		__m128 b_m128 = _mm_load_ps( &planes.b[0].x() );
+		__m128 c_m128 = _mm_load_ps( &planes.c[0].x() );
 
-		out_m128[0] = _mm_add_ps(
-			in_m128[0],
-			_mm_add_ps( _mm_mul_ps(d0_m128[0], step0_m128), _mm_mul_ps(d1_m128[0], step1_m128) )
-			);
+		__m128& pos00_m128	= *reinterpret_cast<__m128 *>( out[0].raw_data() );
+		__m128& pos01_m128	= *reinterpret_cast<__m128 *>( out[1].raw_data() );
+		__m128& pos10_m128	= *reinterpret_cast<__m128 *>( out[2].raw_data() );
+		__m128& pos11_m128	= *reinterpret_cast<__m128 *>( out[3].raw_data() );
 
+		pos00_m128 = _mm_add_ps(
+			c_m128,
+			_mm_add_ps( _mm_mul_ps(a_m128, _mm_set1_ps(x)), _mm_mul_ps(b_m128, _mm_set1_ps(y)) )
+			);
+		pos01_m128 = _mm_add_ps(pos00_m128, a_m128);
+		pos10_m128 = _mm_add_ps(pos00_m128, b_m128);
+		pos11_m128 = _mm_add_ps(pos01_m128, b_m128);
 #else
-		out.position() =
-			in.position()
-			+ (derivation0.position() * step0)
-			+ (derivation1.position() * step1);
-
+		out[0].position() = planes.a[0] * x + planes.b[0] * y + planes.c[0];
+		out[1].position() = out[0].position() + planes.a[0];
+		out[2].position() = out[0].position() + planes.b[0];
+		out[3].position() = out[1].position() + planes.b[0];
 #endif
 		return out;
 	}
 
-    template <int N>
-	vs_output& step_2d_unproj_attr_n(
-		vs_output& out, const vs_output& in,
-		float step0, const vs_output& derivation0,
-		float step1, const vs_output& derivation1
-        )
+	template <int N>
+	vs_output* interpolate_attr_n_quad(vs_output* out, interpolation_planes const& planes, float x, float y)
 	{
 #if defined(VSO_INTERP_SSE_ENABLED)
-		__m128 const* d0_m128	= reinterpret_cast<__m128 const*>( derivation0.raw_data() );
-		__m128 const* d1_m128	= reinterpret_cast<__m128 const*>( derivation1.raw_data() );
-		__m128 const* in_m128	= reinterpret_cast<__m128 const*>( in.raw_data() );
-		__m128*		  out_m128	= reinterpret_cast<__m128 *>( out.raw_data() );
-		__m128		  step0_m128= _mm_load_ps1(&step0);
-		__m128		  step1_m128= _mm_load_ps1(&step1);
+		__m128 const* a_m128 = reinterpret_cast<__m128 const*>( planes.a );
+		__m128 const* b_m128 = reinterpret_cast<__m128 const*>( planes.b );
+		__m128 const* c_m128 = reinterpret_cast<__m128 const*>( planes.c );
 
-		float inv_w = 1.0f / _xmm_extract_ps(out_m128[0], 3);
-		__m128 inv_w4 = _mm_load_ps1(&inv_w);
+		__m128*		  out00_m128	= reinterpret_cast<__m128 *>( out[0].raw_data() );
+		__m128*		  out01_m128	= reinterpret_cast<__m128 *>( out[1].raw_data() );
+		__m128*		  out10_m128	= reinterpret_cast<__m128 *>( out[2].raw_data() );
+		__m128*		  out11_m128	= reinterpret_cast<__m128 *>( out[3].raw_data() );
 
-		for(size_t i_attr = 0; i_attr < N; ++i_attr)
-		{
-			__m128 interp_attr;
-			if (vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_nointerpolation)
-			{
-				interp_attr = in_m128[i_attr+1];
-			}
-			else
-			{
-				interp_attr = _mm_add_ps(
-					in_m128[i_attr + 1],
-					_mm_add_ps(
-						_mm_mul_ps(d0_m128[i_attr + 1], step0_m128),
-						_mm_mul_ps(d1_m128[i_attr + 1], step1_m128)
-						)
-					);
+		__m128		  x_m128		= _mm_set1_ps(x);
+		__m128		  y_m128		= _mm_set1_ps(y);
 
-			}
+		// 1/w of the four pixels in one register, so the whole quad needs a single divide.
+		float const aw = planes.a[0].w();
+		float const bw = planes.b[0].w();
+		float const w00 = aw * x + bw * y + planes.c[0].w();
+		__m128 w4 = _mm_add_ps( _mm_set1_ps(w00), _mm_set_ps(aw + bw, bw, aw, 0.0f) );
+		__m128 inv_w4 = _mm_div_ps( _mm_set1_ps(1.0f), w4 );
 
-			// Perspective
-			if (vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_noperspective)
+		__m128 inv_w00 = _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 inv_w01 = _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(1, 1, 1, 1));
+		__m128 inv_w10 = _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(2, 2, 2, 2));
+		__m128 inv_w11 = _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(3, 3, 3, 3));
+
+		for(size_t i_reg = 1; i_reg < N + 1; ++i_reg)
+		{
+			__m128 attr00 = _mm_add_ps(
+				c_m128[i_reg],
+				_mm_add_ps( _mm_mul_ps(a_m128[i_reg], x_m128), _mm_mul_ps(b_m128[i_reg], y_m128) )
+				);
+			__m128 attr01 = _mm_add_ps(attr00, a_m128[i_reg]);
+			__m128 attr10 = _mm_add_ps(attr00, b_m128[i_reg]);
+			__m128 attr11 = _mm_add_ps(attr01, b_m128[i_reg]);
+
+			if (vs_output_ops[N].attribute_modifiers[i_reg-1] & vs_output::am_noperspective)
 			{
-				out_m128[i_attr+1] = interp_attr;
+				out00_m128[i_reg] = attr00;
+				out01_m128[i_reg] = attr01;
+				out10_m128[i_reg] = attr10;
+				out11_m128[i_reg] = attr11;
 			}
 			else
 			{
-				out_m128[i_attr+1] = _mm_mul_ps(interp_attr, inv_w4);
+				out00_m128[i_reg] = _mm_mul_ps(attr00, inv_w00);
+				out01_m128[i_reg] = _mm_mul_ps(attr01, inv_w01);
+				out10_m128[i_reg] = _mm_mul_ps(attr10, inv_w10);
+				out11_m128[i_reg] = _mm_mul_ps(attr11, inv_w11);
 			}
 		}
 #else
-		for(size_t i_attr = 0; i_attr < N; ++i_attr)
+		for(int i_pixel = 0; i_pixel < 4; ++i_pixel)
 		{
-			if (vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_nointerpolation)
-			{
-				out.attribute(i_attr) = in.attribute(i_attr);
-			}
-			else
+			float const px = x + (i_pixel & 1);
+			float const py = y + ((i_pixel & 2) >> 1);
+			float const inv_w = 1.0f / (planes.a[0].w() * px + planes.b[0].w() * py + planes.c[0].w());
+
+			for(size_t i_attr = 0; i_attr < N; ++i_attr)
 			{
-				out.attribute(i_attr) =
-					in.attribute(i_attr)
-					+ (derivation0.attribute(i_attr) * step0)
-					+ (derivation1.attribute(i_attr) * step1);
+				vec4 attr = planes.a[i_attr+1] * px + planes.b[i_attr+1] * py + planes.c[i_attr+1];
+				if (!(vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_noperspective))
+				{
+					attr *= inv_w;
+				}
+				out[i_pixel].attribute(i_attr) = attr;
 			}
 		}
 #endif
-
 		return out;
 	}
 
-	vs_output& step_2d_unproj_pos_quad(
-		vs_output* out, const vs_output& in,
-		float step0, const vs_output& derivation0,
-		float step1, const vs_output& derivation1
-        )
-	{
-#if defined(VSO_INTERP_SSE_ENABLED)
-		__m128  d0_m128 = _mm_load_ps( reinterpret_cast<float const*>( derivation0.raw_data() ) );
-		__m128  d1_m128 = _mm_load_ps( reinterpret_cast<float const*>( derivation1.raw_data() ) );
-
-		__m128  in_m128 = _mm_load_ps( reinterpret_cast<float const*>( in.raw_data() ) );
-		
-		__m128& pos00_m128	= *reinterpret_cast<__m128 *>( out[0].raw_data() );
-		__m128& pos01_m128	= *reinterpret_cast<__m128 *>( out[1].raw_data() );
-		__m128& pos10_m128	= *reinterpret_cast<__m128 *>( out[2].raw_data() );
-		__m128& pos11_m128	= *reinterpret_cast<__m128 *>( out[3].raw_data() );
-
-		__m128  step0_m128	= _mm_load_ps1(&step0);
-		__m128  step1_m128	= _mm_load_ps1(&step1);
-
-		pos00_m128 = _mm_add_ps(
-			in_m128,
-			_mm_add_ps( _mm_mul_ps(d0_m128, step0_m128), _mm_mul_ps(d1_m128, step1_m128) )
-			);
-		pos01_m128 = _mm_add_ps(pos00_m128, d0_m128);
-		pos10_m128 = _mm_add_ps(pos00_m128, d1_m128);
-		pos11_m128 = _mm_add_ps(pos01_m128, d1_m128);
-#else
-		EFLIB_ASSERT_UNIMPLEMENTED();
-#endif
-
-		return *out;
-	}
-
 	template <int N>
-	vs_output& step_2d_unproj_attr_n_quad(
-		vs_output* out, const vs_output& in,
-		float step0, const vs_output& derivation0,
-		float step1, const vs_output& derivation1
-        )
+	vs_output& interpolate_attr_n(vs_output& out, interpolation_planes const& planes, float x, float y)
 	{
-#if defined(VSO_INTERP_SSE_ENABLED)
-		__m128 const* d0_m128		= reinterpret_cast<__m128 const*>( derivation0.raw_data() );
-		__m128 const* d1_m128		= reinterpret_cast<__m128 const*>( derivation1.raw_data() );
-
-		__m128 const* in_m128		= reinterpret_cast<__m128 const*>( in.raw_data() );
-		
-		__m128*		  out00_m128	= reinterpret_cast<__m128 *>( out[0].raw_data() );
-		__m128*		  out01_m128	= reinterpret_cast<__m128 *>( out[1].raw_data() );
-		__m128*		  out10_m128	= reinterpret_cast<__m128 *>( out[2].raw_data() );
-		__m128*		  out11_m128	= reinterpret_cast<__m128 *>( out[3].raw_data() );
+		float const inv_w = 1.0f / (planes.a[0].w() * x + planes.b[0].w() * y + planes.c[0].w());
 
-		__m128		  step0_m128	= _mm_load_ps1(&step0);
-		__m128		  step1_m128	= _mm_load_ps1(&step1);
+#if defined(VSO_INTERP_SSE_ENABLED)
+		__m128 const* a_m128 = reinterpret_cast<__m128 const*>( planes.a );
+		__m128 const* b_m128 = reinterpret_cast<__m128 const*>( planes.b );
+		__m128 const* c_m128 = reinterpret_cast<__m128 const*>( planes.c );
+		__m128*		  out_m128	= reinterpret_cast<__m128 *>( out.raw_data() );
 
-		EFLIB_ALIGN(16) float w[] = 
-		{
-			_xmm_extract_ps(out00_m128[0], 3),
-			_xmm_extract_ps(out01_m128[0], 3),
-			_xmm_extract_ps(out10_m128[0], 3),
-			_xmm_extract_ps(out11_m128[0], 3)
-		};
-
-		__m128 inv_w4 = _mm_set_ps(
-			1.0f/w[0],
-			1.0f/w[1],
-			1.0f/w[2],
-			1.0f/w[3]
-			);
+		__m128		  x_m128	= _mm_set1_ps(x);
+		__m128		  y_m128	= _mm_set1_ps(y);
+		__m128		  inv_w4	= _mm_set1_ps(inv_w);
 
-		for(size_t i_attr = 0; i_attr < N; ++i_attr)
+		for(size_t i_reg = 1; i_reg < N + 1; ++i_reg)
 		{
-			__m128 interp_attr00;
-			__m128 interp_attr01;
-			__m128 interp_attr10;
-			__m128 interp_attr11;
-
-			if (vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_nointerpolation)
-			{
-				interp_attr00 = in_m128[i_attr+1];
-				interp_attr01 = in_m128[i_attr+1];
-				interp_attr10 = in_m128[i_attr+1];
-				interp_attr11 = in_m128[i_attr+1];
-			}
-			else
-			{
-				interp_attr00 = _mm_add_ps(
-					in_m128[i_attr + 1],
-					_mm_add_ps(
-						_mm_mul_ps(d0_m128[i_attr + 1], step0_m128),
-						_mm_mul_ps(d1_m128[i_attr + 1], step1_m128)
-						)
-					);
-				interp_attr01 = _mm_add_ps(interp_attr00, d0_m128[i_attr+1]);
-				interp_attr10 = _mm_add_ps(interp_attr00, d1_m128[i_attr+1]);
-				interp_attr11 = _mm_add_ps(interp_attr01, d1_m128[i_attr+1]);
-			}
+			__m128 attr = _mm_add_ps(
+				c_m128[i_reg],
+				_mm_add_ps( _mm_mul_ps(a_m128[i_reg], x_m128), _mm_mul_ps(b_m128[i_reg], y_m128) )
+				);
 
-			// Perspective
-			if (vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_noperspective)
+			if (vs_output_ops[N].attribute_modifiers[i_reg-1] & vs_output::am_noperspective)
 			{
-				out00_m128[i_attr+1] = interp_attr00;
-				out01_m128[i_attr+1] = interp_attr01;
-				out10_m128[i_attr+1] = interp_attr10;
-				out11_m128[i_attr+1] = interp_attr11;
+				out_m128[i_reg] = attr;
 			}
 			else
 			{
-				out00_m128[i_attr+1] = _mm_mul_ps(interp_attr00, _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(3, 3, 3, 3)));
-				out01_m128[i_attr+1] = _mm_mul_ps(interp_attr01, _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(2, 2, 2, 2)));
-				out10_m128[i_attr+1] = _mm_mul_ps(interp_attr10, _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(1, 1, 1, 1)));
-				out11_m128[i_attr+1] = _mm_mul_ps(interp_attr11, _mm_shuffle_ps(inv_w4, inv_w4, _MM_SHUFFLE(0, 0, 0, 0)));
+				out_m128[i_reg] = _mm_mul_ps(attr, inv_w4);
 			}
 		}
 #else
 		for(size_t i_attr = 0; i_attr < N; ++i_attr)
 		{
-			if (vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_nointerpolation)
-			{
-				out.attribute(i_attr) = in.attribute(i_attr);
-			}
-			else
+			vec4 attr = planes.a[i_attr+1] * x + planes.b[i_attr+1] * y + planes.c[i_attr+1];
+			if (!(vs_output_ops[N].attribute_modifiers[i_attr] & vs_output::am_noperspective))
 			{
-				out.attribute(i_attr) =
-					in.attribute(i_attr)
-					+ (derivation0.attribute(i_attr) * step0)
-					+ (derivation1.attribute(i_attr) * step1);
+				attr *= inv_w;
 			}
+			out.attribute(i_attr) = attr;
 		}
 #endif
-
-		return *out;
+		return out;
 	}
 
 	template <int N>
@@ -481,14 +398,17 @@ namespace vs_output_op_funcs
 	}
 
 	template <int N>
-	void compute_derivative_n(vs_output& ddx, vs_output& ddy, vs_output const& e01, vs_output const& e02, float inv_area)
+	void compute_planes_n(interpolation_planes& planes, vs_output const& v0, vs_output const& e01, vs_output const& e02, float inv_area)
 	{
-		// ddx = (e02 * e01.position.y - e02.position.y * e01) * inv_area;
-		// ddy = (e01 * e02.position.x - e01.position.x * e02) * inv_area;
+		// a = (e02 * e01.position.y - e02.position.y * e01) * inv_area;
+		// b = (e01 * e02.position.x - e01.position.x * e02) * inv_area;
+		// c = v0 - a * v0.position.x - b * v0.position.y;
 
 #if !defined(EFLIB_NO_SIMD)
-		__m128*        mddx  = reinterpret_cast<__m128*>( ddx.raw_data() );
-		__m128*        mddy  = reinterpret_cast<__m128*>( ddy.raw_data() );
+		__m128*        ma    = reinterpret_cast<__m128*>( planes.a );
+		__m128*        mb    = reinterpret_cast<__m128*>( planes.b );
+		__m128*        mc    = reinterpret_cast<__m128*>( planes.c );
+		__m128 const * mv0   = reinterpret_cast<__m128 const*>( v0.raw_data() );
 		__m128 const * me01  = reinterpret_cast<__m128 const*>( e01.raw_data() );
 		__m128 const * me02  = reinterpret_cast<__m128 const*>( e02.raw_data() );
 
@@ -498,10 +418,21 @@ namespace vs_output_op_funcs
 		__m128 me02x = _mm_shuffle_ps(me02[0], me02[0], _MM_SHUFFLE(0, 0, 0, 0));
 		__m128 me02y = _mm_shuffle_ps(me02[0], me02[0], _MM_SHUFFLE(1, 1, 1, 1));
 
+		__m128 mv0x = _mm_shuffle_ps(mv0[0], mv0[0], _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 mv0y = _mm_shuffle_ps(mv0[0], mv0[0], _MM_SHUFFLE(1, 1, 1, 1));
+
 		__m128 minv_area = _mm_set_ps1(inv_area);
 
 		for(int i = 0; i < N + 1; ++i)
 		{
+			if ( i > 0 && (vs_output_ops[N].attribute_modifiers[i-1] & vs_output::am_nointerpolation) )
+			{
+				ma[i] = _mm_setzero_ps();
+				mb[i] = _mm_setzero_ps();
+				mc[i] = mv0[i];
+				continue;
+			}
+
 			__m128 x_diff = _mm_sub_ps(
 				_mm_mul_ps(me02[i], me01y),
 				_mm_mul_ps(me01[i], me02y)
@@ -512,14 +443,26 @@ namespace vs_output_op_funcs
 				_mm_mul_ps(me02[i], me01x)
 				);
 
-			mddx[i] = _mm_mul_ps(x_diff, minv_area);
-			mddy[i] = _mm_mul_ps(y_diff, minv_area);
+			ma[i] = _mm_mul_ps(x_diff, minv_area);
+			mb[i] = _mm_mul_ps(y_diff, minv_area);
+			mc[i] = _mm_sub_ps( mv0[i], _mm_add_ps(_mm_mul_ps(ma[i], mv0x), _mm_mul_ps(mb[i], mv0y)) );
 		}
 #else
+		float const x0 = v0.position().x();
+		float const y0 = v0.position().y();
 		for(int i = 0; i < N + 1; ++i)
 		{
-			ddx.raw_data()[i] = inv_area * ( e02.raw_data()[i] * e01.position().y() - e01.raw_data()[i] * e02.position().y() );
-			ddy.raw_data()[i] = inv_area * ( e01.raw_data()[i] * e02.position().x() - e02.raw_data()[i] * e01.position().x() );
+			if ( i > 0 && (vs_output_ops[N].attribute_modifiers[i-1] & vs_output::am_nointerpolation) )
+			{
+				planes.a[i] = vec4::zero();
+				planes.b[i] = vec4::zero();
+				planes.c[i] = v0.raw_data()[i];
+				continue;
+			}
+
+			planes.a[i] = inv_area * ( e02.raw_data()[i] * e01.position().y() - e01.raw_data()[i] * e02.position().y() );
+			planes.b[i] = inv_area * ( e01.raw_data()[i] * e02.position().x() - e02.raw_data()[i] * e01.position().x() );
+			planes.c[i] = v0.raw_data()[i] - planes.a[i] * x0 - planes.b[i] * y0;
 		}
 #endif
 	}
@@ -557,11 +500,13 @@ vs_output_op gen_vs_output_op_n()
 	ret.div = div_n<N>;
 
 	ret.lerp = lerp_n<N>;
-    ret.step_2d_unproj_pos = step_2d_unproj_pos;
-    ret.step_2d_unproj_attr = step_2d_unproj_attr_n<N>;
-	ret.step_2d_unproj_pos_quad = step_2d_unproj_pos_quad;
-	ret.step_2d_unproj_attr_quad = step_2d_unproj_attr_n_quad<N>;
-	ret.compute_derivative = compute_derivative_n<N>;
+	ret.interpolate_pos_quad = interpolate_pos_quad;
+	ret.interpolate_attr_quad = interpolate_attr_n_quad<N>;
+	ret.interpolate_attr = interpolate_attr_n<N>;
+	ret.compute_planes = compute_planes_n<N>;
+
+	ret.num_attributes	= N;
+	ret.compact_size	= vs_output::compact_size(N);
 
 	return ret;
 }
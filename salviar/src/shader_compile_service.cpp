@@ -0,0 +1,246 @@
+#include <salviar/include/shader_compile_service.h>
+
+#include <salviar/include/renderer.h>
+#include <salviar/include/shader_object.h>
+
+#include <eflib/include/platform/cpuinfo.h>
+#include <eflib/include/diagnostics/assert.h>
+
+#include <eflib/include/platform/disable_warnings.h>
+#include <boost/threadpool.hpp>
+#include <eflib/include/platform/enable_warnings.h>
+
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/atomic.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <eflib/include/platform/boost_end.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+using eflib::num_available_threads;
+using boost::shared_ptr;
+using boost::make_shared;
+using std::string;
+using std::vector;
+
+BEGIN_NS_SALVIAR();
+
+shader_compile_desc::shader_compile_desc(): from_file(false)
+{
+	profile.language = lang_none;
+}
+
+shader_compile_desc::shader_compile_desc(string const& code_or_file_name, languages lang, bool from_file)
+	: code_or_file_name(code_or_file_name), from_file(from_file)
+{
+	profile.language = lang;
+}
+
+class shader_compile_service_impl: public shader_compile_service
+{
+public:
+	shader_compile_service_impl(size_t worker_count): workers_(worker_count)
+	{
+	}
+
+	~shader_compile_service_impl()
+	{
+		workers_.wait();
+	}
+
+	shader_object_future compile(shader_compile_desc const& desc)
+	{
+		request_key key(desc.from_file, desc.profile.language, desc.code_or_file_name);
+		string file_content = desc.from_file ? read_file(desc.code_or_file_name) : string();
+
+		boost::lock_guard<boost::mutex> lock(requests_mutex_);
+
+		std::map<request_key, request>::iterator it = requests_.find(key);
+		if( it != requests_.end() )
+		{
+			if(it->second.file_content == file_content)
+			{
+				return it->second.result;
+			}
+			// File was changed after last request, so its entry is replaced by the new one.
+			requests_.erase(it);
+		}
+
+		shared_ptr< boost::promise<shader_object_ptr> > result = make_shared< boost::promise<shader_object_ptr> >();
+		shader_object_future ret( result->get_future() );
+		request req = { file_content, ret };
+		requests_.insert( std::make_pair(key, req) );
+
+		workers_.schedule( [this, desc, key, file_content, result]()
+		{
+			shader_object_ptr compiled = desc.from_file
+				? salviar::compile_from_file(desc.code_or_file_name, desc.profile)
+				: salviar::compile(desc.code_or_file_name, desc.profile);
+			if(!compiled)
+			{
+				forget_failed(key, file_content);
+			}
+			result->set_value(compiled);
+		} );
+
+		return ret;
+	}
+
+	shader_object_future compile(string const& code, shader_profile const& profile)
+	{
+		return compile( shader_compile_desc(code, profile.language, false) );
+	}
+
+	shader_object_future compile_from_file(string const& file_name, shader_profile const& profile)
+	{
+		return compile( shader_compile_desc(file_name, profile.language, true) );
+	}
+
+	vector<shader_object_future> precompile(vector<shader_compile_desc> const& manifest)
+	{
+		vector<shader_object_future> ret;
+		ret.reserve( manifest.size() );
+		for(auto const& desc: manifest)
+		{
+			ret.push_back( compile(desc) );
+		}
+		return ret;
+	}
+
+	void wait_all()
+	{
+		workers_.wait();
+	}
+
+private:
+	typedef boost::tuple<bool, languages, string> request_key;
+
+	struct request
+	{
+		string					file_content;
+		shader_object_future	result;
+	};
+
+	static string read_file(string const& file_name)
+	{
+		std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+		return string( std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() );
+	}
+
+	// Failed request is dropped so that it could be compiled again after source is fixed.
+	// Entry is kept if it was replaced by a request of changed file.
+	void forget_failed(request_key const& key, string const& file_content)
+	{
+		boost::lock_guard<boost::mutex> lock(requests_mutex_);
+		std::map<request_key, request>::iterator it = requests_.find(key);
+		if( it != requests_.end() && it->second.file_content == file_content )
+		{
+			requests_.erase(it);
+		}
+	}
+
+	boost::threadpool::pool					workers_;
+	boost::mutex							requests_mutex_;
+	std::map<request_key, request>			requests_;
+};
+
+shader_compile_service_ptr shader_compile_service::create(size_t worker_count)
+{
+	if(worker_count == 0)
+	{
+		worker_count = std::max<size_t>(num_available_threads() / 2, 1);
+	}
+	return make_shared<shader_compile_service_impl>(worker_count);
+}
+
+class deferred_shader_object: public shader_object
+{
+public:
+	deferred_shader_object(shader_object_future const& compiled, shader_object_ptr const& fallback)
+		: compiled_future_(compiled), fallback_(fallback), resolved_(false)
+	{
+	}
+
+	shader_reflection const* get_reflection() const
+	{
+		return current()->get_reflection();
+	}
+
+	void* native_function() const
+	{
+		return current()->native_function();
+	}
+
+	void specialize_variable(string const& name)
+	{
+		boost::lock_guard<boost::mutex> lock(resolve_mutex_);
+		specialized_names_.push_back(name);
+		fallback_->specialize_variable(name);
+		if(compiled_)
+		{
+			compiled_->specialize_variable(name);
+		}
+	}
+
+	bool is_specialized_variable(string const& name) const
+	{
+		boost::lock_guard<boost::mutex> lock(resolve_mutex_);
+		return std::find(specialized_names_.begin(), specialized_names_.end(), name) != specialized_names_.end();
+	}
+
+	shader_object* specialized(shader_cbuffer const& cbuffer)
+	{
+		return current()->specialized(cbuffer);
+	}
+
+private:
+	// Called by render thread and threads of host and rasterizer concurrently.
+	// Shader is switched only once, so it is locked until the future is resolved.
+	shader_object* current() const
+	{
+		if( resolved_.load(boost::memory_order_acquire) )
+		{
+			return compiled_ ? compiled_.get() : fallback_.get();
+		}
+
+		boost::lock_guard<boost::mutex> lock(resolve_mutex_);
+		if( !resolved_.load(boost::memory_order_relaxed) && compiled_future_.is_ready() )
+		{
+			compiled_ = compiled_future_.get();
+			if(compiled_)
+			{
+				for(auto const& name: specialized_names_)
+				{
+					compiled_->specialize_variable(name);
+				}
+			}
+			resolved_.store(true, boost::memory_order_release);
+		}
+		return compiled_ ? compiled_.get() : fallback_.get();
+	}
+
+	shader_object_future			compiled_future_;
+	shader_object_ptr				fallback_;
+	vector<string>					specialized_names_;
+	mutable shader_object_ptr		compiled_;
+	mutable boost::atomic<bool>		resolved_;
+	mutable boost::mutex			resolve_mutex_;
+};
+
+shader_object_ptr create_deferred_shader(shader_object_future const& compiled, shader_object_ptr const& fallback)
+{
+	EFLIB_ASSERT_AND_IF(fallback, "Fallback shader is required by deferred shader.")
+	{
+		return shader_object_ptr();
+	}
+	return make_shared<deferred_shader_object>(compiled, fallback);
+}
+
+END_NS_SALVIAR();
@@ -45,6 +45,22 @@ void pixel_shader_unit::initialize( shader_object const* code )
 	this->stream_odata.resize( ps_output_size, 0 );
 	this->buffer_odata.resize( code->get_reflection()->total_size(su_buffer_out), 0 );
 
+	this->target_outputs.clear();
+	this->depth_output_offset = -1;
+	vector<sv_layout*> infos = code->get_reflection()->layouts( su_stream_out );
+	for(sv_layout* info: infos)
+	{
+		if( info->sv == semantic_value(sv_target) )
+		{
+			assert( info->value_type == lvt_f32v4 );
+			this->target_outputs.push_back( (info->sv.get_index() << 16) | static_cast<uint32_t>(info->offset) );
+		}
+		else if( info->sv == semantic_value(sv_depth) )
+		{
+			this->depth_output_offset = static_cast<int32_t>(info->offset);
+		}
+	}
+
 	reset_pointers();
 }
 
@@ -52,7 +68,7 @@ pixel_shader_unit::~pixel_shader_unit()
 {
 }
 
-pixel_shader_unit::pixel_shader_unit() : code(NULL)
+pixel_shader_unit::pixel_shader_unit() : code(NULL), depth_output_offset(-1)
 {
 }
 
@@ -82,7 +98,8 @@ void pixel_shader_unit::reset_pointers()
 pixel_shader_unit::pixel_shader_unit( pixel_shader_unit const& rhs )
 	:  code(rhs.code),
 	stream_data(rhs.stream_data), buffer_data(rhs.buffer_data),
-	stream_odata(rhs.stream_odata), buffer_odata(rhs.buffer_odata)
+	stream_odata(rhs.stream_odata), buffer_odata(rhs.buffer_odata),
+	target_outputs(rhs.target_outputs), depth_output_offset(rhs.depth_output_offset)
 {
 	reset_pointers();
 }
@@ -94,6 +111,8 @@ pixel_shader_unit& pixel_shader_unit::operator=( pixel_shader_unit const& rhs )
 	buffer_data = rhs.buffer_data;
 	stream_odata = rhs.stream_odata;
 	buffer_odata = rhs.buffer_odata;
+	target_outputs = rhs.target_outputs;
+	depth_output_offset = rhs.depth_output_offset;
 
 	reset_pointers();
 
@@ -167,32 +186,21 @@ void pixel_shader_unit::execute(ps_output* outs, float* depths)
 
 	invoke( code->native_function(), psi, pbi, pso, pbo );
 
-	shader_reflection const* abii = code->get_reflection();
-	vector<sv_layout*> infos = abii->layouts( su_stream_out );
-
-	for(sv_layout* info: infos)
+	// All targets of a pixel are copied together, so output data of pixel is read once.
+	size_t const target_count = target_outputs.size();
+	uint32_t const* targets = target_count > 0 ? &target_outputs[0] : NULL;
+	for (size_t i_pixel = 0; i_pixel < PACKAGE_ELEMENT_COUNT; ++i_pixel)
 	{
-		if( info->sv == semantic_value(sv_target) )
+		char const* pixel_data = * reinterpret_cast<char const**>( &(stream_odata[i_pixel*sizeof(void*)]) );
+		ps_output& out = outs[i_pixel];
+		for (size_t i_target = 0; i_target < target_count; ++i_target)
 		{
-			assert( info->value_type == lvt_f32v4 );
-			for (size_t i_pixel = 0; i_pixel < PACKAGE_ELEMENT_COUNT; ++i_pixel)
-			{
-				uintptr_t pixel_addr = * reinterpret_cast<uintptr_t*>( &(stream_odata[i_pixel*sizeof(void*)]) );
-				uintptr_t data_addr = pixel_addr + static_cast<uintptr_t>(info->offset);
-				void* pdata = reinterpret_cast<void*>(data_addr);
-				void* pbuffer = &(outs[i_pixel].color[info->sv.get_index()]);
-				memcpy(pbuffer, pdata, info->size);
-			}
+			memcpy( &out.color[targets[i_target] >> 16], pixel_data + (targets[i_target] & 0xFFFF), sizeof(vec4) );
 		}
-		else if( info->sv == semantic_value(sv_depth) )
+
+		if( depth_output_offset >= 0 )
 		{
-			for (size_t i_pixel = 0; i_pixel < PACKAGE_ELEMENT_COUNT; ++i_pixel)
-			{
-				uintptr_t pixel_addr = * reinterpret_cast<uintptr_t*>( &(stream_odata[i_pixel*sizeof(void*)]) );
-				uintptr_t data_addr = pixel_addr + static_cast<uintptr_t>(info->offset);
-				float* pdata = reinterpret_cast<float*>(data_addr);
-				depths[i_pixel] = *pdata;
-			}
+			depths[i_pixel] = * reinterpret_cast<float const*>(pixel_data + depth_output_offset);
 		}
 	}
 }
@@ -57,6 +57,7 @@ void stream_assembler::update(render_state const* state)
 {
 	layout_				= state->layout.get();
 	stream_buffer_descs_= state->str_state.buffer_descs.data();
+	start_instance_		= state->start_instance;
 
 	if(state->cpp_vs)
 	{
@@ -69,10 +70,18 @@ void stream_assembler::update_register_map( boost::unordered_map<semantic_value,
 {
 	register_to_input_element_desc.clear();
 	register_to_input_element_desc.reserve( reg_map.size() );
+	instance_id_register_ = std::numeric_limits<size_t>::max();
 
 	typedef pair<semantic_value, size_t> pair_t;
 	for(auto const& sv_reg_pair: reg_map)
 	{
+		// Instance ID is generated by assembler, it is not an element of input layout.
+		if(sv_reg_pair.first.get_system_value() == sv_instance_id)
+		{
+			instance_id_register_ = sv_reg_pair.second;
+			continue;
+		}
+
 		input_element_desc const* elem_desc = layout_->find_desc(sv_reg_pair.first);
 		
 		if(elem_desc == nullptr)
@@ -88,7 +97,7 @@ void stream_assembler::update_register_map( boost::unordered_map<semantic_value,
 }
 
 /// Only used by Cpp Vertex Shader
-void stream_assembler::fetch_vertex(vs_input& rv, size_t vert_index) const
+void stream_assembler::fetch_vertex(vs_input& rv, size_t vert_index, size_t inst_index) const
 {
 	typedef tuple<size_t, input_element_desc const*, size_t> tuple_t;
 	for(auto const& reg_ied_pair: register_to_input_element_desc )
@@ -96,19 +105,34 @@ void stream_assembler::fetch_vertex(vs_input& rv, size_t vert_index) const
 		auto reg_index	= reg_ied_pair.first;
 		auto desc		= reg_ied_pair.second;
 
-		void const* pdata = element_address(*desc, vert_index);
+		void const* pdata = element_address(*desc, vert_index, inst_index);
 		rv.attribute(reg_index) = get_vec4( desc->data_format, semantic_value(desc->semantic_name, desc->semantic_index), pdata);
 	}
+
+	if(instance_id_register_ != std::numeric_limits<size_t>::max())
+	{
+		rv.attribute(instance_id_register_) = vec4(static_cast<float>(inst_index), 0.0f, 0.0f, 0.0f);
+	}
 }
 
-void const* stream_assembler::element_address( input_element_desc const& elem_desc, size_t vert_index ) const
+void const* stream_assembler::element_address( input_element_desc const& elem_desc, size_t vert_index, size_t inst_index ) const
 {
 	auto buf_desc = stream_buffer_descs_ + elem_desc.input_slot;
-	return buf_desc->buf->raw_data( elem_desc.aligned_byte_offset + buf_desc->stride * vert_index + buf_desc->offset );
+	size_t elem_index = vert_index;
+	if(elem_desc.slot_class == input_per_instance)
+	{
+		// Step rate 0 means all instances share the first element.
+		elem_index = start_instance_;
+		if(elem_desc.instance_data_step_rate != 0)
+		{
+			elem_index += inst_index / elem_desc.instance_data_step_rate;
+		}
+	}
+	return buf_desc->buf->raw_data( elem_desc.aligned_byte_offset + buf_desc->stride * elem_index + buf_desc->offset );
 }
 
-void const* stream_assembler::element_address( semantic_value const& sv, size_t vert_index ) const{
-	return element_address(*( layout_->find_desc(sv) ), vert_index);
+void const* stream_assembler::element_address( semantic_value const& sv, size_t vert_index, size_t inst_index ) const{
+	return element_address(*( layout_->find_desc(sv) ), vert_index, inst_index);
 }
 
 vector<stream_desc> const& stream_assembler::get_stream_descs(vector<size_t> const& slots)
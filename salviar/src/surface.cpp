@@ -1,11 +1,14 @@
 #include <salviar/include/surface.h>
 #include <salviar/include/internal_mapped_resource.h>
+#include <salviar/include/depth_planes.h>
+#include <salviar/include/fragment_lists.h>
 
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/make_shared.hpp>
 #include <eflib/include/platform/boost_end.h>
 
 #include <memory.h>
+#include <algorithm>
 
 using eflib::int4;
 
@@ -21,7 +24,13 @@ surface::surface(size_t w, size_t h, size_t samp_count, pixel_format fmt)
 		: format_(fmt)
 		, size_(static_cast<int>(w), static_cast<int>(h), 1, 0)
 		, sample_count_(samp_count), elem_size_(color_infos[fmt].size)
+		, clear_pending_(false)
 {
+	clear_tile_count_[0] = static_cast<int>( (w + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE );
+	clear_tile_count_[1] = static_cast<int>( (h + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE );
+	cleared_tiles_.resize(clear_tile_count_[0] * clear_tile_count_[1], 0);
+	memset(clear_texel_, 0, sizeof(clear_texel_));
+
 #if SALVIA_TILED_SURFACE
 	tile_size_[0] = (width + TILE_SIZE - 1) >> TILE_BITS;
 	tile_size_[1] = (height + TILE_SIZE - 1) >> TILE_BITS;
@@ -58,6 +67,8 @@ surface_ptr surface::make_mip_surface(filter_type filter)
 	int mip_w = ( width()  + 1 ) / 2;
 	int mip_h = ( height() + 1 ) / 2;
 
+	resolve_clear();
+
 	auto ret = boost::make_shared<surface>(mip_w, mip_h, sample_count_, format_);
 
 	switch (filter)
@@ -106,6 +117,8 @@ surface_ptr surface::make_mip_surface(filter_type filter)
 
 result surface::map(internal_mapped_resource& mapped, map_mode mm)
 {
+	resolve_clear();
+
 #if SALVIA_TILED_SURFACE
 	// Unimplemented
 	this->untile(mapped_data_);
@@ -141,6 +154,9 @@ void surface::resolve(surface& target)
 {
 	EFLIB_ASSERT(1 == target.sample_count(), "Resolve's target can't be a multi-sample surface");
 
+	resolve_clear();
+	target.resolve_clear();
+
 	color_rgba32f clr;
 	color_rgba32f tmp;
 	for (size_t y = 0; y < size_[1]; ++ y)
@@ -200,6 +216,13 @@ void surface::fill_texels(size_t sx, size_t sy, size_t width, size_t height, con
 	uint8_t pix_clr[4 * 4 * sizeof(float)];
 	from_rgba32_func_(pix_clr, &color);
 
+	// Region may partially overlap cleared tiles.
+	resolve_clear();
+	fill_texels_impl(sx, sy, width, height, pix_clr);
+}
+
+void surface::fill_texels_impl(size_t sx, size_t sy, size_t width, size_t height, void const* pix_clr)
+{
 #if SALVIA_TILED_SURFACE
 	if (tile_mode_)
     {
@@ -299,6 +322,204 @@ void surface::fill_texels(color_rgba32f const& color)
     fill_texels(0, 0, size_[0], size_[1], color);
 }
 
+void surface::clear(color_rgba32f const& color)
+{
+	boost::mutex::scoped_lock lock(clear_mutex_);
+
+	if(depth_planes_)
+	{
+		union
+		{
+			float		stencil_f;
+			uint32_t	stencil_u;
+		};
+		stencil_f = color.g;
+		depth_planes_->clear(color.r, stencil_u);
+		clear_pending_.store(true, boost::memory_order_release);
+		return;
+	}
+
+	// Pending clear is overwritten directly, no texels are touched.
+	from_rgba32_func_(clear_texel_, &color);
+	std::fill(cleared_tiles_.begin(), cleared_tiles_.end(), static_cast<uint8_t>(1));
+	clear_pending_.store(true, boost::memory_order_release);
+}
+
+void surface::fill_cleared_tile(size_t tile_x, size_t tile_y)
+{
+	uint8_t& cleared = cleared_tiles_[tile_y * clear_tile_count_[0] + tile_x];
+	if(!cleared)
+	{
+		return;
+	}
+
+	size_t sx = tile_x * CLEAR_TILE_SIZE;
+	size_t sy = tile_y * CLEAR_TILE_SIZE;
+	size_t tile_w = std::min<size_t>(CLEAR_TILE_SIZE, size_[0] - sx);
+	size_t tile_h = std::min<size_t>(CLEAR_TILE_SIZE, size_[1] - sy);
+	fill_texels_impl(sx, sy, tile_w, tile_h, clear_texel_);
+	cleared = 0;
+}
+
+void surface::fill_cleared_tiles(size_t sx, size_t sy, size_t width, size_t height)
+{
+	if( !clear_pending_.load(boost::memory_order_acquire) || width == 0 || height == 0 )
+	{
+		return;
+	}
+
+	size_t end_x = std::min<size_t>(sx + width,  size_[0]);
+	size_t end_y = std::min<size_t>(sy + height, size_[1]);
+	if(sx >= end_x || sy >= end_y)
+	{
+		return;
+	}
+
+	for(size_t tile_y = sy / CLEAR_TILE_SIZE; tile_y <= (end_y - 1) / CLEAR_TILE_SIZE; ++tile_y)
+	{
+		for(size_t tile_x = sx / CLEAR_TILE_SIZE; tile_x <= (end_x - 1) / CLEAR_TILE_SIZE; ++tile_x)
+		{
+			fill_cleared_tile(tile_x, tile_y);
+		}
+	}
+}
+
+int surface::cleared_tile_index(size_t sx, size_t sy, size_t width, size_t height) const
+{
+	if( !clear_pending_.load(boost::memory_order_acquire) || width == 0 || height == 0 )
+	{
+		return -1;
+	}
+
+	size_t const tile_x = sx / CLEAR_TILE_SIZE;
+	size_t const tile_y = sy / CLEAR_TILE_SIZE;
+	if( tile_x != (sx + width - 1) / CLEAR_TILE_SIZE || tile_y != (sy + height - 1) / CLEAR_TILE_SIZE )
+	{
+		return -1;
+	}
+
+	int const tile_index = static_cast<int>(tile_y * clear_tile_count_[0] + tile_x);
+	return cleared_tiles_[tile_index] ? tile_index : -1;
+}
+
+void surface::read_tile(surface& tile, size_t sx, size_t sy, size_t width, size_t height)
+{
+	EFLIB_ASSERT(tile.format_ == format_ && tile.sample_count_ == sample_count_, "Format of tile is not same as surface.");
+
+	if(depth_planes_)
+	{
+		size_t const plane_mask = depth_plane_buffer::TILE_SIZE - 1;
+		for(size_t y = sy & ~plane_mask; y < sy + height; y += depth_plane_buffer::TILE_SIZE)
+		{
+			for(size_t x = sx & ~plane_mask; x < sx + width; x += depth_plane_buffer::TILE_SIZE)
+			{
+				depth_planes_->decompress(x, y);
+			}
+		}
+	}
+
+	if(cleared_tile_index(sx, sy, width, height) >= 0)
+	{
+		tile.fill_texels_impl(0, 0, width, height, clear_texel_);
+		return;
+	}
+	fill_cleared_tiles(sx, sy, width, height);
+
+	size_t const row_size = width * sample_count_ * elem_size_;
+	for(size_t y = 0; y < height; ++y)
+	{
+		memcpy( tile.texel_address(0, y, 0), texel_address(sx, sy + y, 0), row_size );
+	}
+}
+
+void surface::write_tile(surface const& tile, size_t sx, size_t sy, size_t width, size_t height)
+{
+	EFLIB_ASSERT(tile.format_ == format_ && tile.sample_count_ == sample_count_, "Format of tile is not same as surface.");
+
+	// Texels of cleared tile out of region are filled before the tile is unflagged.
+	int const tile_index = cleared_tile_index(sx, sy, width, height);
+	if(tile_index >= 0)
+	{
+		size_t const tile_x = sx / CLEAR_TILE_SIZE;
+		size_t const tile_y = sy / CLEAR_TILE_SIZE;
+		bool const whole_tile =
+			   sx % CLEAR_TILE_SIZE == 0 && width  == std::min<size_t>(CLEAR_TILE_SIZE, size_[0] - sx)
+			&& sy % CLEAR_TILE_SIZE == 0 && height == std::min<size_t>(CLEAR_TILE_SIZE, size_[1] - sy);
+		if(whole_tile)
+		{
+			cleared_tiles_[tile_index] = 0;
+		}
+		else
+		{
+			fill_cleared_tile(tile_x, tile_y);
+		}
+	}
+
+	size_t const row_size = width * sample_count_ * elem_size_;
+	for(size_t y = 0; y < height; ++y)
+	{
+		memcpy( texel_address(sx, sy + y, 0), tile.texel_address(0, y, 0), row_size );
+	}
+}
+
+void surface::resolve_clear() const
+{
+	if( !clear_pending_.load(boost::memory_order_acquire) )
+	{
+		return;
+	}
+
+	// Filling is invisible from outside.
+	surface* self = const_cast<surface*>(this);
+
+	boost::mutex::scoped_lock lock(clear_mutex_);
+	if( !clear_pending_.load(boost::memory_order_relaxed) )
+	{
+		return;
+	}
+
+	for(size_t tile_y = 0; tile_y < static_cast<size_t>(clear_tile_count_[1]); ++tile_y)
+	{
+		for(size_t tile_x = 0; tile_x < static_cast<size_t>(clear_tile_count_[0]); ++tile_x)
+		{
+			self->fill_cleared_tile(tile_x, tile_y);
+		}
+	}
+
+	if(depth_planes_)
+	{
+		depth_planes_->decompress_all();
+	}
+
+	clear_pending_.store(false, boost::memory_order_release);
+}
+
+void surface::set_depth_compression(bool enabled)
+{
+	resolve_clear();
+
+	if(enabled && format_ == pixel_format_color_rg32f && sample_count_ <= depth_plane::MAX_SAMPLES)
+	{
+		if(!depth_planes_)
+		{
+			depth_planes_.reset( new depth_plane_buffer(this) );
+		}
+	}
+	else
+	{
+		depth_planes_.reset();
+	}
+}
+
+fragment_list_buffer* surface::fragment_lists()
+{
+	if(!fragment_lists_)
+	{
+		fragment_lists_.reset( new fragment_list_buffer(this) );
+	}
+	return fragment_lists_.get();
+}
+
 size_t surface::texel_offset(size_t x, size_t y, size_t sample) const
 {
 #if SALVIA_TILED_SURFACE
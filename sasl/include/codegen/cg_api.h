@@ -20,6 +20,11 @@ namespace llvm
 	class LLVMContext;
 }
 
+namespace salviar
+{
+	struct specialization_constant_desc;
+}
+
 namespace sasl
 {
 	namespace semantic
@@ -60,9 +65,13 @@ public:
 
 module_vmcode_ptr generate_vmcode(
 	sasl::semantic::module_semantic_ptr const&,
-	sasl::semantic::reflection_impl const*
+	sasl::semantic::reflection_impl const*,
+	std::vector<salviar::specialization_constant_desc> const& spec_consts
 	);
 
+/// Folds loads from constant buffer and removes the branches on them.
+void fold_constants( module_vmcode_ptr const& code );
+
 END_NS_SASL_CODEGEN();
 
 #endif
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include <sasl/enums/operators.h>
 #include <sasl/enums/builtin_types.h>
 
+#include <salviar/include/shader_impl.h>
+
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
@@ -17,6 +19,10 @@
 #include <string>
 #include <unordered_map>
 
+namespace salviar{
+	struct sv_layout;
+}
+
 namespace sasl{
 	namespace syntax_tree{
 		struct node;
@@ -60,6 +66,8 @@ public:
 		boost::shared_ptr<sasl::semantic::module_semantic> const& msem,
 		sasl::semantic::reflection_impl const* abii
 		);
+	/// Buffer variables in list will be folded as constants. It must be called before generate().
+	void specialize( std::vector<salviar::specialization_constant_desc> const& spec_consts );
 
 	// Get context by node.
 	node_context* node_ctxt(sasl::syntax_tree::node const* n, bool create_if_need = false);
@@ -68,6 +76,7 @@ protected:
 	cg_impl();
 	~cg_impl();
 
+	SASL_VISIT_DCL( unary_expression );
 	SASL_VISIT_DCL( cast_expression );
 	SASL_VISIT_DCL( constant_expression );
 	SASL_VISIT_DCL( variable_expression );
@@ -138,6 +147,11 @@ protected:
 	sasl::semantic::symbol* find_symbol(std::string const&);
 	cg_function*			get_function( std::string const& name ) const;
 
+	/// Create a constant copy of input buffer which is filled by values of specialization constants.
+	/// Returns an empty value if there is no specialization constant in buffer.
+	multi_value				create_specialized_buffer( llvm::Type* buffer_ptr_ty );
+	bool					is_specialized( salviar::sv_layout const* svl ) const;
+
 	// Store global informations
 	boost::shared_ptr<sasl::semantic::module_semantic>
 											sem_;
@@ -149,6 +163,11 @@ protected:
 	llvm::DataLayout const *				vm_data_layout_;
 	cg_service*								service_;
 
+	std::vector<salviar::specialization_constant_desc>
+											spec_consts_;
+	std::vector<salviar::sv_layout*>		specialized_layouts_;
+	multi_value								specialized_buffer_;
+
 	// Status
 	bool				semantic_mode_;
 	bool				msc_compatible_;
@@ -32,21 +32,16 @@ public:
 	~cg_simd();
 
 	// expression
-	SASL_VISIT_DCL( unary_expression );
-	SASL_VISIT_DCL( cast_expression );
 	SASL_VISIT_DCL( expression_list );
 	SASL_VISIT_DCL( cond_expression );
-	SASL_VISIT_DCL( index_expression );
 	SASL_VISIT_DCL( member_expression );
 	SASL_VISIT_DCL( variable_expression );
 
 	// declaration & type specifier
 	SASL_VISIT_DCL( initializer );
 	SASL_VISIT_DCL( member_initializer );
-	SASL_VISIT_DCL( declaration );
 	SASL_VISIT_DCL( type_definition );
 	SASL_VISIT_DCL( tynode );
-	SASL_VISIT_DCL( array_type );
 	SASL_VISIT_DCL( alias_type );
 
 	// statement
@@ -77,6 +72,9 @@ protected:
 	SASL_SPECIFIC_VISIT_DCL( visit_continue	, jump_statement );
 	SASL_SPECIFIC_VISIT_DCL( visit_break	, jump_statement );
 
+	void visit_uniform_if	( sasl::syntax_tree::if_statement& v, multi_value const& cond_value );
+	void visit_divergent_if	( sasl::syntax_tree::if_statement& v, multi_value const& cond_value );
+
 	SASL_SPECIFIC_VISIT_DCL( bin_logic, binary_expression );
 
 	llvm::Function*	entry_fn;
@@ -49,7 +49,6 @@ public:
 
 	SASL_VISIT_DCL( member_expression );
 	SASL_VISIT_DCL( cond_expression );
-	SASL_VISIT_DCL( unary_expression );
 
 	SASL_VISIT_DCL( statement );
 	SASL_VISIT_DCL( compound_statement );
@@ -14,9 +14,6 @@ public:
 
 	virtual void store( multi_value& lhs, multi_value const& rhs );
 
-	multi_value emit_and(multi_value const& lhs, multi_value const& rhs);
-	multi_value emit_or (multi_value const& lhs, multi_value const& rhs);
-
 	virtual multi_value cast_ints( multi_value const& v, cg_type* dest_tyi );
 	virtual multi_value cast_i2f ( multi_value const& v, cg_type* dest_tyi );
 	virtual multi_value cast_f2i ( multi_value const& v, cg_type* dest_tyi );
@@ -49,6 +46,25 @@ public:
 	virtual void for_iter_end();
 
 	virtual multi_value any_mask_true();
+	/// Returns true if no lane is active. It is used for skipping the branches that none of lanes will run.
+	multi_value all_mask_false();
+	/// Condition is same on all lanes, so it could be used for a real branch directly.
+	multi_value uniform_condition( multi_value const& cond );
+
+	/// Masks on top of stacks, and the block where they are available.
+	/// States are saved before a real jump and merged at the joint block.
+	struct mask_state
+	{
+		insert_point_t	ip;
+		llvm::Value*	exec_mask;
+		llvm::Value*	break_mask;
+		llvm::Value*	continue_mask;
+	};
+
+	mask_state	save_mask_state();
+	void		restore_mask_state( mask_state const& state );
+	/// Must be called at the beginning of the joint block, after all jumps are linked.
+	void		merge_mask_states( std::vector<mask_state> const& states );
 
 	virtual void if_beg();
 	virtual void if_end();
@@ -64,6 +80,12 @@ public:
 	virtual void switch_expr_beg(){}
 	virtual void switch_expr_end(){}
 
+	/// Switch body starts with no active lanes.
+	/// Lanes are activated by case_beg at their matched label, and fall through the following labels until break.
+	virtual void switch_beg();
+	virtual void switch_end();
+	virtual void case_beg( multi_value const& matched );
+
 	virtual void while_beg();
 	virtual void while_end();
 	virtual void while_cond_beg();
@@ -111,6 +133,7 @@ private:
 	std::vector<llvm::Value*>	break_masks;
 	std::vector<llvm::Value*>	continue_masks;
 	std::vector<llvm::Value*>	exec_masks;
+	std::vector<llvm::Value*>	switch_entry_masks;
 };
 
 END_NS_SASL_CODEGEN();
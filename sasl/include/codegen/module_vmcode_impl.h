@@ -13,6 +13,7 @@ namespace llvm
 	class Module;
 	class ConstantFolder;
 	class ExecutionEngine;
+	class SectionMemoryManager;
 	class Function;
 	class Type;
 	template <bool preserveNames> class IRBuilderDefaultInserter;
@@ -30,14 +31,48 @@ namespace sasl
 	}
 }
 
+#include <eflib/include/platform/boost_begin.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <eflib/include/platform/boost_end.h>
+
 #include <string>
 
 BEGIN_NS_SASL_CODEGEN();
 
 EFLIB_DECLARE_CLASS_SHARED_PTR(module_context);
+EFLIB_DECLARE_CLASS_SHARED_PTR(vm_context);
+
+class jit_memory_manager;
+
+// vm_context owns the LLVMContext which is shared by all modules generated on the same thread.
+// LLVMContext is not thread-safe, so code generation, JIT compilation and module destruction
+// must hold the lock of context. Modules generated on different threads never share a context,
+// so that many shaders can be compiled concurrently.
+class vm_context
+{
+public:
+	typedef boost::recursive_mutex				mutex_type;
+	typedef boost::recursive_mutex::scoped_lock	lock_type;
+
+	static vm_context_ptr	current_thread_context();
+
+	llvm::LLVMContext&		get()	{ return *ctx_; }
+	mutex_type&				mutex()	{ return mutex_; }
+
+	~vm_context();
+
+private:
+	vm_context();
+	vm_context(vm_context const&);
+	vm_context& operator = (vm_context const&);
+
+	llvm::LLVMContext*		ctx_;
+	mutex_type				mutex_;
+};
 
 // module_vmcode_impl contains all LLVM related objects which are used by JIT.
+// Module is compiled by MCJIT. Machine code is generated lazily when the first entry is requested.
 class module_vmcode_impl: public module_vmcode{
 public:
 	module_vmcode_impl(eflib::fixed_string const& module_name);
@@ -66,13 +101,12 @@ protected:
 
 	module_context_ptr					ctxt_;
 
-	llvm::LLVMContext*					vm_ctx_;
+	vm_context_ptr						vm_ctx_;
 	llvm::DefaultIRBuilder*				irbuilder_;
 	llvm::Module*						vm_module_;
 	llvm::ExecutionEngine*				vm_engine_;
+	jit_memory_manager*					vm_mem_mgr_;	// Owned by vm_engine_.
 	eflib::fixed_string					error_;
-
-	std::vector<llvm::Function*>		jitted_funcs_;
 };
 
 END_NS_SASL_CODEGEN();
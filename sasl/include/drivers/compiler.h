@@ -66,6 +66,8 @@ public:
 		std::string const& code_content,
 		bool high_priority ) = 0;
 	virtual void set_include_handler( include_handler_fn inc_handler ) = 0;
+	/// Buffer variables in list are folded as constants by code generator.
+	virtual void set_specialization_constants( std::vector<salviar::specialization_constant_desc> const& ) = 0;
 
 	virtual sasl::common::diag_chat_ptr				compile(bool enable_jit, bool enable_reflect2) = 0;
 	virtual sasl::common::diag_chat_ptr				compile(std::vector<salviar::external_function_desc> const&, bool enable_reflect2) = 0;
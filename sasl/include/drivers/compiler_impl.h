@@ -28,6 +28,7 @@ public:
 		bool /*high_priority*/ ){}
 	/// Only support by default code_source.
 	virtual void set_include_handler( include_handler_fn /*inc_handler*/ ){}
+	virtual void set_specialization_constants( std::vector<salviar::specialization_constant_desc> const& ){}
 	/// Only support by default code source.
 	virtual void add_include_path( std::string const& /*inc_path*/ ){}
 	/// Only support by default code source.
@@ -90,6 +91,7 @@ public:
 	virtual void add_virtual_file( std::string const& file_name, std::string const& code_content, bool high_priority );
 	/// Only support by default code_source.
 	virtual void set_include_handler( include_handler_fn inc_handler );
+	virtual void set_specialization_constants( std::vector<salviar::specialization_constant_desc> const& spec_consts );
 	/// Only support by default code source.
 	virtual void add_include_path( std::string const& inc_path );
 	/// Only support by default code source.
@@ -158,6 +160,8 @@ private:
 	std::vector< std::pair<std::string, macro_states> > macros;
 	include_handler_fn			user_inc_handler;
 	virtual_file_dict			virtual_files;
+	std::vector<salviar::specialization_constant_desc>
+								spec_consts;
 };
 
 END_NS_SASL_DRIVERS();
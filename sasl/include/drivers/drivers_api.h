@@ -32,6 +32,7 @@ namespace sasl
 	{
 		EFLIB_DECLARE_CLASS_SHARED_PTR(ia_shim);
 		EFLIB_DECLARE_CLASS_SHARED_PTR(interp_shim);
+		EFLIB_DECLARE_CLASS_SHARED_PTR(om_shim);
 	}
 }
 
@@ -40,6 +41,7 @@ extern "C"
 	SASL_DRIVERS_API void sasl_create_compiler		(sasl::drivers::compiler_ptr&	out);
 	SASL_DRIVERS_API void sasl_create_ia_shim		(sasl::shims::ia_shim_ptr&		out);
 	SASL_DRIVERS_API void sasl_create_interp_shim	(sasl::shims::interp_shim_ptr&  out);
+	SASL_DRIVERS_API void sasl_create_om_shim		(sasl::shims::om_shim_ptr&		out);
 };
 
 #endif
@@ -27,6 +27,8 @@ namespace salviar
 	class  stream_assembler;
 	struct stream_desc;
 	struct external_function_desc;
+	struct specialization_constant_desc;
+	struct shader_profile;
 	struct render_state;
 	struct render_stages;
 	class  input_layout;
@@ -54,7 +56,8 @@ EFLIB_DECLARE_CLASS_SHARED_PTR(shader_log_impl);
 typedef void (*ia_shim_func_ptr)(
 	void*						output_buffer,
 	shims::ia_shim_data const*	data,
-	size_t						i_vert
+	size_t						i_vert,
+	uint32_t const*				i_inst
 	);
 
 typedef void (*shader_func_ptr)(
@@ -100,6 +103,10 @@ public:
 	salviar::px_shader_unit_ptr get_px_shader_unit() const;
 
 	size_t						vs_output_attr_count() const;
+
+	salviar::om_quad_func_ptr	get_om_function(salviar::om_quad_key const& key);
+
+	bool vx_update_constant			(eflib::fixed_string const&, void const* value,	size_t sz);
 	
 private:
 	// Data used by Shim and Shader
@@ -121,6 +128,9 @@ private:
 	std::vector<size_t>			ia_shim_slots_;
 	std::vector<intptr_t>		ia_shim_element_offsets_;
 	std::vector<size_t>			ia_shim_dest_offsets_;
+	std::vector<uint32_t>		ia_shim_step_rates_;
+	intptr_t					ia_shim_instance_id_offset_;
+	size_t						start_instance_;
 	
 	vso2reg_func_ptr			vso2reg_func_;
 	interp_func_ptr				interp_func_;
@@ -134,7 +144,6 @@ private:
 	shader_func_ptr				vx_shader_func_;
 	salviar::stream_desc const*	stream_descs_;
 
-	bool vx_update_constant			(eflib::fixed_string const&, void const* value,	size_t sz);
 	bool vx_update_constant_pointer	(eflib::fixed_string const&, void const* value);
 	bool vx_update_sampler			(eflib::fixed_string const&, salviar::sampler_ptr const& samp);
 
@@ -164,4 +173,14 @@ extern "C"
 		);
 }
 
+void salvia_compile_shader_impl(
+	salviar::shader_object_ptr& out_shader_object,
+	salviar::shader_log_ptr& out_logs,
+	std::string const& code_or_file_name,
+	salviar::shader_profile const& profile,
+	std::vector<salviar::external_function_desc> const& external_funcs,
+	std::vector<salviar::specialization_constant_desc> const& spec_consts,
+	bool from_file
+	);
+
 #endif
\ No newline at end of file
@@ -4,12 +4,20 @@
 #include <sasl/include/host/host_forward.h>
 
 #include <salviar/include/host.h>
+#include <salviar/include/shader.h>
+#include <salviar/include/shader_impl.h>
 #include <salviar/include/shader_object.h>
 
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/tuple/tuple.hpp>
 #include <eflib/include/platform/boost_end.h>
 
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 namespace sasl
 {
 	namespace semantic
@@ -35,17 +43,46 @@ public:
 
 	virtual salviar::shader_reflection const* get_reflection() const;
 	virtual void* native_function() const;
+
+	virtual void					specialize_variable(std::string const& name);
+	virtual bool					is_specialized_variable(std::string const& name) const;
+	virtual salviar::shader_object*	specialized(salviar::shader_cbuffer const& cbuffer);
 	
 	virtual void set_reflection		(salviar::shader_reflection_ptr const& );
 	virtual void set_module_semantic(sasl::semantic::module_semantic_ptr const&);
 	virtual void set_module_context	(sasl::codegen::module_context_ptr const&);
 	virtual void set_vm_code		(sasl::codegen::module_vmcode_ptr const&);
+	/// Source is kept for recompiling the specialized shaders.
+	virtual void set_source(
+		std::string const& code_or_file_name, bool from_file,
+		salviar::shader_profile const& profile,
+		std::vector<salviar::external_function_desc> const& external_funcs
+		);
 private:
 	sasl::semantic::reflection_impl_ptr	reflection_;
 	sasl::semantic::module_semantic_ptr	module_sem_;
 	sasl::codegen:: module_context_ptr	module_ctx_;
 	sasl::codegen:: module_vmcode_ptr	module_vmc_;
 	void*								entry_;
+
+	std::string							code_or_file_name_;
+	bool								from_file_;
+	salviar::shader_profile				profile_;
+	std::vector<salviar::external_function_desc>
+										external_funcs_;
+
+	// Specialized shaders are cached by values of specialized variables.
+	// At most MAX_SPECIALIZED_SHADERS are kept, and least recently used one is evicted first.
+	// Last returned shader is held until next specialization because it may be still in use.
+	static size_t const					MAX_SPECIALIZED_SHADERS = 16;
+	typedef std::list< std::pair<std::vector<char>, salviar::shader_object_ptr> >
+										specialized_shader_list;
+
+	std::set<std::string>				specialized_variables_;
+	specialized_shader_list				specialized_shaders_;
+	std::map<std::vector<char>, specialized_shader_list::iterator>
+										specialized_shader_index_;
+	salviar::shader_object_ptr			last_specialized_;
 };
 
 END_NS_SASL_HOST();
@@ -41,7 +41,8 @@ BEGIN_NS_SASL_HOST();
 typedef void (*ia_shim_func_ptr)(
 	void*						output_buffer,
 	shims::ia_shim_data const*	data,
-	size_t						i_vert
+	size_t						i_vert,
+	uint32_t const*				i_inst
 	);
 
 typedef void (*shader_func_ptr)(
@@ -81,14 +82,15 @@ public:
 	uint32_t output_attributes_count() const;
 	uint32_t output_attribute_modifiers(size_t index) const;
 
-	void execute(size_t ivert, void* out_data);
-	void execute(size_t ivert, salviar::vs_output& out);
+	void execute(size_t ivert, size_t iinst, void* out_data);
+	void execute(size_t ivert, size_t iinst, salviar::vs_output& out);
 	
 private:
 	ia_shim_func_ptr		shim_func_;
 	shader_func_ptr			shader_func_;
 	vso2reg_func_ptr		vso2reg_func_;
 	shims::ia_shim_data		shim_data_;
+	uint32_t				instance_id_;		// SV_InstanceID is read from here by shader.
 
 	uint32_t				vso_attrs_count_;	// Only used by Cpp interpolator
 	intptr_t const*			vso_attr_offsets_;
@@ -130,6 +130,9 @@ private:
 	void mark_intrin_invoked_recursive(symbol* sym);
 
 	void mark_modified(sasl::syntax_tree::expression* expr);
+	void mark_uniform(node_semantic* sem, bool is_uniform);
+	void mark_uniform_written(sasl::syntax_tree::expression* lvalue_expr);
+	void verify_uniforms();
 
 	void initialize_casts();
 	void initialize_operator_parameter_lrvs();
@@ -176,6 +179,12 @@ private:
 	sasl::syntax_tree::node_ptr	variable_to_initialized;
 	sasl::syntax_tree::node_ptr generated_node;
 	node_semantic*				generated_sem;
+	std::vector<node_semantic*>	uniform_semantics;
+	bool						is_uniform_written;
+	// Non-scalar arguments are passed by reference, they are written if callee modifies parameter.
+	std::vector< std::pair<
+		sasl::syntax_tree::function_def*, std::pair<size_t, sasl::syntax_tree::expression*> > >
+								ref_arguments;
 
 	struct parameter_lrvs
 	{
@@ -197,6 +197,8 @@ public:
 			lr_value() const { return lrv_; }
 	bool	is_modified() const { return modified_; }
 	size_t	member_offset() const { return member_offset_; }
+	/// Value is same for all pixels or vertices of a package, because it only depends on constants and uniforms.
+	bool	is_uniform() const { return is_uniform_; }
 
 	// Function and intrinsic
 	std::string const&
@@ -245,6 +247,7 @@ public:
 	void modify_value() { modified_ = true; }
 	void referenced_declarator(sasl::syntax_tree::node* v) { referenced_declarator_ = v; }
 	void member_offset(size_t offset) { member_offset_ = offset; }
+	void is_uniform(bool v) { is_uniform_ = v; }
 	
 	// Function and intrinsic
 	void function_name(std::string const& v);
@@ -285,6 +288,7 @@ private:
 	bool						modified_;
 	lvalue_or_rvalue::id		lrv_;
 	size_t						member_offset_;
+	bool						is_uniform_;
 	
 	// Function and intrinsic
 	std::string*				function_name_;
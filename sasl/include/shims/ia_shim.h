@@ -48,12 +48,19 @@ struct ia_shim_key
 
 size_t hash_value(ia_shim_key const&);
 
+// Step rate of per-vertex element is 0.
+// Per-instance element which is shared by all instances uses INSTANCE_STEP_NEVER.
+uint32_t const INSTANCE_STEP_NEVER = 0xFFFFFFFFU;
+
 struct ia_shim_data
 {
 	salviar::stream_desc const*	stream_descs;
 	intptr_t const*				element_offsets;// TODO: OPTIMIZED BY JIT
 	size_t const*				dest_offsets;	// TODO: OPTIMIZED BY JIT
+	uint32_t const*				step_rates;		// TODO: OPTIMIZED BY JIT
 	size_t						count;			// TODO: OPTIMIZED BY JIT
+	size_t						start_instance;
+	intptr_t					instance_id_offset;	// Less than 0 if SV_InstanceID is not used.
 };
 
 EFLIB_DECLARE_CLASS_SHARED_PTR(ia_shim);
@@ -66,6 +73,8 @@ public:
 		std::vector<size_t>&				used_slots,
 		std::vector<intptr_t>&				aligned_element_offsets,
 		std::vector<size_t>&				dest_offsets,
+		std::vector<uint32_t>&				step_rates,
+		intptr_t&							instance_id_offset,
 		salviar::input_layout*				input,
 		salviar::shader_reflection const*	reflection
 	);
@@ -1,8 +1,40 @@
-class interp_shim
+#pragma once
+
+#ifndef SASL_SHIMS_OM_SHIM_H
+#define SASL_SHIMS_OM_SHIM_H
+
+#include <sasl/include/shims/shims_forward.h>
+
+#include <salviar/include/framebuffer.h>
+
+#include <eflib/include/utility/shared_declaration.h>
+
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/shared_ptr.hpp>
+#include <eflib/include/platform/boost_end.h>
+
+BEGIN_NS_SASL_SHIMS();
+
+EFLIB_DECLARE_CLASS_SHARED_PTR(om_shim);
+
+class om_shim
 {
 public:
-	void* get_shim_function(
-		salviar::shader_reflection_ptr const&	ps_reflection,
-		target_description
-	);
-};
\ No newline at end of file
+	static om_shim_ptr create();
+
+	/**
+	get_shim_function
+		Dispatches key to a template instantiation of output merger which is specialized by
+		depth function, depth write, format of color target and blend mode.
+		Only single color target is written, stencil is not supported and depth must be in
+		color_rg32f. Depth is tested per sample in scalar code, and color is blended by SSE.
+		nullptr is returned if key is not supported, and interpreted output merger will be used.
+	*/
+	virtual salviar::om_quad_func_ptr get_shim_function(salviar::om_quad_key const& key);
+
+	virtual ~om_shim() {}
+};
+
+END_NS_SASL_SHIMS();
+
+#endif
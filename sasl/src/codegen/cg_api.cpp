@@ -3,6 +3,7 @@
 #include <sasl/include/codegen/cg_general.h>
 #include <sasl/include/codegen/cg_vs.h>
 #include <sasl/include/codegen/cg_ps.h>
+#include <sasl/include/codegen/module_vmcode_impl.h>
 
 #include <sasl/include/semantic/reflection_impl.h>
 #include <sasl/include/semantic/semantics.h>
@@ -10,6 +11,7 @@
 #include <sasl/include/syntax_tree/node.h>
 
 #include <salviar/include/enums.h>
+#include <salviar/include/shader_impl.h>
 
 #include <eflib/include/diagnostics/assert.h>
 #include <eflib/include/utility/shared_declaration.h>
@@ -21,11 +23,14 @@ EFLIB_USING_SHARED_PTR(sasl::semantic, reflection_impl);
 EFLIB_USING_SHARED_PTR(sasl::syntax_tree, node);
 
 using sasl::semantic::symbol;
+using salviar::specialization_constant_desc;
 using boost::shared_ptr;
+using std::vector;
 
 module_vmcode_ptr generate_vmcode(
 	module_semantic_ptr const&	sem,
-	reflection_impl const*		reflection
+	reflection_impl const*		reflection,
+	vector<specialization_constant_desc> const& spec_consts
 	)
 {
 	module_vmcode_ptr ret;
@@ -36,6 +41,10 @@ module_vmcode_ptr generate_vmcode(
 	node* assoc_node = root->associated_node();
 	if(!assoc_node) { return ret; }
 	if(assoc_node->node_class() != node_ids::program) { return ret; }
+
+	// Module will be generated in the context of current thread.
+	vm_context_ptr vm_ctx = vm_context::current_thread_context();
+	vm_context::lock_type lock( vm_ctx->mutex() );
 	
 	if(!reflection || reflection->get_language() == salviar::lang_general)
 	{
@@ -49,21 +58,28 @@ module_vmcode_ptr generate_vmcode(
 	if ( reflection->get_language() == salviar::lang_vertex_shader )
 	{
 		cg_vs cg;
+		cg.specialize(spec_consts);
 		if( cg.generate(sem, reflection) )
 		{
-			return cg.generated_module();
+			ret = cg.generated_module();
 		}
 	}
 
 	if( reflection->get_language() == salviar::lang_pixel_shader )
 	{
 		cg_ps cg;
+		cg.specialize(spec_consts);
 		if( cg.generate(sem, reflection) )
 		{
-			return cg.generated_module();
+			ret = cg.generated_module();
 		}
 	}
 
+	if( ret && !spec_consts.empty() )
+	{
+		fold_constants(ret);
+	}
+
 	return ret;
 }
 
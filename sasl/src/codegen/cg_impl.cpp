@@ -3,6 +3,8 @@
 #include <sasl/include/codegen/utility.h>
 #include <sasl/include/codegen/cg_caster.h>
 #include <sasl/include/codegen/module_vmcode_impl.h>
+#include <sasl/include/host/utility.h>
+#include <sasl/include/semantic/reflection_impl.h>
 #include <sasl/include/semantic/semantics.h>
 #include <sasl/include/semantic/symbol.h>
 #include <sasl/include/semantic/caster.h>
@@ -14,6 +16,8 @@
 #include <sasl/enums/builtin_types.h>
 #include <sasl/enums/enums_utility.h>
 
+#include <salviar/include/shader_reflection.h>
+
 #include <eflib/include/diagnostics/assert.h>
 #include <eflib/include/utility/scoped_value.h>
 #include <eflib/include/utility/polymorphic_cast.h>
@@ -23,6 +27,8 @@
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/Support/TargetSelect.h>
 #include <eflib/include/platform/enable_warnings.h>
 
@@ -34,6 +40,8 @@
 
 #include <vector>
 #include <functional>
+#include <algorithm>
+#include <cstring>
 
 using namespace sasl::syntax_tree;
 using namespace sasl::semantic;
@@ -45,6 +53,9 @@ using eflib::polymorphic_cast;
 using eflib::scoped_value;
 using eflib::fixed_string;
 
+using salviar::sv_layout;
+using salviar::specialization_constant_desc;
+
 using boost::addressof;
 using boost::format;
 
@@ -102,6 +113,117 @@ bool cg_impl::generate( shared_ptr<module_semantic> const& mod, reflection_impl
 	return false;
 }
 
+void cg_impl::specialize( vector<specialization_constant_desc> const& spec_consts )
+{
+	spec_consts_ = spec_consts;
+}
+
+// Rebuild constant from the buffer memory which is in the layout of type.
+static Constant* constant_from_memory( Type* ty, char const* data, DataLayout const* dl )
+{
+	if( ty->isIntegerTy() )
+	{
+		uint64_t v = 0;
+		memcpy( &v, data, static_cast<size_t>( dl->getTypeStoreSize(ty) ) );
+		return ConstantInt::get(ty, v);
+	}
+
+	if( ty->isFloatTy() )
+	{
+		float v;
+		memcpy( &v, data, sizeof(v) );
+		return ConstantFP::get(ty, v);
+	}
+
+	if( ty->isDoubleTy() )
+	{
+		double v;
+		memcpy( &v, data, sizeof(v) );
+		return ConstantFP::get(ty, v);
+	}
+
+	if( StructType* struct_ty = dyn_cast<StructType>(ty) )
+	{
+		StructLayout const* layout = dl->getStructLayout(struct_ty);
+		vector<Constant*> elems;
+		for( unsigned i = 0; i < struct_ty->getNumElements(); ++i )
+		{
+			elems.push_back( constant_from_memory( struct_ty->getElementType(i), data + layout->getElementOffset(i), dl ) );
+		}
+		return ConstantStruct::get(struct_ty, elems);
+	}
+
+	if( ty->isArrayTy() || ty->isVectorTy() )
+	{
+		Type* elem_ty = ty->getSequentialElementType();
+		uint64_t stride = dl->getTypeAllocSize(elem_ty);
+		uint64_t count = ty->isArrayTy() ? ty->getArrayNumElements() : ty->getVectorNumElements();
+
+		vector<Constant*> elems;
+		for( uint64_t i = 0; i < count; ++i )
+		{
+			elems.push_back( constant_from_memory( elem_ty, data + stride * i, dl ) );
+		}
+
+		if( ty->isArrayTy() )
+		{
+			return ConstantArray::get( cast<ArrayType>(ty), elems );
+		}
+		return ConstantVector::get(elems);
+	}
+
+	// Pointers (arrays and samplers) are never specialized.
+	return Constant::getNullValue(ty);
+}
+
+multi_value cg_impl::create_specialized_buffer( Type* buffer_ptr_ty )
+{
+	specialized_layouts_.clear();
+
+	Type* buffer_ty = cast<PointerType>(buffer_ptr_ty)->getElementType();
+	vector<char> buffer_data( static_cast<size_t>( vm_data_layout_->getTypeAllocSize(buffer_ty) ), 0 );
+
+	for( specialization_constant_desc const& spec_const: spec_consts_ )
+	{
+		sv_layout* svl = abii->input_sv_layout( fixed_string(spec_const.name) );
+
+		// Only plain values in buffer could be folded.
+		if(	!svl
+			|| svl->usage != salviar::su_buffer_in
+			|| svl->agg_type == salviar::aggt_array
+			|| to_builtin_types(svl->value_type) == builtin_types::_sampler
+			|| spec_const.value.size() != svl->size
+			|| svl->offset + svl->size > buffer_data.size() )
+		{
+			continue;
+		}
+
+		memcpy( &buffer_data[svl->offset], &spec_const.value[0], svl->size );
+		specialized_layouts_.push_back(svl);
+	}
+
+	if( specialized_layouts_.empty() )
+	{
+		return multi_value();
+	}
+
+	GlobalVariable* specialized_buffer = new GlobalVariable(
+		*module(), buffer_ty, true, GlobalValue::InternalLinkage,
+		constant_from_memory( buffer_ty, &buffer_data[0], vm_data_layout_ ),
+		".specialized.bufi"
+		);
+
+	return service()->create_value(
+		builtin_types::none, value_array(service()->parallel_factor(), specialized_buffer),
+		value_kinds::reference, abis::c
+		);
+}
+
+bool cg_impl::is_specialized( sv_layout const* svl ) const
+{
+	return std::find( specialized_layouts_.begin(), specialized_layouts_.end(), svl ) != specialized_layouts_.end();
+}
+
 cg_impl::~cg_impl()
 {
 	if( service_ )
@@ -294,6 +416,48 @@ SASL_VISIT_DEF( binary_expression ){
 	}
 }
 
+SASL_VISIT_DEF( unary_expression ){
+	EFLIB_UNREF_DECLARATOR(data);
+
+	visit_child(v.expr);
+
+	multi_value inner_value = node_ctxt(v.expr)->node_value;
+	cg_type* one_tyinfo = service()->create_ty( sem_->get_semantic(&v)->ty_proto() );
+	node_context* ctxt = node_ctxt(v, true);
+
+	if( v.op == operators::negative ){
+		multi_value zero_value = service()->null_value( one_tyinfo->hint(), inner_value.abi() );
+		ctxt->node_value = service()->emit_sub(zero_value, inner_value);
+	} else if( v.op == operators::positive ){
+		ctxt->node_value = inner_value;
+	} else if( v.op == operators::logic_not ){
+		ctxt->node_value = service()->emit_not(inner_value);
+	} else if( v.op == operators::bit_not ){
+		multi_value all_one_value = service()->create_constant_int( NULL, inner_value.hint(), inner_value.abi(), 0xFFFFFFFFFFFFFFFF );
+		ctxt->node_value = service()->emit_bit_xor(all_one_value, inner_value);
+	} else {
+		// Increment and decrement are written back by store,
+		// which is masked in SIMD so inactive lanes keep their old values.
+		multi_value one_value = service()->one_value(inner_value);
+
+		if( v.op == operators::prefix_incr ){
+			inner_value.store( service()->emit_add(inner_value, one_value) );
+			ctxt->node_value = inner_value;
+		} else if( v.op == operators::prefix_decr ){
+			inner_value.store( service()->emit_sub(inner_value, one_value) );
+			ctxt->node_value = inner_value;
+		} else if( v.op == operators::postfix_incr ){
+			ctxt->node_value = inner_value.to_rvalue();
+			inner_value.store( service()->emit_add(inner_value, one_value) );
+		} else if( v.op == operators::postfix_decr ){
+			ctxt->node_value = inner_value.to_rvalue();
+			inner_value.store( service()->emit_sub(inner_value, one_value) );
+		}
+	}
+
+	ctxt->ty = one_tyinfo;
+}
+
 SASL_VISIT_DEF( constant_expression ){
 	EFLIB_UNREF_DECLARATOR(data);
 
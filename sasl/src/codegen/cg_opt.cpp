@@ -4,6 +4,7 @@
 #include <llvm/IR/Module.h>
 #include <llvm/PassManager.h>
 #include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Transforms/Scalar.h>
 #include <eflib/include/platform/enable_warnings.h>
 
 #include <sasl/include/codegen/cg_api.h>
@@ -28,6 +29,25 @@ using std::ostream;
 
 BEGIN_NS_SASL_CODEGEN();
 
+void fold_constants( module_vmcode_ptr const& code )
+{
+	Module* mod = code->get_vm_module();
+
+	FunctionPassManager fpm(mod);
+	fpm.add( llvm::createInstructionCombiningPass() );
+	fpm.add( llvm::createSCCPPass() );
+	fpm.add( llvm::createCFGSimplificationPass() );
+	fpm.add( llvm::createDeadCodeEliminationPass() );
+
+	fpm.doInitialization();
+	for( Function& f: mod->getFunctionList() ){
+		if(!f.empty()){
+			fpm.run(f);
+		}
+	}
+	fpm.doFinalization();
+}
+
 #if TODO
 void optimize( shared_ptr<module_vmcode> code, vector<optimization_options> opt_options )
 {
@@ -44,6 +44,7 @@ using llvm::PointerType;
 using llvm::FunctionType;
 using llvm::Function;
 using boost::shared_ptr;
+using boost::weak_ptr;
 using std::vector;
 
 #define SASL_VISITOR_TYPE_NAME cg_simd
@@ -61,11 +62,65 @@ cgs_simd* cg_simd::service() const{
 	return static_cast<cgs_simd*>(service_);
 }
 
-SASL_VISIT_DEF_UNIMPL( unary_expression );
-SASL_VISIT_DEF_UNIMPL( cast_expression );
-SASL_VISIT_DEF_UNIMPL( expression_list );
-SASL_VISIT_DEF_UNIMPL( cond_expression );
-SASL_VISIT_DEF_UNIMPL( index_expression );
+SASL_VISIT_DEF( expression_list ){
+	EFLIB_UNREF_DECLARATOR(data);
+
+	// Value of expression list is the value of last expression.
+	for( shared_ptr<expression> const& expr: v.exprs ){
+		visit_child(expr);
+	}
+	*node_ctxt(v, true) = *node_ctxt(v.exprs.back(), false);
+}
+
+SASL_VISIT_DEF( cond_expression ){
+	EFLIB_UNREF_DECLARATOR(data);
+
+	// Pseudo: SIMD Conditional Expression
+	//
+	//   cond_mask = cond
+	//   yes_value = yes_expr			<- execute under (current_mask & cond_mask)
+	//   no_value  = no_expr			<- execute under (current_mask & ~cond_mask)
+	//   result = select(cond, yes_value, no_value)
+	//
+	// Both branches are generated, but side effects only apply to the lanes which took it.
+
+	service()->if_beg();
+
+	visit_child( v.cond_expr );
+	tid_t cond_tid = sem_->get_semantic(v.cond_expr)->tid();
+	tid_t bool_tid = sem_->pety()->get( builtin_types::_boolean );
+	if( cond_tid != bool_tid ){
+		if( caster->cast( sem_->pety()->get_proto(bool_tid), v.cond_expr.get() ) == caster_t::nocast ){
+			assert(false);
+		}
+	}
+	multi_value cond_value = node_ctxt(v.cond_expr)->node_value.to_rvalue();
+	service()->if_cond_end( cond_value );
+
+	node_semantic* expr_sem = sem_->get_semantic(&v);
+
+	service()->then_beg();
+	visit_child( v.yes_expr );
+	if( sem_->get_semantic(v.yes_expr)->tid() != expr_sem->tid() ){
+		caster->cast( expr_sem->ty_proto(), v.yes_expr.get() );
+	}
+	multi_value yes_value = node_ctxt(v.yes_expr)->node_value.to_rvalue();
+	service()->then_end();
+
+	service()->else_beg();
+	visit_child( v.no_expr );
+	if( sem_->get_semantic(v.no_expr)->tid() != expr_sem->tid() ){
+		caster->cast( expr_sem->ty_proto(), v.no_expr.get() );
+	}
+	multi_value no_value = node_ctxt(v.no_expr)->node_value.to_rvalue();
+	service()->else_end();
+
+	service()->if_end();
+
+	node_context* ctxt = node_ctxt(v, true);
+	ctxt->node_value = service()->emit_select( cond_value, yes_value, no_value );
+	ctxt->ty = service()->create_ty( expr_sem->ty_proto() );
+}
 
 SASL_VISIT_DEF( member_expression ){
 	EFLIB_UNREF_DECLARATOR(data);
@@ -135,10 +190,8 @@ SASL_VISIT_DEF( variable_expression ){
 // declaration & type specifier
 SASL_VISIT_DEF_UNIMPL( initializer );
 SASL_VISIT_DEF_UNIMPL( member_initializer );
-SASL_VISIT_DEF_UNIMPL( declaration );
 SASL_VISIT_DEF_UNIMPL( type_definition );
 SASL_VISIT_DEF_UNIMPL( tynode );
-SASL_VISIT_DEF_UNIMPL( array_type );
 SASL_VISIT_DEF_UNIMPL( alias_type );
 
 // statement
@@ -147,9 +200,6 @@ SASL_VISIT_DEF( if_statement )
 {
 	EFLIB_UNREF_DECLARATOR(data);
 
-	service()->if_beg();
-
-	service()->if_cond_beg();
 	visit_child( v.cond );
 	tid_t cond_tid = sem_->get_semantic(v.cond)->tid();
 	tid_t bool_tid = sem_->pety()->get( builtin_types::_boolean );
@@ -158,41 +208,118 @@ SASL_VISIT_DEF( if_statement )
 			assert(false);
 		}
 	}
-	service()->if_cond_end( cg_impl::node_ctxt(v.cond)->node_value );
+	multi_value cond_value = cg_impl::node_ctxt(v.cond)->node_value;
+
+	if( sem_->get_semantic(v.cond)->is_uniform() )
+	{
+		visit_uniform_if( v, cond_value );
+	}
+	else
+	{
+		visit_divergent_if( v, cond_value );
+	}
+}
+
+// All lanes take the same branch, so it is a real branch and masks are untouched.
+void cg_simd::visit_uniform_if( if_statement& v, multi_value const& cond_value )
+{
+	typedef cgs_simd::mask_state mask_state;
+
+	mask_state entry_state = service()->save_mask_state();
 	insert_point_t ip_cond = service()->insert_point();
 
 	insert_point_t ip_yes_beg = service()->new_block( "if.yes", true );
-	service()->then_beg();
 	visit_child( v.yes_stmt );
-	service()->then_end();
-	insert_point_t ip_yes_end = service()->insert_point();
+	mask_state yes_state = service()->save_mask_state();
 
-	insert_point_t ip_no_beg, ip_no_end;
+	insert_point_t ip_no_beg;
+	mask_state no_state = entry_state;
 	if( v.no_stmt ){
 		ip_no_beg = service()->new_block( "if.no", true );
-		service()->else_beg();
+		service()->restore_mask_state( entry_state );
 		visit_child( v.no_stmt );
-		service()->else_end();
-		ip_no_end = service()->insert_point();
+		no_state = service()->save_mask_state();
 	}
 
 	insert_point_t ip_merge = service()->new_block( "if.merged", false );
 
-	service()->if_end();
-
 	// Link Blocks
 	service()->set_insert_point( ip_cond );
-	service()->jump_to( ip_yes_beg );
+	service()->jump_cond( service()->uniform_condition(cond_value), ip_yes_beg, ip_no_beg ? ip_no_beg : ip_merge );
 
-	if( ip_no_beg ){
-		service()->set_insert_point( ip_yes_end );
-		service()->jump_to( ip_no_beg );
+	service()->set_insert_point( yes_state.ip );
+	service()->jump_to( ip_merge );
 
-		service()->set_insert_point( ip_no_end );
+	if( ip_no_beg ){
+		service()->set_insert_point( no_state.ip );
 		service()->jump_to( ip_merge );
 	}
-	
+
 	service()->set_insert_point( ip_merge );
+	vector<mask_state> states;
+	states.push_back( yes_state );
+	states.push_back( no_state );
+	service()->merge_mask_states( states );
+}
+
+// Branches are executed under masks, and the branch is skipped if none of lanes is active.
+void cg_simd::visit_divergent_if( if_statement& v, multi_value const& cond_value )
+{
+	typedef cgs_simd::mask_state mask_state;
+
+	service()->if_beg();
+	service()->if_cond_beg();
+	service()->if_cond_end( cond_value );
+
+	mask_state entry_state = service()->save_mask_state();
+	service()->then_beg();
+	multi_value skip_yes = service()->all_mask_false();
+	insert_point_t ip_cond = service()->insert_point();
+
+	insert_point_t ip_yes_beg = service()->new_block( "if.yes", true );
+	visit_child( v.yes_stmt );
+	service()->then_end();
+	mask_state yes_state = service()->save_mask_state();
+
+	vector<mask_state> states;
+	states.push_back( entry_state );
+	states.push_back( yes_state );
+
+	insert_point_t ip_no_check = service()->new_block( v.no_stmt ? "if.no.check" : "if.merged", true );
+
+	service()->set_insert_point( ip_cond );
+	service()->jump_cond( skip_yes, ip_no_check, ip_yes_beg );
+	service()->set_insert_point( yes_state.ip );
+	service()->jump_to( ip_no_check );
+
+	service()->set_insert_point( ip_no_check );
+	service()->merge_mask_states( states );
+
+	if( v.no_stmt ){
+		mask_state no_entry_state = service()->save_mask_state();
+		service()->else_beg();
+		multi_value skip_no = service()->all_mask_false();
+
+		insert_point_t ip_no_beg = service()->new_block( "if.no", true );
+		visit_child( v.no_stmt );
+		service()->else_end();
+		mask_state no_state = service()->save_mask_state();
+
+		insert_point_t ip_merge = service()->new_block( "if.merged", true );
+
+		service()->set_insert_point( ip_no_check );
+		service()->jump_cond( skip_no, ip_merge, ip_no_beg );
+		service()->set_insert_point( no_state.ip );
+		service()->jump_to( ip_merge );
+
+		service()->set_insert_point( ip_merge );
+		states.clear();
+		states.push_back( no_entry_state );
+		states.push_back( no_state );
+		service()->merge_mask_states( states );
+	}
+
+	service()->if_end();
 }
 
 SASL_VISIT_DEF( while_statement )
@@ -342,9 +469,78 @@ SASL_VISIT_DEF( for_statement )
 	service()->set_insert_point( for_end );
 }
 
-SASL_VISIT_DEF_UNIMPL( case_label );
+SASL_VISIT_DEF( case_label ){
+	EFLIB_UNREF_DECLARATOR(data);
+
+	if( v.expr ){
+		visit_child( v.expr );
+	}
+}
+
 SASL_VISIT_DEF_UNIMPL( ident_label );
-SASL_VISIT_DEF_UNIMPL( switch_statement );
+
+SASL_VISIT_DEF( switch_statement )
+{
+	EFLIB_UNREF_DECLARATOR(data);
+
+	// Pseudo: SIMD Switch
+	//
+	//   cond = switch condition
+	//   matched_i = (cond == case_i_0) | (cond == case_i_1) | ...	<- for labeled statement i
+	//   matched_default |= ~(matched_0 | matched_1 | ...)
+	//   current_mask = 0
+	// label_i:
+	//   current_mask |= entry_mask & matched_i
+	//   statement i												<- walk through to label i+1
+	//   ...
+	//
+	// 'break' removes lanes from current mask until end of switch.
+
+	visit_child( v.cond );
+	multi_value cond_value = node_ctxt(v.cond)->node_value.to_rvalue();
+	node_semantic* cond_sem = sem_->get_semantic(v.cond);
+
+	node_semantic* ssi = sem_->get_semantic(&v);
+	assert( ssi );
+
+	multi_value no_lanes = service()->null_value( builtin_types::_boolean, abis::llvm );
+	multi_value any_matched = no_lanes;
+	labeled_statement* default_stmt = NULL;
+
+	for( weak_ptr<labeled_statement> const& weak_lbl_stmt: ssi->labeled_statements() ){
+		shared_ptr<labeled_statement> lbl_stmt = weak_lbl_stmt.lock();
+		assert( lbl_stmt );
+
+		multi_value matched = no_lanes;
+		for( shared_ptr<label> const& lbl: lbl_stmt->labels ){
+			assert( lbl->node_class() == node_ids::case_label );
+			shared_ptr<case_label> case_lbl = lbl->as_handle<case_label>();
+			if( !case_lbl->expr ){
+				default_stmt = lbl_stmt.get();
+				continue;
+			}
+
+			visit_child( case_lbl );
+			if( sem_->get_semantic(case_lbl->expr)->tid() != cond_sem->tid() ){
+				caster->cast( cond_sem->ty_proto(), case_lbl->expr.get() );
+			}
+			multi_value case_value = node_ctxt(case_lbl->expr)->node_value;
+			matched = service()->emit_or( matched, service()->emit_cmp_eq(cond_value, case_value) );
+		}
+
+		node_ctxt(lbl_stmt, true)->node_value = matched;
+		any_matched = service()->emit_or(any_matched, matched);
+	}
+
+	if( default_stmt ){
+		multi_value& default_matched = node_ctxt(default_stmt)->node_value;
+		default_matched = service()->emit_or( default_matched, service()->emit_not(any_matched) );
+	}
+
+	service()->switch_beg();
+	visit_child( v.stmts );
+	service()->switch_end();
+}
 
 SASL_VISIT_DEF( compound_statement ){
 	EFLIB_UNREF_DECLARATOR(data);
@@ -358,7 +554,13 @@ SASL_VISIT_DEF( compound_statement ){
 	}
 }
 
-SASL_VISIT_DEF_UNIMPL( labeled_statement );
+SASL_VISIT_DEF( labeled_statement ){
+	EFLIB_UNREF_DECLARATOR(data);
+
+	// Labels were evaluated by switch statement.
+	service()->case_beg( node_ctxt(v)->node_value );
+	visit_child( v.stmt );
+}
 
 SASL_SPECIFIC_VISIT_DEF( before_decls_visit, program )
 {
@@ -411,6 +613,7 @@ SASL_SPECIFIC_VISIT_DEF( create_fnargs, function_def )
 		entry_values[su_buffer_in]  = service()->create_value(
 			builtin_types::none, value_array(service()->parallel_factor(), arg_it),
 			value_kinds::reference, abis::c);
+		specialized_buffer_ = create_specialized_buffer( arg_it->getType() );
 		++arg_it;
 		arg_it->setName( ".arg.stro" );
 		entry_values[su_stream_out] = service()->create_value(
@@ -536,14 +739,37 @@ SASL_SPECIFIC_VISIT_DEF( visit_break	, jump_statement ){
 
 SASL_SPECIFIC_VISIT_DEF( bin_logic, binary_expression ){
 	EFLIB_UNREF_DECLARATOR(data);
-	EFLIB_UNREF_DECLARATOR(v);
-	EFLIB_ASSERT_UNIMPLEMENTED();
+
+	// Right operand is evaluated under mask of lanes which are not short-circuited by left operand,
+	// so side effects of right operand only take effect on these lanes.
+	visit_child( v.left_expr );
+	multi_value lhs = node_ctxt(v.left_expr)->node_value;
+
+	service()->if_beg();
+	service()->if_cond_end( lhs );
+	if( v.op == operators::logic_or ){
+		service()->else_beg();
+		visit_child( v.right_expr );
+		service()->else_end();
+	} else {
+		service()->then_beg();
+		visit_child( v.right_expr );
+		service()->then_end();
+	}
+	service()->if_end();
+
+	multi_value rhs = node_ctxt(v.right_expr)->node_value;
+
+	multi_value ret_value = ( v.op == operators::logic_or )
+		? service()->emit_or(lhs, rhs)
+		: service()->emit_and(lhs, rhs);
+	node_ctxt(v, true)->node_value = ret_value.to_rvalue();
 }
 multi_value cg_simd::layout_to_value( sv_layout* svl )
 {
 	builtin_types bt = to_builtin_types( svl->value_type );
 	multi_value ret = service()->emit_extract_ref(
-		entry_values[svl->usage], 
+		is_specialized(svl) ? specialized_buffer_ : entry_values[svl->usage],
 		static_cast<int>(svl->physical_index)
 		);
 	ret.hint( to_builtin_types( svl->value_type ) );
@@ -169,53 +169,6 @@ SASL_VISIT_DEF( cond_expression ){
 		= emit_short_cond(v.cond_expr, v.yes_expr, v.no_expr);
 }
 
-SASL_VISIT_DEF(unary_expression)
-{
-	EFLIB_UNREF_DECLARATOR(data);
-
-	visit_child(v.expr);
-	
-	multi_value inner_value = node_ctxt(v.expr)->node_value;
-
-	cg_type* one_tyinfo = service()->create_ty( sem_->get_semantic(&v)->ty_proto() );
-	builtin_types hint = inner_value.hint();
-
-	node_context* ctxt = node_ctxt(v, true);
-
-	if( v.op == operators::negative ){
-		multi_value zero_value = service()->null_value( one_tyinfo->hint(), inner_value.abi() );
-		ctxt->node_value = service()->emit_sub(zero_value, inner_value);
-	} else if( v.op == operators::positive ){
-		ctxt->node_value = inner_value;
-	} else if( v.op == operators::logic_not ) {
-		ctxt->node_value = service()->emit_not(inner_value);
-	} else if( v.op == operators::bit_not ) {
-		multi_value all_one_value = service()->create_constant_int( NULL, hint, inner_value.abi(), 0xFFFFFFFFFFFFFFFF );
-		ctxt->node_value = service()->emit_bit_xor( all_one_value, inner_value );
-	} else {
-
-		multi_value one_value = service()->create_constant_int( one_tyinfo, builtin_types::none, inner_value.abi(), 1 ) ;
-
-		if( v.op == operators::prefix_incr ){
-			multi_value inc_v = service()->emit_add( inner_value, one_value );
-			inner_value.store( inc_v );
-			ctxt->node_value = inner_value;
-		} else if( v.op == operators::prefix_decr ){
-			multi_value dec_v = service()->emit_sub( inner_value, one_value );
-			inner_value.store( dec_v );
-			ctxt->node_value = inner_value;
-		} else if( v.op == operators::postfix_incr ){
-			ctxt->node_value = inner_value.to_rvalue();
-			inner_value.store( service()->emit_add( inner_value, one_value ) );
-		} else if( v.op == operators::postfix_decr ){
-			ctxt->node_value = inner_value.to_rvalue();
-			inner_value.store( service()->emit_sub( inner_value, one_value ) );
-		}
-	}
-	
-	ctxt->ty = one_tyinfo;
-}
-
 SASL_VISIT_DEF_UNIMPL( statement );
 
 SASL_VISIT_DEF( compound_statement ){
@@ -195,6 +195,7 @@ SASL_SPECIFIC_VISIT_DEF( create_fnargs, function_def ){
 		arg_it->setName( ".arg.bufi" );
 		param_values[su_buffer_in]  = service()->create_value(
 			builtin_types::none, value_array(1, arg_it), value_kinds::reference, abis::c);
+		specialized_buffer_ = create_specialized_buffer( arg_it->getType() );
 		++arg_it;
 
 		arg_it->setName( ".arg.stro" );
@@ -375,7 +376,7 @@ multi_value cg_vs::layout_to_value(sv_layout* svl, bool copy_from_input)
 		ret = ret.as_ref();
 	} else {
 		ret = service()->emit_extract_ref(
-			param_values[svl->usage],
+			is_specialized(svl) ? specialized_buffer_ : param_values[svl->usage],
 			static_cast<int>(svl->physical_index)
 			);
 	}
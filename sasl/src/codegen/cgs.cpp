@@ -84,7 +84,6 @@ bool cg_service::initialize( module_vmcode_impl* mod, module_context* ctxt, modu
 	ctxt_ = ctxt;
 	sem_ = sem;
 
-	initialize_cache( context() );
 	ext_.reset(
 		new cg_extension(
 			vmcode_->builder(),
@@ -30,6 +30,8 @@
 #include <eflib/include/diagnostics/assert.h>
 #include <eflib/include/platform/cpuinfo.h>
 
+#include <algorithm>
+
 using sasl::syntax_tree::node;
 using sasl::syntax_tree::function_full_def;
 using sasl::syntax_tree::parameter_full;
@@ -71,6 +73,7 @@ using llvm::StoreInst;
 using llvm::TypeBuilder;
 using llvm::SwitchInst;
 using llvm::CmpInst;
+using llvm::PHINode;
 
 namespace Intrinsic = llvm::Intrinsic;
 
@@ -171,29 +174,46 @@ void cgs_simd::store(multi_value& lhs, multi_value const& rhs)
 
 multi_value cgs_simd::cast_ints( multi_value const& v, cg_type* dest_tyi )
 {
-	EFLIB_UNREF_DECLARATOR(v);
-	EFLIB_UNREF_DECLARATOR(dest_tyi);
+	builtin_types hint_src = v.hint();
+	builtin_types hint_dst = dest_tyi->hint();
 
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
+	Type* dest_ty = dest_tyi->ty(v.abi());
+	Type* elem_ty = type_( scalar_of(hint_dst), abis::llvm );
+
+	cast_ops::id op = is_signed( scalar_of(hint_src) ) ? cast_ops::i2i_signed : cast_ops::i2i_unsigned;
+	unary_intrin_functor cast_sv_fn = ext_->bind_cast_sv(elem_ty, op);
+	value_array val = ext_->call_unary_intrin(dest_ty, v.load(), cast_sv_fn);
+
+	return create_value( dest_tyi, builtin_types::none, val, value_kinds::value, v.abi() );
 }
 
 multi_value cgs_simd::cast_i2f( multi_value const& v, cg_type* dest_tyi )
 {
-	EFLIB_UNREF_DECLARATOR(v);
-	EFLIB_UNREF_DECLARATOR(dest_tyi);
+	builtin_types hint_i = v.hint();
+	builtin_types hint_f = dest_tyi->hint();
 
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
+	Type* dest_ty = dest_tyi->ty(v.abi());
+	Type* elem_ty = type_( scalar_of(hint_f), abis::llvm );
+
+	cast_ops::id op = is_signed( scalar_of(hint_i) ) ? cast_ops::i2f : cast_ops::u2f;
+	unary_intrin_functor cast_sv_fn = ext_->bind_cast_sv(elem_ty, op);
+	value_array val = ext_->call_unary_intrin(dest_ty, v.load(), cast_sv_fn);
+
+	return create_value( dest_tyi, builtin_types::none, val, value_kinds::value, v.abi() );
 }
 
 multi_value cgs_simd::cast_f2i( multi_value const& v, cg_type* dest_tyi )
 {
-	EFLIB_UNREF_DECLARATOR(v);
-	EFLIB_UNREF_DECLARATOR(dest_tyi);
+	builtin_types hint_i = dest_tyi->hint();
 
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
+	Type* dest_ty = dest_tyi->ty(v.abi());
+	Type* elem_ty = type_( scalar_of(hint_i), abis::llvm );
+
+	cast_ops::id op = is_signed( scalar_of(hint_i) ) ? cast_ops::f2i : cast_ops::f2u;
+	unary_intrin_functor cast_sv_fn = ext_->bind_cast_sv(elem_ty, op);
+	value_array val = ext_->call_unary_intrin(dest_ty, v.load(), cast_sv_fn);
+
+	return create_value( dest_tyi, builtin_types::none, val, value_kinds::value, v.abi() );
 }
 
 multi_value cgs_simd::cast_f2f( multi_value const& v, cg_type* dest_tyi )
@@ -207,27 +227,27 @@ multi_value cgs_simd::cast_f2f( multi_value const& v, cg_type* dest_tyi )
 
 multi_value cgs_simd::cast_i2b( multi_value const& v )
 {
-	EFLIB_UNREF_DECLARATOR(v);
-
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
+	assert( is_integer(v.hint()) );
+	return emit_cmp_ne( v, null_value( v.hint(), v.abi() ) );
 }
 
 multi_value cgs_simd::cast_f2b( multi_value const& v )
 {
-	EFLIB_UNREF_DECLARATOR(v);
-
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
+	assert( is_real(v.hint()) );
+	return emit_cmp_ne( v, null_value( v.hint(), v.abi() ) );
 }
 
 multi_value cgs_simd::create_vector( vector<multi_value> const& scalars, abis abi )
 {
-	EFLIB_UNREF_DECLARATOR(scalars);
-	EFLIB_UNREF_DECLARATOR(abi);
+	builtin_types scalar_hint = scalars[0].hint();
+	builtin_types hint = vector_of( scalar_hint, scalars.size() );
 
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
+	multi_value ret = undef_value(hint, abi);
+	for( size_t i = 0; i < scalars.size(); ++i )
+	{
+		ret = emit_insert_val( ret, i, scalars[i] );
+	}
+	return ret;
 }
 
 void cgs_simd::emit_return()
@@ -437,6 +457,117 @@ multi_value cgs_simd::any_mask_true()
 	return create_value(builtin_types::_boolean, value_array(1, ret_value), value_kinds::value, abis::llvm);
 }
 
+multi_value cgs_simd::all_mask_false()
+{
+	Value* mask = exec_masks.back();
+	Value* ret_value = builder().CreateICmpEQ( mask, ext_->get_int(0) );
+	return create_value(builtin_types::_boolean, value_array(1, ret_value), value_kinds::value, abis::llvm);
+}
+
+multi_value cgs_simd::uniform_condition( multi_value const& cond )
+{
+	Value* ret_value = cond.load(abis::llvm)[0];
+	return create_value(builtin_types::_boolean, value_array(1, ret_value), value_kinds::value, abis::llvm);
+}
+
+cgs_simd::mask_state cgs_simd::save_mask_state()
+{
+	mask_state ret;
+	ret.ip				= insert_point();
+	ret.exec_mask		= exec_masks.back();
+	ret.break_mask		= break_masks.back();
+	ret.continue_mask	= continue_masks.back();
+	return ret;
+}
+
+void cgs_simd::restore_mask_state( mask_state const& state )
+{
+	exec_masks.back()		= state.exec_mask;
+	break_masks.back()		= state.break_mask;
+	continue_masks.back()	= state.continue_mask;
+}
+
+void cgs_simd::merge_mask_states( vector<mask_state> const& states )
+{
+	BasicBlock* joint_block = insert_point().block;
+
+	// Branch terminated by 'return' never reaches joint block.
+	vector<mask_state const*> incomings;
+	for( mask_state const& state: states )
+	{
+		if( std::find( llvm::pred_begin(joint_block), llvm::pred_end(joint_block), state.ip.block ) != llvm::pred_end(joint_block) )
+		{
+			incomings.push_back(&state);
+		}
+	}
+
+	if( incomings.empty() ) { return; }
+
+	Value* mask_state::* slots[] = { &mask_state::exec_mask, &mask_state::break_mask, &mask_state::continue_mask };
+	vector<Value*>* stacks[] = { &exec_masks, &break_masks, &continue_masks };
+
+	for( int i_slot = 0; i_slot < 3; ++i_slot )
+	{
+		Value* first_mask = incomings[0]->*slots[i_slot];
+
+		bool is_same = true;
+		for( mask_state const* state: incomings )
+		{
+			is_same = is_same && (state->*slots[i_slot] == first_mask);
+		}
+
+		if( is_same )
+		{
+			stacks[i_slot]->back() = first_mask;
+			continue;
+		}
+
+		// NULL break/continue mask means no lane leaves.
+		PHINode* phi = builder().CreatePHI( all_zero_mask()->getType(), static_cast<unsigned>( incomings.size() ) );
+		for( mask_state const* state: incomings )
+		{
+			Value* mask = state->*slots[i_slot];
+			phi->addIncoming( mask ? mask : all_zero_mask(), state->ip.block );
+		}
+		stacks[i_slot]->back() = phi;
+	}
+}
+
+void cgs_simd::switch_beg()
+{
+	switch_entry_masks.push_back( exec_masks.back() );
+	exec_masks.push_back( all_zero_mask() );
+	break_masks.push_back(NULL);
+	continue_masks.push_back(NULL);
+}
+
+void cgs_simd::case_beg( multi_value const& matched )
+{
+	// Lanes which are running now fall through from the previous label.
+	Value* entry_mask = builder().CreateAnd( combine_flags( matched.load(abis::llvm) ), switch_entry_masks.back() );
+	exec_masks.back() = builder().CreateOr( exec_masks.back(), entry_mask, "mask.case" );
+	apply_break();
+}
+
+void cgs_simd::switch_end()
+{
+	Value* continue_mask = continue_masks.back();
+
+	switch_entry_masks.pop_back();
+	exec_masks.pop_back();
+	break_masks.pop_back();
+	continue_masks.pop_back();
+
+	// 'continue' in switch belongs to the enclosing loop. Switch out of loop has no continue mask to merge.
+	if( continue_mask && !continue_masks.empty() ){
+		if( continue_masks.back() ){
+			continue_mask = builder().CreateOr( continue_masks.back(), continue_mask );
+		}
+		continue_masks.back() = continue_mask;
+		apply_continue();
+	}
+}
+
 void cgs_simd::while_beg(){ enter_loop(); }
 void cgs_simd::while_end(){ exit_loop(); }
 void cgs_simd::while_cond_beg(){}
@@ -509,24 +640,6 @@ void cgs_simd::save_loop_execution_mask(Value* mask)
 	builder().CreateStore( mask, mask_vars.back() );
 }
 
-multi_value cgs_simd::emit_and( multi_value const& lhs, multi_value const& rhs )
-{
-	EFLIB_UNREF_DECLARATOR(lhs);
-	EFLIB_UNREF_DECLARATOR(rhs);
-
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
-}
-
-multi_value cgs_simd::emit_or( multi_value const& lhs, multi_value const& rhs )
-{
-	EFLIB_UNREF_DECLARATOR(lhs);
-	EFLIB_UNREF_DECLARATOR(rhs);
-
-	EFLIB_ASSERT_UNIMPLEMENTED();
-	return multi_value();
-}
-
 Value* cgs_simd::current_execution_mask() const
 {
 	return exec_masks.back();
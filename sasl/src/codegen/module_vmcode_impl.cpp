@@ -1,5 +1,6 @@
 #include <sasl/include/codegen/module_vmcode_impl.h>
 
+#include <sasl/include/codegen/ty_cache.h>
 #include <sasl/include/semantic/reflector.h>
 
 #include <eflib/include/platform/cpuinfo.h>
@@ -11,16 +12,25 @@
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/Host.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
-#include <llvm/ExecutionEngine/JIT.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <eflib/include/platform/enable_warnings.h>
 
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/unordered_map.hpp>
+#include <eflib/include/platform/boost_end.h>
+
 #include <string>
 #include <vector>
 
 using sasl::semantic::module_semantic;
 using eflib::fixed_string;
 using boost::shared_ptr;
+using boost::unordered_map;
 using std::vector;
 using std::string;
 
@@ -32,21 +42,88 @@ struct llvm_options
 		llvm::cl::ParseCommandLineOptions( sizeof(options)/sizeof(char*), options );
 	}
 
-	static llvm_options& initialize()
+	static void create()
 	{
 		static llvm_options opt;
-		return opt;
+	}
+
+	// Shaders may be compiled on several threads at the same time.
+	static void initialize()
+	{
+		static boost::once_flag flag = BOOST_ONCE_INIT;
+		boost::call_once(&llvm_options::create, flag);
 	}
 };
 
 BEGIN_NS_SASL_CODEGEN();
 
+// Resolves injected functions by name. MCJIT links symbols when the machine code is generated,
+// so functions could be injected at any time before the first entry was requested.
+class jit_memory_manager: public llvm::SectionMemoryManager
+{
+public:
+	void add_symbol(string const& name, void* addr)
+	{
+		symbols_[name] = addr;
+	}
+
+	virtual uint64_t getSymbolAddress(string const& name)
+	{
+		unordered_map<string, void*>::const_iterator it = symbols_.find(name);
+		if( it == symbols_.end() && !name.empty() && name[0] == '_' )
+		{
+			// Some platforms mangle C symbol with an underscore prefix.
+			it = symbols_.find( name.substr(1) );
+		}
+
+		if( it != symbols_.end() )
+		{
+			return reinterpret_cast<uint64_t>(it->second);
+		}
+
+		return llvm::SectionMemoryManager::getSymbolAddress(name);
+	}
+
+private:
+	unordered_map<string, void*> symbols_;
+};
+
+static boost::thread_specific_ptr<vm_context_ptr> thread_vm_context;
+
+vm_context_ptr vm_context::current_thread_context()
+{
+	if( !thread_vm_context.get() )
+	{
+		thread_vm_context.reset( new vm_context_ptr( new vm_context() ) );
+	}
+	return *thread_vm_context;
+}
+
+vm_context::vm_context()
+{
+	ctx_ = new llvm::LLVMContext();
+	initialize_cache(*ctx_);
+}
+
+vm_context::~vm_context()
+{
+	release_cache(*ctx_);
+	delete ctx_;
+}
+
 module_vmcode_impl::module_vmcode_impl(fixed_string const& name)
-: vm_engine_(NULL)
+	: vm_engine_(NULL), vm_mem_mgr_(NULL)
 {
-	vm_ctx_		= new llvm::LLVMContext();
-	irbuilder_	= new llvm::IRBuilder<>(*vm_ctx_);
-	vm_module_	= new llvm::Module(name.raw_string(), *vm_ctx_);
+	vm_ctx_		= vm_context::current_thread_context();
+
+	vm_context::lock_type lock( vm_ctx_->mutex() );
+	irbuilder_	= new llvm::IRBuilder<>( vm_ctx_->get() );
+	vm_module_	= new llvm::Module( name.raw_string(), vm_ctx_->get() );
+
+#if defined(EFLIB_WINDOWS)
+	// MCJIT only supports ELF object format.
+	vm_module_->setTargetTriple( llvm::sys::getProcessTriple() + "-elf" );
+#endif
 }
 
 llvm::Module* module_vmcode_impl::get_vm_module() const
@@ -56,17 +133,17 @@ llvm::Module* module_vmcode_impl::get_vm_module() const
 
 llvm::LLVMContext& module_vmcode_impl::get_vm_context()
 {
-	return *vm_ctx_;
+	return vm_ctx_->get();
 }
 
 module_vmcode_impl::~module_vmcode_impl()
 {
+	// Module may be released on other thread than the one which generated it.
+	vm_context::lock_type lock( vm_ctx_->mutex() );
+
 	if(vm_engine_)
 	{
-		for(size_t i = 0; i < jitted_funcs_.size(); ++i)
-		{
-			vm_engine_->freeMachineCodeForFunction(jitted_funcs_[i]);
-		}
+		// Engine owns module, memory manager and all generated machine code.
 		delete vm_engine_;
 	}
 	else
@@ -75,7 +152,6 @@ module_vmcode_impl::~module_vmcode_impl()
 	}
 
 	delete irbuilder_;
-	delete vm_ctx_;
 }
 
 llvm::DefaultIRBuilder* module_vmcode_impl::builder() const{
@@ -140,8 +216,13 @@ bool module_vmcode_impl::enable_jit()
 
 	std::string err_str;
 
+	vm_context::lock_type lock( vm_ctx_->mutex() );
+
+	jit_memory_manager* mem_mgr = new jit_memory_manager();
 	vm_engine_ = 
 		llvm::EngineBuilder(vm_module_)
+		.setUseMCJIT(true)
+		.setMCJITMemoryManager(mem_mgr)
 		.setTargetOptions(opts)
 		.setMAttrs(attrs)
 		.setErrorStr(&err_str)
@@ -149,10 +230,12 @@ bool module_vmcode_impl::enable_jit()
 
 	if(vm_engine_ == NULL)
 	{
+		delete mem_mgr;
 		error_ = err_str;
 	}
 	else
 	{
+		vm_mem_mgr_ = mem_mgr;
 		error_ = fixed_string();
 	}
 
@@ -161,19 +244,22 @@ bool module_vmcode_impl::enable_jit()
 
 void* module_vmcode_impl::get_function(fixed_string const& func_name)
 {
-	llvm::Function* vm_func = vm_module_->getFunction( func_name.raw_string() );
-	if (!vm_func)
+	if(!vm_engine_)
 	{
 		return NULL;
 	}
 
-	void* native_func = vm_engine_->getPointerToFunction(vm_func);
-	if( find(jitted_funcs_.begin(), jitted_funcs_.end(), vm_func) == jitted_funcs_.end() )
+	vm_context::lock_type lock( vm_ctx_->mutex() );
+
+	llvm::Function* vm_func = vm_module_->getFunction( func_name.raw_string() );
+	if (!vm_func || vm_func->isDeclaration())
 	{
-		jitted_funcs_.push_back(vm_func);
+		return NULL;
 	}
 
-	return native_func;
+	// Whole module is compiled and finalized when first entry is requested.
+	uint64_t native_func = vm_engine_->getFunctionAddress( func_name.raw_string() );
+	return reinterpret_cast<void*>( static_cast<uintptr_t>(native_func) );
 }
 
 void module_vmcode_impl::inject_function(void* pfn, fixed_string const& name)
@@ -184,10 +270,12 @@ void module_vmcode_impl::inject_function(void* pfn, fixed_string const& name)
 		return;
 	}
 
+	vm_context::lock_type lock( vm_ctx_->mutex() );
+
 	llvm::Function* func = vm_module_->getFunction( name.raw_string() );
 	if (func)
 	{
-		vm_engine_->addGlobalMapping(func, pfn);
+		vm_mem_mgr_->add_symbol(name.raw_string(), pfn);
 	}
 	return;
 }
@@ -4,6 +4,10 @@
 
 #include <eflib/include/diagnostics/assert.h>
 
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/thread/recursive_mutex.hpp>
+#include <eflib/include/platform/boost_end.h>
+
 int const PACKAGE_SIZE = 16;
 int SIMD_WIDTH_IN_BYTES(){
 	return 16;
@@ -21,18 +25,24 @@ public:
 	Type* type( LLVMContext& ctxt, builtin_types bt, abis abi );
 	std::string const& name( builtin_types bt, abis abi );
 	void initialize( LLVMContext& ctxt );
+	void release( LLVMContext& ctxt );
 private:
 	Type* create_ty( LLVMContext& ctxt, builtin_types bt, abis abi );
 	Type* create_abi_ty( LLVMContext& ctxt, builtin_types bt, abis abi );
 
 	unordered_map<LLVMContext*, unordered_map<builtin_types, Type*> >	cache[abis::count];
 	unordered_map<builtin_types, std::string>							ty_name[abis::count];
+
+	// Cache is shared by contexts of all compiling threads.
+	boost::recursive_mutex												mutex_;
 };
 
 Type* ty_cache_t::type( LLVMContext& ctxt, builtin_types bt, abis abi )
 {
 	if( abi == abis::unknown ) { return NULL; }
 
+	boost::recursive_mutex::scoped_lock lock(mutex_);
+
 	unordered_map<builtin_types, Type*>& ty_table = cache[static_cast<int>(abi)][&ctxt];
 	unordered_map<builtin_types, Type*>::iterator ty_table_it = ty_table.find( bt );
 	
@@ -54,6 +64,8 @@ Type* ty_cache_t::type( LLVMContext& ctxt, builtin_types bt, abis abi )
 
 std::string const& ty_cache_t::name( builtin_types bt, abis abi )
 {
+	boost::recursive_mutex::scoped_lock lock(mutex_);
+
 	std::string& ret_name = ty_name[static_cast<int>(abi)][bt];
 	char const* suffix = nullptr;
 	switch( abi )
@@ -143,8 +155,17 @@ Type* ty_cache_t::create_ty(LLVMContext& ctxt, builtin_types bt, abis abi)
 
 void ty_cache_t::initialize( LLVMContext& ctxt )
 {
-	cache[static_cast<int>(abis::c)]	.erase(&ctxt);
-	cache[static_cast<int>(abis::llvm)]	.erase(&ctxt);
+	release(ctxt);
+}
+
+void ty_cache_t::release( LLVMContext& ctxt )
+{
+	boost::recursive_mutex::scoped_lock lock(mutex_);
+
+	for(int i_abi = 0; i_abi < static_cast<int>(abis::count); ++i_abi)
+	{
+		cache[i_abi].erase(&ctxt);
+	}
 }
 
 Type* ty_cache_t::create_abi_ty(LLVMContext& ctxt, builtin_types bt, abis abi)
@@ -210,4 +231,9 @@ void initialize_cache( LLVMContext& ctxt )
 	cache.initialize(ctxt);
 }
 
+void release_cache( LLVMContext& ctxt )
+{
+	cache.release(ctxt);
+}
+
 END_NS_SASL_CODEGEN();
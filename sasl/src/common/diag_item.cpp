@@ -1,5 +1,7 @@
 #include <sasl/include/common/diag_item.h>
 
+#include <eflib/include/memory/atomic.h>
+
 using eflib::fixed_string;
 
 BEGIN_NS_SASL_COMMON();
@@ -108,7 +110,8 @@ std::string const& diag_template::template_str() const
 
 size_t diag_template::automatic_id()
 {
-	static size_t id = 100;
+	// Templates of different modules may be initialized by concurrent compiles.
+	static boost::atomic<size_t> id(100);
 	return ++id;
 }
 
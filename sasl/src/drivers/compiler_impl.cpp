@@ -46,6 +46,7 @@ using sasl::semantic::reflect;
 using sasl::codegen::generate_vmcode;
 
 using salviar::external_function_desc;
+using salviar::specialization_constant_desc;
 
 using eflib::fixed_string;
 
@@ -289,7 +290,7 @@ shared_ptr<diag_chat> compiler_impl::compile(bool enable_jit, bool enable_reflec
 		{
 			eflib::profiling_scope prof_scope(&prof, "Code generation @ compiler_impl");
 
-			mvmc = generate_vmcode( msem, mreflection.get() );
+			mvmc = generate_vmcode( msem, mreflection.get(), spec_consts );
 			if( !mvmc ){
 				cout << "Code generation error occurs!" << endl;
 				return diags;
@@ -491,6 +492,11 @@ void compiler_impl::set_include_handler( include_handler_fn inc_handler )
 	user_inc_handler = inc_handler;
 }
 
+void compiler_impl::set_specialization_constants( vector<specialization_constant_desc> const& spec_consts )
+{
+	this->spec_consts = spec_consts;
+}
+
 reflection_impl_ptr compiler_impl::get_reflection() const
 {
 	return mreflection;
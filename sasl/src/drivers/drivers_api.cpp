@@ -2,6 +2,7 @@
 #include <sasl/include/drivers/compiler_lib.h>
 #include <sasl/include/shims/ia_shim.h>
 #include <sasl/include/shims/interp_shim.h>
+#include <sasl/include/shims/om_shim.h>
 #include <eflib/include/platform/disable_warnings.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/ManagedStatic.h>
@@ -9,12 +10,18 @@
 
 #include <eflib/include/memory/atomic.h>
 
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/thread/once.hpp>
+#include <eflib/include/platform/boost_end.h>
+
 class llvm_initializer
 {
 public:
 	llvm_initializer()
 	{
 		llvm::InitializeNativeTarget();
+		llvm::InitializeNativeTargetAsmPrinter();
+		llvm::InitializeNativeTargetAsmParser();
 	}
 
 	~llvm_initializer()
@@ -22,10 +29,16 @@ public:
 		llvm::llvm_shutdown();
 	}
 
-	static llvm_initializer& initialize()
+	static void create()
 	{
 		static llvm_initializer obj;
-		return obj;
+	}
+
+	// Compilers may be created on several threads at the same time.
+	static void initialize()
+	{
+		static boost::once_flag flag = BOOST_ONCE_INIT;
+		boost::call_once(&llvm_initializer::create, flag);
 	}
 };
 
@@ -45,4 +58,10 @@ void sasl_create_interp_shim(sasl::shims::interp_shim_ptr& out)
 {
 	llvm_initializer::initialize();
 	out = sasl::shims::interp_shim::create();
+}
+
+void sasl_create_om_shim(sasl::shims::om_shim_ptr& out)
+{
+	llvm_initializer::initialize();
+	out = sasl::shims::om_shim::create();
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <sasl/include/shims/ia_shim.h>
 #include <sasl/include/shims/interp_shim.h>
+#include <sasl/include/shims/om_shim.h>
 
 #include <sasl/include/host/shader_object_impl.h>
 #include <sasl/include/host/shader_log_impl.h>
@@ -53,6 +54,7 @@ host_impl::host_impl()
 {
 	sasl_create_ia_shim(ia_shim_);
 	sasl_create_interp_shim(interp_shim_);
+	sasl_create_om_shim(om_shim_);
 
 	ia_shim_func_			= nullptr;
 	vx_shader_func_			= nullptr;
@@ -68,6 +70,9 @@ host_impl::host_impl()
 	reg2psi_func_			= nullptr;
 	vx_shader_func_			= nullptr;
 	stream_descs_			= nullptr;
+
+	ia_shim_instance_id_offset_ = -1;
+	start_instance_			= 0;
 }
 
 void host_impl::initialize(render_stages const* stages)
@@ -79,7 +84,8 @@ void host_impl::update(render_state const* state)
 {
 	// TODO: Need to reduce shim generates by detecting state changes.
 	input_layout_	= state->layout.get();
-	vx_shader_		= state->vx_shader.get();
+	start_instance_	= state->start_instance;
+	vx_shader_		= state->vx_shader ? state->vx_shader->specialized(state->vx_cbuffer) : nullptr;
 	// px_shader_		= state->px_shader.get();
 
 	if (!sa_ || !input_layout_ || !vx_shader_)
@@ -96,6 +102,7 @@ void host_impl::update(render_state const* state)
 	// Compute shim function.
 	void* ia_shim_func_typeless = ia_shim_->get_shim_function(
 		ia_shim_slots_, ia_shim_element_offsets_, ia_shim_dest_offsets_,
+		ia_shim_step_rates_, ia_shim_instance_id_offset_,
 		input_layout_, vx_shader_->get_reflection()
 		);
 	ia_shim_func_	= reinterpret_cast<ia_shim_func_ptr>(ia_shim_func_typeless);
@@ -150,6 +157,11 @@ void host_impl::update(render_state const* state)
 	}
 }
 
+om_quad_func_ptr host_impl::get_om_function(om_quad_key const& key)
+{
+	return om_shim_ ? om_shim_->get_shim_function(key) : nullptr;
+}
+
 void host_impl::update_target_params(renderer_parameters const& /*rp*/, buffer_ptr const& /*target*/)
 {
 }
@@ -169,7 +181,10 @@ vx_shader_unit_ptr host_impl::get_vx_shader_unit() const
 	data.stream_descs	= stream_descs_;
 	data.dest_offsets	= &(ia_shim_dest_offsets_[0]);
 	data.element_offsets= &(ia_shim_element_offsets_[0]);
+	data.step_rates		= &(ia_shim_step_rates_[0]);
 	data.count			= ia_shim_slots_.size();
+	data.start_instance	= start_instance_;
+	data.instance_id_offset = ia_shim_instance_id_offset_;
 
 	vx_shader_unit_impl* ret = new vx_shader_unit_impl(
 		ia_shim_func_,
@@ -234,6 +249,7 @@ void salvia_compile_shader_impl(
 	std::string const& code_or_file_name,
 	shader_profile const& profile,
 	vector<external_function_desc> const& external_funcs,
+	vector<specialization_constant_desc> const& spec_consts,
 	bool from_file
 	)
 {
@@ -266,6 +282,7 @@ void salvia_compile_shader_impl(
 	}
 
 	drv->set_parameter(lang_name);
+	drv->set_specialization_constants(spec_consts);
 	shared_ptr<diag_chat> results = drv->compile(external_funcs, false);
 
 	shader_log_impl_ptr log_impl = make_shared<shader_log_impl>();
@@ -283,6 +300,7 @@ void salvia_compile_shader_impl(
 		ret.reset( new shader_object_impl() );
 		ret->set_reflection	( drv->get_reflection() );
 		ret->set_vm_code	( drv->get_vmcode() );
+		ret->set_source		( code_or_file_name, from_file, profile, external_funcs );
 	}
 	out_shader_object = ret;
 
@@ -300,6 +318,7 @@ void salvia_compile_shader(
 	salvia_compile_shader_impl(
 		out_shader_object, out_logs,
 		code, profile, external_funcs,
+		vector<specialization_constant_desc>(),
 		false
 		);
 }
@@ -315,6 +334,7 @@ void salvia_compile_shader_file(
 	salvia_compile_shader_impl(
 		out_shader_object, out_logs,
 		file_name, profile, external_funcs,
+		vector<specialization_constant_desc>(),
 		true
 		);
 }
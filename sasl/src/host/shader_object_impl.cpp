@@ -1,17 +1,28 @@
 #include <sasl/include/host/shader_object_impl.h>
 
+#include <sasl/include/host/host_impl.h>
 #include <sasl/include/semantic/reflection_impl.h>
 #include <sasl/include/codegen/cg_api.h>
 
+#include <salviar/include/shader_cbuffer.h>
+
+#include <eflib/include/string/ustring.h>
+
 using namespace salviar;
 using namespace sasl::semantic;
 using namespace sasl::codegen;
 
+using eflib::fixed_string;
+
+using std::string;
+using std::vector;
+
 BEGIN_NS_SASL_HOST();
 
 shader_object_impl::shader_object_impl()
-	:entry_(NULL)
+	:entry_(NULL), from_file_(false)
 {
+	profile_.language = lang_none;
 }
 
 shader_reflection const* shader_object_impl::get_reflection() const
@@ -49,4 +60,96 @@ void shader_object_impl::set_vm_code(module_vmcode_ptr const& vmcode)
 	module_vmc_ = vmcode;
 }
 
+void shader_object_impl::set_source(
+	string const& code_or_file_name, bool from_file,
+	shader_profile const& profile,
+	vector<external_function_desc> const& external_funcs )
+{
+	code_or_file_name_	= code_or_file_name;
+	from_file_			= from_file;
+	profile_			= profile;
+	external_funcs_		= external_funcs;
+}
+
+void shader_object_impl::specialize_variable(string const& name)
+{
+	if( specialized_variables_.insert(name).second )
+	{
+		specialized_shaders_.clear();
+		specialized_shader_index_.clear();
+	}
+}
+
+bool shader_object_impl::is_specialized_variable(string const& name) const
+{
+	return specialized_variables_.count(name) > 0;
+}
+
+shader_object* shader_object_impl::specialized(shader_cbuffer const& cbuffer)
+{
+	if( specialized_variables_.empty() || code_or_file_name_.empty() )
+	{
+		return this;
+	}
+
+	// Variables which are not set yet are still loaded from buffer.
+	vector<specialization_constant_desc> spec_consts;
+	vector<char> cache_key;
+	for(string const& name: specialized_variables_)
+	{
+		auto var_iter = cbuffer.variables().find( fixed_string(name) );
+		if( var_iter == cbuffer.variables().end() )
+		{
+			continue;
+		}
+
+		size_t		length	= var_iter->second.length;
+		char const* data	= static_cast<char const*>( cbuffer.data_pointer(var_iter->second) );
+		spec_consts.push_back( specialization_constant_desc(name, data, length) );
+
+		cache_key.insert( cache_key.end(), name.begin(), name.end() );
+		cache_key.push_back('\0');
+		cache_key.insert( cache_key.end(), reinterpret_cast<char const*>(&length), reinterpret_cast<char const*>(&length + 1) );
+		cache_key.insert( cache_key.end(), data, data + length );
+	}
+
+	if( spec_consts.empty() )
+	{
+		return this;
+	}
+
+	auto index_iter = specialized_shader_index_.find(cache_key);
+	if( index_iter != specialized_shader_index_.end() )
+	{
+		specialized_shaders_.splice( specialized_shaders_.begin(), specialized_shaders_, index_iter->second );
+		last_specialized_ = index_iter->second->second;
+		return last_specialized_.get();
+	}
+
+	shader_object_ptr	specialized_shader;
+	shader_log_ptr		logs;
+	salvia_compile_shader_impl(
+		specialized_shader, logs,
+		code_or_file_name_, profile_, external_funcs_, spec_consts,
+		from_file_
+		);
+
+	// Failed specialization is not cached and falls back to generic shader.
+	if(!specialized_shader)
+	{
+		return this;
+	}
+
+	if( specialized_shaders_.size() >= MAX_SPECIALIZED_SHADERS )
+	{
+		specialized_shader_index_.erase( specialized_shaders_.back().first );
+		specialized_shaders_.pop_back();
+	}
+	specialized_shaders_.push_front( std::make_pair(cache_key, specialized_shader) );
+	specialized_shader_index_.insert( std::make_pair(cache_key, specialized_shaders_.begin()) );
+
+	last_specialized_ = specialized_shader;
+	return last_specialized_.get();
+}
+
 END_NS_SASL_HOST();
\ No newline at end of file
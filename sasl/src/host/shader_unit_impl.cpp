@@ -28,6 +28,7 @@ vx_shader_unit_impl::vx_shader_unit_impl(
 	, shader_func_(shader_func)
 	, buffer_data(cbuffer)
 	, shim_data_(*data)
+	, instance_id_(0)
 	, stream_data(istr_size)
 	, stream_odata(ostr_size)
 	, buffer_odata(obuf_size)
@@ -43,6 +44,7 @@ vx_shader_unit_impl::vx_shader_unit_impl(vx_shader_unit_impl const& rhs)
 	, shader_func_		(rhs.shader_func_)
 	, buffer_data		(rhs.buffer_data)
 	, shim_data_		(rhs.shim_data_)
+	, instance_id_		(0)
 	, stream_data		( rhs.stream_data.size() )
 	, stream_odata		( rhs.stream_odata.size() )
 	, buffer_odata		( rhs.buffer_odata.size() )
@@ -68,15 +70,16 @@ uint32_t vx_shader_unit_impl::output_attribute_modifiers(size_t /*index*/) const
 	return vs_output::am_linear;
 }
 
-void vx_shader_unit_impl::execute(size_t ivert, void* out_data)
+void vx_shader_unit_impl::execute(size_t ivert, size_t iinst, void* out_data)
 {
-	shim_func_(&(stream_data[0]), &shim_data_, ivert);
+	instance_id_ = static_cast<uint32_t>(iinst);
+	shim_func_(&(stream_data[0]), &shim_data_, ivert, &instance_id_);
 	shader_func_(&(stream_data[0]), buffer_data, NULL /*stream output data*/, out_data);
 }
 
-void vx_shader_unit_impl::execute(size_t ivert, vs_output& out)
+void vx_shader_unit_impl::execute(size_t ivert, size_t iinst, vs_output& out)
 {
-	execute( ivert, &(buffer_odata[0]) );
+	execute( ivert, iinst, &(buffer_odata[0]) );
 	vso2reg_func_(
 		out.raw_data(), &(buffer_odata[0]),
 		vso_attr_offsets_, vso_attr_types_, vso_attrs_count_
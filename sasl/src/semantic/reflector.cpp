@@ -63,6 +63,8 @@ bool verify_semantic_type( builtin_types btc, salviar::semantic_value const& sem
 		return ( is_scalar(btc) || is_vector(btc) ) && ( scalar_of(btc) == builtin_types::_float );
 	case salviar::sv_depth:
 		return ( btc == builtin_types::_float );
+	case salviar::sv_instance_id:
+		return ( btc == builtin_types::_uint32 || btc == builtin_types::_sint32 );
 	default:
 		EFLIB_ASSERT_UNIMPLEMENTED();
 	}
@@ -77,6 +79,7 @@ sv_usage vsinput_semantic_usage( salviar::semantic_value const& sem ){
 	case salviar::sv_normal:
 	case salviar::sv_blend_indices:
 	case salviar::sv_blend_weights:
+	case salviar::sv_instance_id:
 		return su_stream_in;
 	}
 	EFLIB_ASSERT_UNIMPLEMENTED();
@@ -19,6 +19,7 @@
 #include <salviar/include/shader_reflection.h>
 
 #include <eflib/include/diagnostics/assert.h>
+#include <eflib/include/utility/polymorphic_cast.h>
 #include <eflib/include/utility/scoped_value.h>
 #include <eflib/include/utility/unref_declarator.h>
 
@@ -86,6 +87,7 @@ using sasl::syntax_tree::list_of_builtin_type;
 using namespace boost::assign;
 using namespace sasl::utility;
 
+using eflib::polymorphic_cast;
 using eflib::scoped_value;
 using eflib::fixed_string;
 
@@ -127,6 +129,7 @@ semantic_analyser::semantic_analyser()
 	member_counter = -1;
 	label_list = NULL;
 	generated_sem = NULL;
+	is_uniform_written = false;
 }
 
 #define SASL_VISITOR_TYPE_NAME semantic_analyser
@@ -226,6 +229,11 @@ SASL_VISIT_DEF( unary_expression ){
 	generated_sem = create_node_semantic(dup_expr);
 	generated_sem->tid( inner_sem->tid() );
 	generated_sem->lr_value(operator_lrvs.ret_lrv);
+
+	if( v.op == operators::prefix_incr || v.op == operators::postfix_incr || v.op == operators::prefix_decr || v.op == operators::postfix_decr ){
+		mark_uniform_written( dup_expr->expr.get() );
+	}
+	mark_uniform( generated_sem, inner_sem->is_uniform() );
 }
 
 SASL_VISIT_DEF( cast_expression ){
@@ -253,6 +261,7 @@ SASL_VISIT_DEF( cast_expression ){
 	generated_sem = create_node_semantic(dup_cexpr);
 	generated_sem->tid( casted_tsi->tid() );
 	generated_sem->lr_value(lvalue_or_rvalue::rvalue);
+	mark_uniform( generated_sem, src_tsi->is_uniform() );
 
 	generated_node = dup_cexpr;
 }
@@ -346,11 +355,16 @@ SASL_VISIT_DEF( binary_expression )
 
 	if(is_assign_operation){
 		mark_modified( dup_expr->right_expr.get() );
+		mark_uniform_written( dup_expr->right_expr.get() );
 	}
 	tid_t result_tid = get_node_semantic( overloads[0]->associated_node() )->tid();
 	generated_sem = create_node_semantic(dup_expr);
 	generated_sem->tid(result_tid);
 	generated_sem->lr_value(operator_lrvs.ret_lrv);
+	mark_uniform(
+		generated_sem,
+		!is_assign_operation && left_expr_sem->is_uniform() && right_expr_sem->is_uniform()
+		);
 }
 
 SASL_VISIT_DEF_UNIMPL( expression_list );
@@ -422,6 +436,8 @@ SASL_VISIT_DEF( cond_expression ){
 	{
 		generated_sem->lr_value(lvalue_or_rvalue::rvalue);
 	}
+
+	mark_uniform( generated_sem, cond_sem->is_uniform() && yes_sem->is_uniform() && no_sem->is_uniform() );
 }
 
 SASL_VISIT_DEF( index_expression )
@@ -462,6 +478,7 @@ SASL_VISIT_DEF( index_expression )
 
 	generated_sem = create_node_semantic(dup_idxexpr);
 	generated_sem->lr_value( agg_sem->lr_value() );
+	mark_uniform( generated_sem, agg_sem->is_uniform() && index_sem->is_uniform() );
 	if( agg_tyn->is_array() )
 	{
 		array_type_ptr array_tyn = agg_tyn->as_handle<array_type>();
@@ -551,6 +568,31 @@ SASL_VISIT_DEF( call_expression )
 			generated_sem->is_function_pointer(false);
 			generated_sem->overloaded_function(func_sym);
 			generated_sem->lr_value(lvalue_or_rvalue::rvalue);
+
+			// User functions may read varying globals, so only intrinsics are traced.
+			bool is_uniform_call = func_sem->is_intrinsic();
+			for( shared_ptr<expression> const& arg: dup_callexpr->args )
+			{
+				is_uniform_call = is_uniform_call && get_node_semantic(arg)->is_uniform();
+			}
+			mark_uniform(generated_sem, is_uniform_call);
+
+			// Callee with C compatible ABI takes non-scalar arguments by reference,
+			// so writes to parameter are definitions of argument.
+			if( func_sem->msc_compatible() )
+			{
+				function_def* fn_def = polymorphic_cast<function_def*>( func_sym->associated_node() );
+				for( size_t i_arg = 0; i_arg < dup_callexpr->args.size(); ++i_arg )
+				{
+					expression* arg = dup_callexpr->args[i_arg].get();
+					node_semantic* arg_sem = get_node_semantic(arg);
+					builtin_types arg_hint = arg_sem->value_builtin_type();
+					if( (arg_sem->lr_value() & lvalue_or_rvalue::lvalue) && !is_scalar(arg_hint) && !is_sampler(arg_hint) )
+					{
+						ref_arguments.push_back( make_pair( fn_def, make_pair(i_arg, arg) ) );
+					}
+				}
+			}
 		}
 	}
 }
@@ -666,6 +708,7 @@ SASL_VISIT_DEF( member_expression ){
 	generated_sem->tid(mem_typeid);
 	generated_sem->swizzle(swizzle_code);
 	generated_sem->lr_value( agg_sem->lr_value() );
+	mark_uniform( generated_sem, agg_sem->is_uniform() );
 }
 
 SASL_VISIT_DEF(constant_expression)
@@ -676,6 +719,7 @@ SASL_VISIT_DEF(constant_expression)
 	generated_sem = create_node_semantic(dup_cexpr);
 	generated_sem->const_value(v.value_tok->str, v.ctype);
 	generated_sem->lr_value(lvalue_or_rvalue::rvalue);
+	mark_uniform(generated_sem, true);
 	generated_node = dup_cexpr;
 }
 
@@ -706,6 +750,7 @@ SASL_VISIT_DEF( variable_expression ){
 			generated_sem->associated_symbol(vdecl);
 			generated_sem->lr_value(lvalue_or_rvalue::lvalue);
 			generated_sem->referenced_declarator(node);
+			mark_uniform( generated_sem, generated_sem->is_uniform() );
 		}
 		else
 		{
@@ -782,6 +827,8 @@ SASL_VISIT_DEF( declarator ){
 		if(is_global_scope)
 		{
 			module_semantic_->global_vars().push_back(nodesym);
+			// Globals without semantic are fed by constant buffer.
+			mark_uniform( generated_sem, !v.semantic );
 		}
 	}
 
@@ -1342,6 +1389,8 @@ SASL_VISIT_DEF( program ){
 		dup_prog->decls.push_back( node_gen );
 	}
 
+	verify_uniforms();
+
 	module_semantic_->set_language( static_cast<salviar::languages>(lang) );
 	module_semantic_->link_symbol(dup_prog.get(), module_semantic_->root_symbol() );
 	module_semantic_->set_program(dup_prog);
@@ -2377,6 +2426,72 @@ void semantic_analyser::mark_modified(expression* expr)
 	EFLIB_ASSERT_UNIMPLEMENTED();
 }
 
+void semantic_analyser::mark_uniform(node_semantic* sem, bool is_uniform)
+{
+	sem->is_uniform(is_uniform);
+	if(is_uniform)
+	{
+		uniform_semantics.push_back(sem);
+	}
+}
+
+void semantic_analyser::mark_uniform_written(expression* lvalue_expr)
+{
+	// Element or member of uniform is written even if the index is not uniform.
+	expression* root_expr = lvalue_expr;
+	for(;;)
+	{
+		if( root_expr->node_class() == node_ids::member_expression )
+		{
+			root_expr = static_cast<member_expression*>(root_expr)->expr.get();
+		}
+		else if( root_expr->node_class() == node_ids::index_expression )
+		{
+			root_expr = static_cast<index_expression*>(root_expr)->expr.get();
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if( get_node_semantic(lvalue_expr)->is_uniform() || get_node_semantic(root_expr)->is_uniform() )
+	{
+		is_uniform_written = true;
+	}
+}
+
+void semantic_analyser::verify_uniforms()
+{
+	// Modifications of parameters are known after all function bodies are analysed.
+	for( size_t i = 0; i < ref_arguments.size(); ++i )
+	{
+		function_def*	fn_def	= ref_arguments[i].first;
+		size_t			i_arg	= ref_arguments[i].second.first;
+		expression*		arg		= ref_arguments[i].second.second;
+
+		symbol* param_sym = get_symbol( fn_def->params[i_arg].get() );
+		if( fn_def->declaration_only() || !param_sym || module_semantic_->is_modified(param_sym) )
+		{
+			mark_uniform_written(arg);
+		}
+	}
+	ref_arguments.clear();
+
+	// If a uniform was written by shader, it becomes a per-pixel copy,
+	// and expressions evaluated from it may diverge anywhere.
+	// It is rare, so we just give up the uniformity of whole module.
+	if( is_uniform_written )
+	{
+		for( node_semantic* sem: uniform_semantics )
+		{
+			sem->is_uniform(false);
+		}
+	}
+	uniform_semantics.clear();
+	is_uniform_written = false;
+}
+
 semantic_analyser::parameter_lrvs::parameter_lrvs(
 	lvalue_or_rvalue::id ret_lrv,
 	lvalue_or_rvalue::id lrv_p0,
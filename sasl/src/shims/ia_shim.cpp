@@ -35,12 +35,14 @@ ia_shim_ptr ia_shim::create()
 	return ia_shim_ptr( new ia_shim() );
 }
 
-void common_ia_shim(void* output_buffer, ia_shim_data const* mapping, size_t ivert);
+void common_ia_shim(void* output_buffer, ia_shim_data const* mapping, size_t ivert, uint32_t const* iinst);
 
 void* ia_shim::get_shim_function(
 		std::vector<size_t>&				used_slots,
 		std::vector<intptr_t>&				aligned_element_offsets,
 		std::vector<size_t>&				dest_offsets,
+		std::vector<uint32_t>&				step_rates,
+		intptr_t&							instance_id_offset,
 		salviar::input_layout*				input,
 		salviar::shader_reflection const*	reflection
 	)
@@ -51,30 +53,53 @@ void* ia_shim::get_shim_function(
     used_slots.clear();
     aligned_element_offsets.clear();
     dest_offsets.clear();
+	step_rates.clear();
+	instance_id_offset = -1;
 
     for(auto layout: layouts)
     {
+		if(layout->sv.get_system_value() == sv_instance_id)
+		{
+			instance_id_offset = static_cast<intptr_t>(layout->offset);
+			continue;
+		}
+
 		input_element_desc const* element_desc = input->find_desc(layout->sv);
 		used_slots				.push_back(element_desc->input_slot);
 		aligned_element_offsets .push_back(element_desc->aligned_byte_offset);
 		dest_offsets			.push_back(layout->offset);
+
+		uint32_t step_rate = 0;
+		if(element_desc->slot_class == input_per_instance)
+		{
+			step_rate = (element_desc->instance_data_step_rate == 0) ? INSTANCE_STEP_NEVER : element_desc->instance_data_step_rate;
+		}
+		step_rates.push_back(step_rate);
     }
 
 	return (void*)(&common_ia_shim);
 }
 
-void common_ia_shim(void* output_buffer, ia_shim_data const* mapping, size_t ivert)
+void common_ia_shim(void* output_buffer, ia_shim_data const* mapping, size_t ivert, uint32_t const* iinst)
 {
 	uint8_t* output_start = static_cast<uint8_t*>(output_buffer);
 
 	for(size_t i = 0; i < mapping->count; ++i)
 	{
+		uint32_t	step_rate		= mapping->step_rates[i];
+		size_t		ielem			= (step_rate == 0) ? ivert : mapping->start_instance + *iinst / step_rate;
+
 		stream_desc const& str_desc	= mapping->stream_descs[i];
 		uint8_t*	source_start	= static_cast<uint8_t*>(str_desc.buffer);
-		uint8_t*	source_ptr		= source_start + str_desc.offset + mapping->element_offsets[i] + str_desc.stride * ivert;
+		uint8_t*	source_ptr		= source_start + str_desc.offset + mapping->element_offsets[i] + str_desc.stride * ielem;
 		uint8_t*	output_addr		= output_start + mapping->dest_offsets[i];
 		*reinterpret_cast<void**>(output_addr) = source_ptr;
 	}
+
+	if(mapping->instance_id_offset >= 0)
+	{
+		*reinterpret_cast<uint32_t const**>(output_start + mapping->instance_id_offset) = iinst;
+	}
 }
 
 END_NS_SASL_SHIMS();
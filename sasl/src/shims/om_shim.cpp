@@ -0,0 +1,153 @@
+#include <sasl/include/shims/om_shim.h>
+
+#include <salviar/include/blend_ops.h>
+#include <salviar/include/colors.h>
+#include <salviar/include/colors_convertors.h>
+#include <salviar/include/renderer_capacity.h>
+#include <salviar/include/shader_regs.h>
+
+#include <eflib/include/platform/intrin.h>
+#include <eflib/include/utility/unref_declarator.h>
+
+using namespace salviar;
+
+BEGIN_NS_SASL_SHIMS();
+
+template <uint32_t DepthFunc>
+inline bool om_depth_test(float ps_depth, float cur_depth)
+{
+	switch(DepthFunc)
+	{
+	case compare_function_never:			return false;
+	case compare_function_less:				return ps_depth <  cur_depth;
+	case compare_function_equal:			return ps_depth == cur_depth;
+	case compare_function_less_equal:		return ps_depth <= cur_depth;
+	case compare_function_greater:			return ps_depth >  cur_depth;
+	case compare_function_not_equal:		return ps_depth != cur_depth;
+	case compare_function_greater_equal:	return ps_depth >= cur_depth;
+	default:								return true;
+	}
+}
+
+#if !defined(EFLIB_NO_SIMD)
+
+// Depth-stencil target is in color_rg32f, and depth is stored in first component.
+template <uint32_t DepthFunc, bool DepthWrite, int Format, uint32_t WriteMode>
+void om_quad(
+	om_quad_data const* data, size_t x, size_t y, uint64_t quad_mask,
+	ps_output const* quad, float const* depth, float const* aa_offset)
+{
+	typedef typename pixel_fmt_to_type<Format>::type color_type;
+	bool const depth_used = (DepthFunc != compare_function_always) || DepthWrite;
+
+	uint32_t const sample_count = data->sample_count;
+
+	for(int i = 0; i < 4; ++i)
+	{
+		uint32_t px_mask = static_cast<uint32_t>(quad_mask & SAMPLE_MASK);
+		quad_mask >>= MAX_SAMPLE_COUNT;
+
+		if(px_mask == 0)
+		{
+			continue;
+		}
+
+		size_t const pixel_x = x + (i & 1);
+		size_t const pixel_y = y + ( (i & 2) >> 1 );
+
+		uint8_t* color_texels = data->color_data + pixel_y * data->color_pitch + pixel_x * sample_count * sizeof(color_type);
+		uint8_t* ds_texels = depth_used
+			? data->ds_data + pixel_y * data->ds_pitch + pixel_x * sample_count * sizeof(color_rg32f)
+			: nullptr;
+
+		__m128 src = _mm_loadu_ps(&quad[i].color[0][0]);
+
+		uint32_t i_samp;
+		while( _xmm_bsf(&i_samp, px_mask) )
+		{
+			px_mask &= px_mask - 1;
+
+			if(depth_used)
+			{
+				float* ds_depth = reinterpret_cast<float*>(ds_texels + i_samp * sizeof(color_rg32f));
+				float const new_depth = (sample_count == 1) ? depth[i] : depth[i] + aa_offset[i_samp];
+				if( !om_depth_test<DepthFunc>(new_depth, *ds_depth) )
+				{
+					continue;
+				}
+				if(DepthWrite)
+				{
+					*ds_depth = new_depth;
+				}
+			}
+
+			write_native_color<Format, WriteMode>(color_texels + i_samp * sizeof(color_type), src, data->blend);
+		}
+	}
+}
+
+// Dispatch table from runtime key to template instantiations, nested by template parameters.
+template <uint32_t DepthFunc, bool DepthWrite, int Format>
+om_quad_func_ptr select_om_write_mode(om_quad_key const& key)
+{
+	switch(key.color_write_mode)
+	{
+	case color_write_opaque:	return &om_quad<DepthFunc, DepthWrite, Format, color_write_opaque>;
+	case color_write_masked:	return &om_quad<DepthFunc, DepthWrite, Format, color_write_masked>;
+	case color_write_blend:		return &om_quad<DepthFunc, DepthWrite, Format, color_write_blend>;
+	}
+	return nullptr;
+}
+
+template <uint32_t DepthFunc, bool DepthWrite>
+om_quad_func_ptr select_om_format(om_quad_key const& key)
+{
+	switch(key.color_format)
+	{
+	case pixel_format_color_rgba32f:	return select_om_write_mode<DepthFunc, DepthWrite, pixel_format_color_rgba32f>(key);
+	case pixel_format_color_rgba8:		return select_om_write_mode<DepthFunc, DepthWrite, pixel_format_color_rgba8>(key);
+	case pixel_format_color_bgra8:		return select_om_write_mode<DepthFunc, DepthWrite, pixel_format_color_bgra8>(key);
+	}
+	return nullptr;
+}
+
+template <uint32_t DepthFunc>
+om_quad_func_ptr select_om_depth_write(om_quad_key const& key)
+{
+	return key.depth_write ? select_om_format<DepthFunc, true>(key) : select_om_format<DepthFunc, false>(key);
+}
+
+om_quad_func_ptr select_om_function(om_quad_key const& key)
+{
+	switch(key.depth_func)
+	{
+	case compare_function_never:			return select_om_depth_write<compare_function_never>(key);
+	case compare_function_less:				return select_om_depth_write<compare_function_less>(key);
+	case compare_function_equal:			return select_om_depth_write<compare_function_equal>(key);
+	case compare_function_less_equal:		return select_om_depth_write<compare_function_less_equal>(key);
+	case compare_function_greater:			return select_om_depth_write<compare_function_greater>(key);
+	case compare_function_not_equal:		return select_om_depth_write<compare_function_not_equal>(key);
+	case compare_function_greater_equal:	return select_om_depth_write<compare_function_greater_equal>(key);
+	case compare_function_always:			return select_om_depth_write<compare_function_always>(key);
+	}
+	return nullptr;
+}
+
+#endif
+
+om_shim_ptr om_shim::create()
+{
+	return om_shim_ptr( new om_shim() );
+}
+
+om_quad_func_ptr om_shim::get_shim_function(om_quad_key const& key)
+{
+#if !defined(EFLIB_NO_SIMD)
+	return select_om_function(key);
+#else
+	EFLIB_UNREF_DECLARATOR(key);
+	return nullptr;
+#endif
+}
+
+END_NS_SASL_SHIMS();
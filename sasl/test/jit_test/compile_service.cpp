@@ -0,0 +1,155 @@
+#include <salviar/include/shader_compile_service.h>
+#include <salviar/include/shader_object.h>
+
+#include <eflib/include/platform/boost_begin.h>
+#include <boost/test/unit_test.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include <eflib/include/platform/boost_end.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+using salviar::shader_object;
+using salviar::shader_object_ptr;
+using salviar::shader_object_future;
+using salviar::shader_compile_service;
+using salviar::shader_compile_service_ptr;
+using salviar::shader_profile;
+using boost::make_shared;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+// Shader object stub which is identified by its native function.
+class stub_shader_object: public shader_object
+{
+public:
+	stub_shader_object(void* fn): fn_(fn)
+	{
+	}
+
+	salviar::shader_reflection const* get_reflection() const
+	{
+		return nullptr;
+	}
+
+	void* native_function() const
+	{
+		return fn_;
+	}
+
+	void specialize_variable(string const& name)
+	{
+		names_.insert(name);
+	}
+
+	bool is_specialized_variable(string const& name) const
+	{
+		return names_.count(name) > 0;
+	}
+
+	shader_object* specialized(salviar::shader_cbuffer const&)
+	{
+		return this;
+	}
+
+private:
+	void*				fn_;
+	std::set<string>	names_;
+};
+
+static int fallback_tag = 0;
+static int compiled_tag = 0;
+
+BOOST_AUTO_TEST_SUITE( compile_service )
+
+BOOST_AUTO_TEST_CASE( deferred_shader_switch )
+{
+	shader_object_ptr fallback = make_shared<stub_shader_object>(&fallback_tag);
+	shader_object_ptr compiled = make_shared<stub_shader_object>(&compiled_tag);
+
+	boost::promise<shader_object_ptr> result;
+	shader_object_ptr deferred = salviar::create_deferred_shader(result.get_future(), fallback);
+	BOOST_REQUIRE( deferred );
+
+	BOOST_CHECK_EQUAL( deferred->native_function(), (void*)&fallback_tag );
+
+	// Variables specialized before compiled shader is ready are applied to it when it is switched.
+	deferred->specialize_variable("threshold");
+	BOOST_CHECK( fallback->is_specialized_variable("threshold") );
+	BOOST_CHECK( deferred->is_specialized_variable("threshold") );
+
+	result.set_value(compiled);
+	BOOST_CHECK_EQUAL( deferred->native_function(), (void*)&compiled_tag );
+	BOOST_CHECK( compiled->is_specialized_variable("threshold") );
+}
+
+BOOST_AUTO_TEST_CASE( deferred_shader_failed_compile )
+{
+	shader_object_ptr fallback = make_shared<stub_shader_object>(&fallback_tag);
+
+	boost::promise<shader_object_ptr> result;
+	shader_object_ptr deferred = salviar::create_deferred_shader(result.get_future(), fallback);
+
+	result.set_value( shader_object_ptr() );
+	BOOST_CHECK_EQUAL( deferred->native_function(), (void*)&fallback_tag );
+}
+
+BOOST_AUTO_TEST_CASE( deferred_shader_concurrent_switch )
+{
+	shader_object_ptr fallback = make_shared<stub_shader_object>(&fallback_tag);
+	shader_object_ptr compiled = make_shared<stub_shader_object>(&compiled_tag);
+
+	boost::promise<shader_object_ptr> result;
+	shader_object_ptr deferred = salviar::create_deferred_shader(result.get_future(), fallback);
+
+	size_t const THREAD_COUNT = 4;
+	vector<int> invalid_counts(THREAD_COUNT, 0);
+	boost::thread_group readers;
+	for(size_t i_thread = 0; i_thread < THREAD_COUNT; ++i_thread)
+	{
+		int* invalid_count = &invalid_counts[i_thread];
+		readers.create_thread( [deferred, invalid_count]()
+		{
+			for(int i = 0; i < 10000; ++i)
+			{
+				void* fn = deferred->native_function();
+				if(fn != &fallback_tag && fn != &compiled_tag)
+				{
+					++(*invalid_count);
+				}
+			}
+		} );
+	}
+	result.set_value(compiled);
+	readers.join_all();
+
+	for(size_t i_thread = 0; i_thread < THREAD_COUNT; ++i_thread)
+	{
+		BOOST_CHECK_EQUAL( invalid_counts[i_thread], 0 );
+	}
+	BOOST_CHECK_EQUAL( deferred->native_function(), (void*)&compiled_tag );
+}
+
+BOOST_AUTO_TEST_CASE( service_shares_requests )
+{
+	shader_compile_service_ptr service = shader_compile_service::create(2);
+
+	shader_profile prof;
+	prof.language = salviar::lang_pixel_shader;
+
+	// Different shaders are compiled by workers at the same time, and same shader is compiled once.
+	shader_object_future branches	= service->compile_from_file("repo/branches.sps", prof);
+	shader_object_future for_loop	= service->compile_from_file("repo/for_loop.sps", prof);
+	shader_object_future branches2	= service->compile_from_file("repo/branches.sps", prof);
+	service->wait_all();
+
+	BOOST_REQUIRE( branches.get() );
+	BOOST_REQUIRE( for_loop.get() );
+	BOOST_CHECK_EQUAL( branches.get(), branches2.get() );
+	BOOST_CHECK( branches.get()->native_function() );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -1881,6 +1881,214 @@ BOOST_FIXTURE_TEST_CASE( ps_do_while, jit_fixture ){
 
 #if ALL_TESTS_ENABLED
 
+BOOST_FIXTURE_TEST_CASE( ps_switch, jit_fixture ){
+	init_ps( "repo/switch.sps" );
+
+	jit_function<void(void*, void*, void*, void*)> fn;
+	function( fn, "fn" );
+
+	BOOST_REQUIRE( fn );
+
+	float in_data [PACKAGE_ELEMENT_COUNT];
+	float out_data[PACKAGE_ELEMENT_COUNT];
+
+	float* in [PACKAGE_ELEMENT_COUNT] = {NULL};
+	float* out[PACKAGE_ELEMENT_COUNT] = {NULL};
+	float  ref_out[PACKAGE_ELEMENT_COUNT];
+
+	for( int i = 0; i < PACKAGE_ELEMENT_COUNT; ++i){
+		// Init Data
+		in_data[i] = 0.45f * i;
+		in[i] = in_data + i;
+		out[i] = out_data + i;
+
+		float x = 0.0f;
+		switch( static_cast<int>(in_data[i]) ){
+		case 0:
+			x = 1.0f;
+			break;
+		case 1:
+		case 2:
+			x = in_data[i] * 2.0f;
+		case 3:
+			x = x + 10.0f;
+			break;
+		case 5:
+			if( in_data[i] > 5.5f ){
+				break;
+			}
+			x = -in_data[i];
+			break;
+		default:
+			x = 100.0f;
+		}
+
+		ref_out[i] = x;
+	}
+
+	fn( (void*)in, (void*)NULL, (void*)out, (void*)NULL );
+
+	for( size_t i = 0; i < PACKAGE_ELEMENT_COUNT; ++i ){
+		BOOST_CHECK_CLOSE( out_data[i], ref_out[i], 0.00001f );
+	}
+}
+
+#endif
+
+#if ALL_TESTS_ENABLED
+
+BOOST_FIXTURE_TEST_CASE( ps_unary_and_cond, jit_fixture ){
+	init_ps( "repo/unary_and_cond.sps" );
+
+	jit_function<void(void*, void*, void*, void*)> fn;
+	function( fn, "fn" );
+
+	BOOST_REQUIRE( fn );
+
+	struct ps_in
+	{
+		float in0;
+		vec2  in1;
+	};
+
+	struct ps_out
+	{
+		vec2 out;
+	};
+
+	ps_in   in_data [PACKAGE_ELEMENT_COUNT];
+	ps_out  out_data[PACKAGE_ELEMENT_COUNT];
+	ps_in*  in [PACKAGE_ELEMENT_COUNT] = {NULL};
+	ps_out* out[PACKAGE_ELEMENT_COUNT] = {NULL};
+
+	vec2 ref_out[PACKAGE_ELEMENT_COUNT];
+
+	srand(0);
+	for( int i = 0; i < PACKAGE_ELEMENT_COUNT; ++i){
+		in[i]  = in_data  + i;
+		out[i] = out_data + i;
+
+		// Init Data
+		in_data[i].in0 = (i * 0.34f) - 1.0f;
+		for( int j = 0; j < 2; ++j ){
+			in_data[i].in1[j] = rand() / 35.0f;
+		}
+
+		// Compute reference data
+		float x = -in_data[i].in0;
+		int   n = static_cast<int>(in_data[i].in0);
+		n++;
+		++n;
+		int   m = n--;
+		int   k = m + n;
+		bool  is_small = in_data[i].in0 > 1.0f;
+
+		ref_out[i][0] = in_data[i].in0 > 2.0f ? x : static_cast<float>(k);
+		ref_out[i][1] = !is_small ? in_data[i].in1[0] : in_data[i].in1[1];
+	}
+
+	fn( (void*)in, (void*)NULL, (void*)out, (void*)NULL );
+
+	for( size_t i = 0; i < PACKAGE_ELEMENT_COUNT; ++i ){
+		BOOST_CHECK_CLOSE( out_data[i].out[0], ref_out[i][0], 0.00001f );
+		BOOST_CHECK_CLOSE( out_data[i].out[1], ref_out[i][1], 0.00001f );
+	}
+}
+
+#endif
+
+#if ALL_TESTS_ENABLED
+
+BOOST_FIXTURE_TEST_CASE( ps_uniform_branch, jit_fixture ){
+	init_ps( "repo/uniform_branch.sps" );
+
+	jit_function<void(void*, void*, void*, void*)> fn;
+	function( fn, "fn" );
+
+	BOOST_REQUIRE( fn );
+
+	float in_data [PACKAGE_ELEMENT_COUNT];
+	float out_data[PACKAGE_ELEMENT_COUNT];
+
+	float* in [PACKAGE_ELEMENT_COUNT] = {NULL};
+	float* out[PACKAGE_ELEMENT_COUNT] = {NULL};
+	float  ref_out[PACKAGE_ELEMENT_COUNT];
+
+	float thresholds[] = {2.0f, 0.5f, -1.0f};
+
+	for( float threshold: thresholds )
+	{
+		for( int i = 0; i < PACKAGE_ELEMENT_COUNT; ++i){
+			// Init Data
+			in_data[i] = 0.5f * i;
+			in[i] = in_data + i;
+			out[i] = out_data + i;
+
+			float x = ( threshold > 1.0f ) ? in_data[i] + threshold : in_data[i] - threshold;
+			if( threshold > 0.0f && in_data[i] > 100.0f ){
+				x = 1.0f;
+			}
+
+			float acc = 0.0f;
+			for( int j = 0; j < 8; ++j ){
+				if( threshold < 0.0f ){ break; }
+				acc += 1.0f;
+				if( acc > in_data[i] ){ break; }
+			}
+
+			ref_out[i] = x + acc;
+		}
+
+		fn( (void*)in, (void*)&threshold, (void*)out, (void*)NULL );
+
+		for( size_t i = 0; i < PACKAGE_ELEMENT_COUNT; ++i ){
+			BOOST_CHECK_CLOSE( out_data[i], ref_out[i], 0.00001f );
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE( ps_specialization_constant, jit_fixture ){
+	float specialized_threshold = 2.0f;
+	spec_consts.push_back(
+		salviar::specialization_constant_desc( "threshold", &specialized_threshold, sizeof(specialized_threshold) )
+		);
+	init_ps( "repo/uniform_branch.sps" );
+
+	jit_function<void(void*, void*, void*, void*)> fn;
+	function( fn, "fn" );
+
+	BOOST_REQUIRE( fn );
+
+	float in_data [PACKAGE_ELEMENT_COUNT];
+	float out_data[PACKAGE_ELEMENT_COUNT];
+
+	float* in [PACKAGE_ELEMENT_COUNT] = {NULL};
+	float* out[PACKAGE_ELEMENT_COUNT] = {NULL};
+	float  ref_out[PACKAGE_ELEMENT_COUNT];
+
+	for( int i = 0; i < PACKAGE_ELEMENT_COUNT; ++i){
+		in_data[i] = 0.5f * i;
+		in[i] = in_data + i;
+		out[i] = out_data + i;
+
+		float acc = 0.0f;
+		for( int j = 0; j < 8; ++j ){
+			acc += 1.0f;
+			if( acc > in_data[i] ){ break; }
+		}
+
+		ref_out[i] = in_data[i] + specialized_threshold + acc;
+	}
+
+	// Value in buffer is ignored because threshold was folded.
+	float buffer_threshold = -1.0f;
+	fn( (void*)in, (void*)&buffer_threshold, (void*)out, (void*)NULL );
+
+	for( size_t i = 0; i < PACKAGE_ELEMENT_COUNT; ++i ){
+		BOOST_CHECK_CLOSE( out_data[i], ref_out[i], 0.00001f );
+	}
+}
+
 BOOST_FIXTURE_TEST_CASE( constructor_ss, jit_fixture ){
 	init_g( "repo/constructors.ss" );
 
@@ -5,6 +5,8 @@
 #include <eflib/include/math/matrix.h>
 #include <eflib/include/utility/shared_declaration.h>
 
+#include <salviar/include/shader_impl.h>
+
 #include <eflib/include/platform/boost_begin.h>
 #include <boost/function.hpp>
 #include <boost/function_types/function_type.hpp>
@@ -265,6 +267,9 @@ public:
 	~jit_fixture(){}
 
 	shared_ptr<compiler>	drv;
+	// Set before init if shader needs to be specialized.
+	std::vector<salviar::specialization_constant_desc>
+							spec_consts;
 	symbol*					root_sym;
 	module_vmcode_ptr		vmc;
 	shared_ptr<diag_chat>	diags;
@@ -5,9 +5,11 @@ set( SASL_JIT_TEST_LIBS "" )
 set( SASL_JIT_TEST_HEADERS
 	${SASL_HOME_DIR}/sasl/test/jit_test/jit_test.h )
 set( SASL_JIT_TEST_SOURCES
+	${SASL_HOME_DIR}/sasl/test/jit_test/compile_service.cpp
 	${SASL_HOME_DIR}/sasl/test/jit_test/general.cpp
 	${SASL_HOME_DIR}/sasl/test/jit_test/jit_test.cpp )
-set( SASL_JIT_TEST_LIBS ${SASL_LLVM_LIBS} )
+# Compile service of salviar loads sasl_host at runtime.
+set( SASL_JIT_TEST_LIBS salviar ${SASL_LLVM_LIBS} )
 
 if ( WIN32 AND MINGW )
 	set ( SASL_JIT_TEST_LIBS imagehlp psapi )